@@ -0,0 +1,321 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <macis/asci/determinant_contributions.hpp>
+#include <macis/asci/determinant_sort.hpp>
+
+namespace macis {
+
+/// Hash of a wave function bitstring (multiply-xorshift over 64-bit words)
+template <typename WfnT>
+inline uint64_t wfn_hash(const WfnT& w) {
+  static_assert(sizeof(WfnT) % sizeof(uint64_t) == 0);
+  constexpr size_t nwords = sizeof(WfnT) / sizeof(uint64_t);
+  uint64_t words[nwords];
+  std::memcpy(words, &w, sizeof(words));
+
+  uint64_t h = 0;
+  for(size_t i = 0; i < nwords; ++i) {
+    h ^= words[i];
+    h *= 0x9e3779b97f4a7c15ull;
+    h ^= h >> 29;
+  }
+
+  // splitmix64 finalizer
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  return h;
+}
+
+/**
+ *  @brief Open addressing hash table which accumulates ASCI scores.
+ *
+ *  Contributions to the same determinant are summed on insertion, such that
+ *  duplicates never occupy memory. Collisions are resolved by linear probing,
+ *  the empty bitstring marks empty slots (it is never the target of an
+ *  excitation).
+ *
+ *  The home slot of a determinant is given by the high bits of its hash, such
+ *  that the entries of a hash shard (see `for_each_in_shard`) occupy a
+ *  contiguous range of slots in every table. This allows tables which were
+ *  filled by different threads to be merged shard by shard in parallel (see
+ *  `merge_asci_contrib_tables`).
+ *
+ *  Once the table would have to grow beyond a budget of `max_size` entries,
+ *  contributions with |rv| <= `prune_tol` are removed instead. The table only
+ *  grows beyond the budget if pruning is not effective.
+ *
+ *  For streaming top-K selection (see `set_top_k`), the table is pruned to
+ *  its K largest scores instead, which raises a running score threshold.
+ *  Contributions to new determinants which do not exceed the threshold are
+ *  discarded on insertion, such that the table never grows beyond the
+ *  budget.
+ */
+template <typename WfnT>
+class asci_contrib_hash_table {
+ public:
+  using value_type = asci_contrib<WfnT>;
+
+ protected:
+  std::vector<value_type> slots_;
+  size_t size_ = 0;
+  unsigned shift_ = 64;  ///< 64 - log2(capacity)
+  size_t max_size_;
+  double prune_tol_;
+  unsigned rotate_;
+  size_t npruned_ = 0;
+  size_t top_k_ = 0;
+  double threshold_ = -1.;
+  size_t ndiscarded_ = 0;
+
+  /// Maximum number of entries before growing / pruning (load factor 3/4)
+  inline size_t max_load() const { return slots_.size() / 4 * 3; }
+
+  inline uint64_t hash(const WfnT& w) const {
+    const auto h = wfn_hash(w);
+    return rotate_ ? (h << rotate_) | (h >> (64 - rotate_)) : h;
+  }
+
+  inline size_t home_slot(uint64_t h) const {
+    return shift_ < 64 ? h >> shift_ : 0;
+  }
+
+  /// Insert an entry whose key is not yet present in the table
+  inline void insert_unique(const value_type& p) {
+    const size_t mask = slots_.size() - 1;
+    size_t i = home_slot(hash(p.state));
+    while(slots_[i].state.any()) i = (i + 1) & mask;
+    slots_[i] = p;
+  }
+
+  /// Rebuild the table with `capacity` slots, dropping entries with
+  /// |rv| <= `tol`
+  void rehash(size_t capacity, double tol) {
+    std::vector<value_type> old_slots(capacity, value_type{WfnT(0), 0.});
+    old_slots.swap(slots_);
+    shift_ = 64 - __builtin_ctzll(capacity);
+    size_ = 0;
+    for(const auto& p : old_slots)
+      if(p.state.any() and std::abs(p.rv) > tol) {
+        insert_unique(p);
+        ++size_;
+      }
+  }
+
+  /// Raise the threshold to the (k+1)-th largest score in the table
+  void raise_threshold(size_t k) {
+    std::vector<double> scores;
+    scores.reserve(size_);
+    for_each([&](const auto& p) { scores.push_back(std::abs(p.rv)); });
+    threshold_ = std::max(threshold_, prune_tol_);
+    if(k >= scores.size()) return;
+    std::nth_element(scores.begin(), scores.begin() + k, scores.end(),
+                     std::greater<double>{});
+    threshold_ = std::max(threshold_, scores[k]);
+  }
+
+  /// Make room for at least one more entry
+  void make_room() {
+    const size_t capacity = slots_.size();
+    if(capacity / 2 * 3 <= max_size_) {
+      rehash(2 * capacity, -1.);
+      return;
+    }
+
+    // Prune, grow nevertheless if less than a third of the entries was
+    // removed
+    if(top_k_) raise_threshold(std::min(top_k_, max_load() / 2));
+    rehash(capacity, top_k_ ? threshold_ : prune_tol_);
+    ++npruned_;
+    if(size_ > capacity / 2) rehash(2 * capacity, -1.);
+  }
+
+ public:
+  /**
+   *  @param[in] max_size  Budget on the number of entries
+   *  @param[in] prune_tol Tolerance below which contributions are removed
+   *                       when the budget is hit
+   *  @param[in] rotate    Rotation of the hash before slot assignment, for
+   *                       tables which only hold a single hash shard
+   */
+  asci_contrib_hash_table(
+      size_t max_size = std::numeric_limits<size_t>::max(),
+      double prune_tol = 0., unsigned rotate = 0)
+      : max_size_(max_size), prune_tol_(prune_tol), rotate_(rotate) {
+    rehash(16, -1.);
+  }
+
+  inline size_t size() const { return size_; }
+  inline size_t capacity() const { return slots_.size(); }
+
+  /// Number of times the table was pruned
+  inline size_t npruned() const { return npruned_; }
+
+  /// Number of contributions to new determinants discarded by the top-K
+  /// threshold
+  inline size_t ndiscarded() const { return ndiscarded_; }
+
+  /// Score threshold of the streaming top-K selection (-1 if not set yet)
+  inline double threshold() const { return threshold_; }
+
+  /**
+   *  @brief Enable streaming top-K selection.
+   *
+   *  Once the budget is hit, only the (at most) `k` largest scores are kept.
+   *  This is exact if each determinant receives a single contribution and
+   *  the budget exceeds 4k entries, otherwise it is a heuristic (a partial
+   *  score may fall below the threshold).
+   */
+  void set_top_k(size_t k) { top_k_ = k; }
+
+  /// Reserve room for `n` entries (not limited by the budget)
+  void reserve(size_t n) {
+    size_t capacity = slots_.size();
+    while(capacity / 4 * 3 < n) capacity *= 2;
+    if(capacity != slots_.size()) rehash(capacity, -1.);
+  }
+
+  /// Remove all entries, keeps the capacity
+  void clear() {
+    std::fill(slots_.begin(), slots_.end(), value_type{WfnT(0), 0.});
+    size_ = 0;
+  }
+
+  /// Accumulate `rv` into the score of `state`
+  inline void insert(const WfnT& state, double rv) {
+    const size_t mask = slots_.size() - 1;
+    size_t i = home_slot(hash(state));
+    while(slots_[i].state.any()) {
+      if(slots_[i].state == state) {
+        slots_[i].rv += rv;
+        return;
+      }
+      i = (i + 1) & mask;
+    }
+
+    if(std::abs(rv) <= threshold_) {
+      ++ndiscarded_;
+      return;
+    }
+    if(size_ >= max_load()) {
+      make_room();
+      insert(state, rv);
+      return;
+    }
+    slots_[i] = {state, rv};
+    ++size_;
+  }
+
+  /// Accumulate a range of contributions
+  template <typename PairIterator>
+  void insert(PairIterator begin, PairIterator end) {
+    // Home slots are prefetched a few insertions ahead
+    constexpr ptrdiff_t prefetch_dist = 8;
+    const ptrdiff_t n = std::distance(begin, end);
+    for(ptrdiff_t i = 0; i < n; ++i) {
+      if(i + prefetch_dist < n)
+        __builtin_prefetch(
+            &slots_[home_slot(hash((begin + i + prefetch_dist)->state))]);
+      insert((begin + i)->state, (begin + i)->rv);
+    }
+  }
+
+  /// Apply `f` to all entries
+  template <typename Functor>
+  void for_each(Functor&& f) const {
+    for(const auto& p : slots_)
+      if(p.state.any()) f(p);
+  }
+
+  /**
+   *  @brief Apply `f` to all entries of a hash shard.
+   *
+   *  The shard of an entry is given by the `log2_nshards` high bits of its
+   *  hash. Only scans the slot range of the shard (and spills past its end).
+   */
+  template <typename Functor>
+  void for_each_in_shard(size_t ishard, unsigned log2_nshards,
+                         Functor&& f) const {
+    auto in_shard = [&](const value_type& p) {
+      return log2_nshards == 0 or (hash(p.state) >> (64 - log2_nshards)) ==
+                                      ishard;
+    };
+
+    const size_t capacity = slots_.size();
+    const size_t nshards = size_t(1) << log2_nshards;
+    if(capacity <= nshards) {
+      for(const auto& p : slots_)
+        if(p.state.any() and in_shard(p)) f(p);
+      return;
+    }
+
+    // Entries are stored at or after their home slot, spills past the end of
+    // the range are contiguous with it
+    const size_t mask = capacity - 1;
+    const size_t lo = ishard * (capacity / nshards);
+    const size_t hi = lo + capacity / nshards;
+    for(size_t i = lo; i < hi; ++i)
+      if(slots_[i].state.any() and in_shard(slots_[i])) f(slots_[i]);
+    for(size_t i = hi & mask; slots_[i].state.any(); i = (i + 1) & mask)
+      if(in_shard(slots_[i])) f(slots_[i]);
+  }
+};
+
+/**
+ *  @brief Merge hash tables of ASCI contributions into a list of unique
+ *  contributions.
+ *
+ *  Scores of determinants present in several tables are summed. The hash
+ *  shards are merged in parallel.
+ */
+template <typename WfnT>
+asci_contrib_container<WfnT> merge_asci_contrib_tables(
+    const std::vector<asci_contrib_hash_table<WfnT>>& tables) {
+  asci_contrib_container<WfnT> asci_pairs;
+  if(tables.size() == 1) {
+    asci_pairs.reserve(tables[0].size());
+    tables[0].for_each([&](const auto& p) { asci_pairs.push_back(p); });
+    return asci_pairs;
+  }
+
+  // Several shards per table for load balance
+  unsigned log2_nshards = 0;
+  while((size_t(1) << log2_nshards) < 4 * tables.size()) ++log2_nshards;
+  const size_t nshards = size_t(1) << log2_nshards;
+
+  size_t npairs = 0;
+#pragma omp parallel
+  {
+    asci_contrib_container<WfnT> asci_pairs_loc;
+    asci_contrib_hash_table<WfnT> shard_table(
+        std::numeric_limits<size_t>::max(), 0., log2_nshards);
+
+#pragma omp for schedule(dynamic)
+    for(size_t ishard = 0; ishard < nshards; ++ishard) {
+      shard_table.clear();
+      for(const auto& table : tables)
+        table.for_each_in_shard(ishard, log2_nshards, [&](const auto& p) {
+          shard_table.insert(p.state, p.rv);
+        });
+      shard_table.for_each([&](const auto& p) { asci_pairs_loc.push_back(p); });
+    }
+
+    concatenate_asci_pairs(asci_pairs_loc, asci_pairs, npairs);
+  }
+
+  return asci_pairs;
+}
+
+}  // namespace macis
@@ -36,6 +36,9 @@ void append_singles_asci_contributions(
   const auto LDV2 = LDV * LDV;
   for(auto i : occ_same)
     for(auto a : vir_same) {
+      // Skip symmetry forbidden excitations
+      if(!ham_gen.symmetry_allowed(i, a)) continue;
+
       // Compute single excitation matrix element
       double h_el = T_pq[a + i * LDT];
       const double* G_ov = G_kpq + a * LDG + i * LDG2;
@@ -87,6 +90,8 @@ void append_ss_doubles_asci_contributions(
         for(auto bb = aa + 1; bb < nvir; ++bb) {
           const auto j = ss_occ[jj];
           const auto b = vir[bb];
+          if(!ham_gen.symmetry_allowed(i, j, a, b)) continue;
+
           const auto jb = b + j * LDG;
           const auto G_aibj = G_ai[jb];
 
@@ -137,6 +142,8 @@ void append_os_doubles_asci_contributions(
       double sign_alpha = single_excitation_sign(state_alpha, a, i);
       for(auto j : occ_beta)
         for(auto b : vir_beta) {
+          if(!ham_gen.symmetry_allowed(i, j, a, b)) continue;
+
           const auto jb = b + j * LDV;
           const auto V_aibj = V_ai[jb * LDV2];
 
@@ -159,6 +166,104 @@ void append_os_doubles_asci_contributions(
     }      // AI loop
 }
 
+/**
+ *  @brief Same spin double contributions from heat-bath lists.
+ *
+ *  Generates the contributions of the overload on the antisymmetrized
+ *  integrals, screened by |coeff * G(a,i,b,j)| < `h_el_tol` rather than by
+ *  the integral alone (i.e. more aggressively). The excitations of each
+ *  occupied pair are visited in order of decreasing integral magnitude up to
+ *  the first one below the threshold, the lists must have been built for a
+ *  threshold <= `h_el_tol` / |coeff|.
+ */
+template <size_t N, size_t NShift>
+void append_ss_doubles_asci_contributions(
+    double coeff, wfn_t<2 * N> state_full, wfn_t<N> state_spin,
+    const std::vector<uint32_t>& ss_occ, const std::vector<uint32_t>& os_occ,
+    const double* eps_same, const heat_bath_doubles& hb, double h_el_tol,
+    double root_diag, double E0, HamiltonianGenerator<2 * N>& ham_gen,
+    asci_contrib_container<wfn_t<2 * N>>& asci_contributions) {
+  const double int_tol = h_el_tol / std::abs(coeff);
+  const size_t nocc = ss_occ.size();
+  for(size_t ii = 0; ii < nocc; ++ii)
+    for(size_t jj = ii + 1; jj < nocc; ++jj) {
+      const auto i = ss_occ[ii];
+      const auto j = ss_occ[jj];
+      const auto hb_end = hb.ss_end(i, j);
+      for(auto it = hb.ss_begin(i, j); it != hb_end; ++it) {
+        const auto [G_aibj, a, b] = *it;
+        if(std::abs(G_aibj) < int_tol) break;
+        if(state_spin[a] or state_spin[b]) continue;
+        if(!ham_gen.symmetry_allowed(i, j, a, b)) continue;
+
+        // Calculate excited determinant string (spin)
+        const auto full_ex_spin = wfn_t<N>(0).flip(i).flip(j).flip(a).flip(b);
+        auto ex_det_spin = state_spin ^ full_ex_spin;
+
+        // Calculate the sign in a canonical way
+        double sign = doubles_sign(state_spin, ex_det_spin, full_ex_spin);
+
+        // Calculate full excited determinant
+        const auto full_ex = expand_bitset<2 * N>(full_ex_spin) << NShift;
+        auto ex_det = state_full ^ full_ex;
+
+        // Update sign of matrix element
+        auto h_el = sign * G_aibj;
+
+        // Evaluate fast diagonal matrix element
+        auto h_diag =
+            ham_gen.fast_diag_ss_double(eps_same[i], eps_same[j], eps_same[a],
+                                        eps_same[b], i, j, a, b, root_diag);
+        h_el /= (E0 - h_diag);
+
+        // Append {det, c*h_el}
+        asci_contributions.push_back({ex_det, coeff * h_el});
+      }  // AB List
+    }    // IJ Loop
+}
+
+/**
+ *  @brief Opposite spin double contributions from heat-bath lists.
+ *
+ *  See the same spin overload, contributions are screened by
+ *  |coeff * V(a,i,b,j)| < `h_el_tol`.
+ */
+template <size_t N>
+void append_os_doubles_asci_contributions(
+    double coeff, wfn_t<2 * N> state_full, wfn_t<N> state_alpha,
+    wfn_t<N> state_beta, const std::vector<uint32_t>& occ_alpha,
+    const std::vector<uint32_t>& occ_beta, const double* eps_alpha,
+    const double* eps_beta, const heat_bath_doubles& hb, double h_el_tol,
+    double root_diag, double E0, HamiltonianGenerator<2 * N>& ham_gen,
+    asci_contrib_container<wfn_t<2 * N>>& asci_contributions) {
+  const double int_tol = h_el_tol / std::abs(coeff);
+  for(auto i : occ_alpha)
+    for(auto j : occ_beta) {
+      const auto hb_end = hb.os_end(i, j);
+      for(auto it = hb.os_begin(i, j); it != hb_end; ++it) {
+        const auto [V_aibj, a, b] = *it;
+        if(std::abs(V_aibj) < int_tol) break;
+        if(state_alpha[a] or state_beta[b]) continue;
+        if(!ham_gen.symmetry_allowed(i, j, a, b)) continue;
+
+        double sign_alpha = single_excitation_sign(state_alpha, a, i);
+        double sign_beta = single_excitation_sign(state_beta, b, j);
+        double sign = sign_alpha * sign_beta;
+        auto ex_det = state_full;
+        ex_det.flip(a).flip(i).flip(j + N).flip(b + N);
+        auto h_el = sign * V_aibj;
+
+        // Evaluate fast diagonal element
+        auto h_diag = ham_gen.fast_diag_os_double(eps_alpha[i], eps_beta[j],
+                                                  eps_alpha[a], eps_beta[b],
+                                                  i, j, a, b, root_diag);
+        h_el /= (E0 - h_diag);
+
+        asci_contributions.push_back({ex_det, coeff * h_el});
+      }  // AB List
+    }    // IJ Loop
+}
+
 template <size_t N, typename IndContainer>
 void generate_pairs(const IndContainer& inds, std::vector<wfn_t<N>>& w) {
   const size_t nind = inds.size();
@@ -13,14 +13,22 @@
 
 #include <chrono>
 #include <fstream>
+#include <optional>
+#include <macis/asci/contrib_hash_table.hpp>
 #include <macis/asci/determinant_contributions.hpp>
 #include <macis/asci/determinant_sort.hpp>
+#include <macis/hamiltonian_generator/alpha_sorted_dets.hpp>
 #include <macis/sd_operations.hpp>
+#include <macis/spin_flip.hpp>
 #include <macis/types.hpp>
 #include <macis/util/dist_quickselect.hpp>
 #include <macis/util/memory.hpp>
 #include <macis/util/mpi.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace macis {
 
 template <typename WfnT>
@@ -46,96 +54,306 @@ struct ASCISettings {
   bool grow_with_rot = false;
   size_t rot_size_start = 1000;
 
+  // Update H incrementally between ASCI iterations rather than regenerating
+  // (incompatible with spin_flip and the alternative CI Hamiltonians and
+  // storage options of MCSCFSettings, see check_ci_hamiltonian_settings)
+  bool reuse_hamiltonian = false;
+
+  // Work in the spin-flip adapted basis (Ms = 0, even parity, see
+  // spin_flip.hpp): wave functions only hold canonical representatives
+  bool spin_flip = false;
+
+  // Accumulate scores in hash tables (see contrib_hash_table.hpp) instead
+  // of storing all contributions and sorting / accumulating them
+  bool hash_accumulate = false;
+
+  // Streaming top-K selection (implies hash_accumulate): the slots of the
+  // score tables are bounded by pair_mem_max bytes (pair_size_max entries if
+  // zero). Once the budget is hit, the tables only keep their
+  // stream_top_k_factor * (NDETS_MAX - NCDETS) largest scores, contributions
+  // to new determinants below the resulting threshold are discarded
+  bool stream_top_k = false;
+  size_t pair_mem_max = 0;
+  double stream_top_k_factor = 2.;
+
+  // Hand out the constraints of the (MPI) constraint search dynamically,
+  // in order of decreasing estimated cost, rather than assigning them to
+  // ranks statically by the estimated cost
+  bool dynamic_constraints = false;
+
+  // Enumerate the same spin (and, in the standard search, opposite spin)
+  // double excitations through the heat-bath lists of the Hamiltonian
+  // generator (see heat_bath.hpp), such that the doubles of a determinant
+  // cost in proportion to the retained excitations. These are screened by
+  // |c * integral| < h_el_tol, whereas the default enumeration screens the
+  // integral alone, such that heat-bath searches drop more small
+  // contributions. Assumes normalized coefficients. The lists are built from
+  // the integrals of the generator, which must be those passed to the
+  // search, and take up to ~2.5x the memory of the integrals
+  bool heat_bath = false;
+
   // bool dist_triplet_random = false;
   int constraint_level = 2;  // Up To Quints
 };
 
+/**
+ *  @brief Restrict ASCI contributions to the spin-flip adapted basis.
+ *
+ *  Contributions to non canonical determinants are removed (the scores of
+ *  spin-flip partners are identical), the remaining ones are scaled to the
+ *  spin-flip adapted functions.
+ *
+ *  @returns The new end of the range
+ */
+template <typename PairIterator>
+PairIterator spin_flip_adapt_asci_pairs(PairIterator begin, PairIterator end) {
+  auto it = std::remove_if(begin, end, [](const auto& p) {
+    return not is_spin_flip_canonical(p.state);
+  });
+  std::for_each(begin, it,
+                [](auto& p) { p.rv *= 2. * spin_flip_norm(p.state); });
+  return it;
+}
+
+/**
+ *  @brief Prune a list of ASCI contributions down to `pair_size_max`.
+ *
+ *  Contributions below `rv_prune_tol` are removed first, duplicates are only
+ *  accumulated if this is not sufficient. No-op if the list is already small
+ *  enough.
+ */
+template <typename WfnT>
+void prune_asci_pairs(const ASCISettings& asci_settings, size_t pair_size_max,
+                      asci_contrib_container<WfnT>& asci_pairs, size_t i) {
+  if(asci_pairs.size() <= pair_size_max) return;
+  auto logger = spdlog::get("asci_search");
+
+  // Remove small contributions
+  auto it =
+      std::partition(asci_pairs.begin(), asci_pairs.end(), [&](const auto& x) {
+        return std::abs(x.rv) > asci_settings.rv_prune_tol;
+      });
+  asci_pairs.erase(it, asci_pairs.end());
+  logger->info("  * Pruning at DET = {} NSZ = {}", i, asci_pairs.size());
+
+  // Extra Pruning if not sufficient
+  if(asci_pairs.size() > pair_size_max) {
+    logger->info("    * Removing Duplicates");
+    sort_and_accumulate_asci_pairs(asci_pairs);
+    logger->info("    * NSZ = {}", asci_pairs.size());
+  }
+}
+
+/**
+ *  @brief Create the thread-local score tables of the ASCI contributions.
+ *
+ *  Each table receives an equal share of the budget. With `stream_top_k`,
+ *  the tables select the (multiple of the) `top_k` largest scores.
+ */
+template <typename WfnT>
+std::vector<asci_contrib_hash_table<WfnT>> make_asci_contrib_tables(
+    const ASCISettings& asci_settings, size_t ntables, size_t top_k) {
+  size_t max_size = asci_settings.pair_size_max;
+  if(asci_settings.stream_top_k and asci_settings.pair_mem_max) {
+    // Slots are filled to at most 3/4
+    max_size = asci_settings.pair_mem_max / sizeof(asci_contrib<WfnT>) / 4 * 3;
+  }
+
+  asci_contrib_hash_table<WfnT> table(std::max<size_t>(max_size / ntables, 1),
+                                      asci_settings.rv_prune_tol);
+  if(asci_settings.stream_top_k)
+    table.set_top_k(std::ceil(asci_settings.stream_top_k_factor * top_k));
+  return std::vector<asci_contrib_hash_table<WfnT>>(ntables, table);
+}
+
+/// Log the number of prunes of thread-local score tables
+template <typename WfnT>
+void log_asci_contrib_tables(
+    const std::vector<asci_contrib_hash_table<WfnT>>& tables) {
+  size_t npruned = 0, ndiscarded = 0;
+  double threshold = -1.;
+  for(const auto& table : tables) {
+    npruned += table.npruned();
+    ndiscarded += table.ndiscarded();
+    threshold = std::max(threshold, table.threshold());
+  }
+  auto logger = spdlog::get("asci_search");
+  if(npruned) logger->info("  * Pruned Score Tables {} Times", npruned);
+  if(ndiscarded)
+    logger->info("  * Discarded {} Contributions Below {:.2e}", ndiscarded,
+                 threshold);
+}
+
+/**
+ *  @brief Generate the ASCI contributions of a set of core determinants on a
+ *  single rank.
+ *
+ *  The core determinants are distributed over the OpenMP threads, each of
+ *  which appends into a thread-local container. Each thread prunes its
+ *  container against an equal share of `pair_size_max`, the containers are
+ *  concatenated in parallel once all determinants have been processed.
+ *
+ *  With `hash_accumulate`, the contributions of each determinant are
+ *  accumulated into a thread-local hash table instead (with the same budget),
+ *  the tables are merged into a list of unique contributions. With
+ *  `stream_top_k`, the tables only keep the contributions which may enter
+ *  the `top_k` largest scores once the budget is hit.
+ */
 template <size_t N>
 asci_contrib_container<wfn_t<N>> asci_contributions_standard(
     ASCISettings asci_settings, wavefunction_iterator_t<N> cdets_begin,
     wavefunction_iterator_t<N> cdets_end, const double E_ASCI,
     const std::vector<double>& C, size_t norb, const double* T_pq,
     const double* G_red, const double* V_red, const double* G_pqrs,
-    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen) {
-  auto logger = spdlog::get("asci_search");
-
+    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen,
+    size_t top_k = 0) {
   const size_t ncdets = std::distance(cdets_begin, cdets_end);
+  const double h_el_tol = asci_settings.h_el_tol;
+  if(asci_settings.stream_top_k) asci_settings.hash_accumulate = true;
 
   asci_contrib_container<wfn_t<N>> asci_pairs;
-  std::vector<uint32_t> occ_alpha, vir_alpha;
-  std::vector<uint32_t> occ_beta, vir_beta;
-  asci_pairs.reserve(asci_settings.pair_size_max);
-  for(size_t i = 0; i < ncdets; ++i) {
-    // Alias state data
-    auto state = *(cdets_begin + i);
-    auto state_alpha = bitset_lo_word(state);
-    auto state_beta = bitset_hi_word(state);
-    auto coeff = C[i];
-
-    // Get occupied and virtual indices
-    bitset_to_occ_vir(norb, state_alpha, occ_alpha, vir_alpha);
-    bitset_to_occ_vir(norb, state_beta, occ_beta, vir_beta);
-
-    // Precompute orbital energies
-    auto eps_alpha = ham_gen.single_orbital_ens(norb, occ_alpha, occ_beta);
-    auto eps_beta = ham_gen.single_orbital_ens(norb, occ_beta, occ_alpha);
-
-    // Compute base diagonal matrix element
-    double h_diag = ham_gen.matrix_element(state, state);
-
-    const double h_el_tol = asci_settings.h_el_tol;
-
-    // Singles - AA
-    append_singles_asci_contributions<(N / 2), 0>(
-        coeff, state, state_alpha, occ_alpha, vir_alpha, occ_beta,
-        eps_alpha.data(), T_pq, norb, G_red, norb, V_red, norb, h_el_tol,
-        h_diag, E_ASCI, ham_gen, asci_pairs);
-
-    // Singles - BB
-    append_singles_asci_contributions<(N / 2), (N / 2)>(
-        coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
-        eps_beta.data(), T_pq, norb, G_red, norb, V_red, norb, h_el_tol, h_diag,
-        E_ASCI, ham_gen, asci_pairs);
-
-    if(not asci_settings.just_singles) {
-      // Doubles - AAAA
-      append_ss_doubles_asci_contributions<N / 2, 0>(
+  if(!ncdets) return asci_pairs;
+
+  // Upper bound on the number of contributions of a single determinant
+  auto n_sd = [&](size_t nocc) {
+    const size_t nvir = norb - nocc;
+    return std::make_pair(nocc * nvir,
+                          nocc * (nocc - 1) * nvir * (nvir - 1) / 4);
+  };
+  const auto [n_sing_alpha, n_doub_alpha] =
+      n_sd(bitset_lo_word(*cdets_begin).count());
+  const auto [n_sing_beta, n_doub_beta] =
+      n_sd(bitset_hi_word(*cdets_begin).count());
+  const size_t max_size_det = n_sing_alpha + n_sing_beta + n_doub_alpha +
+                              n_doub_beta + n_sing_alpha * n_sing_beta;
+
+  // Heat-bath lists are built outside of the parallel region
+  const heat_bath_doubles* hb = nullptr;
+  if(asci_settings.heat_bath and not asci_settings.just_singles)
+    hb = &ham_gen.heat_bath(h_el_tol);
+
+  size_t npairs = 0;
+  std::vector<asci_contrib_hash_table<wfn_t<N>>> tables;
+
+#pragma omp parallel
+  {
+#ifdef _OPENMP
+    const size_t nthreads = omp_get_num_threads();
+    const size_t ithread = omp_get_thread_num();
+#else
+    const size_t nthreads = 1;
+    const size_t ithread = 0;
+#endif
+    const size_t pair_size_max_loc =
+        std::max<size_t>(asci_settings.pair_size_max / nthreads, 1);
+
+    asci_contrib_container<wfn_t<N>> asci_pairs_loc;
+    std::vector<uint32_t> occ_alpha, vir_alpha;
+    std::vector<uint32_t> occ_beta, vir_beta;
+    if(asci_settings.hash_accumulate) {
+      // Only holds the contributions of a single determinant
+      asci_pairs_loc.reserve(max_size_det);
+#pragma omp single
+      tables =
+          make_asci_contrib_tables<wfn_t<N>>(asci_settings, nthreads, top_k);
+    } else {
+      asci_pairs_loc.reserve(std::min(
+          pair_size_max_loc, (ncdets / nthreads + 1) * max_size_det));
+    }
+
+#pragma omp for schedule(dynamic)
+    for(size_t i = 0; i < ncdets; ++i) {
+      const size_t size_before = asci_pairs_loc.size();
+
+      // Alias state data
+      auto state = *(cdets_begin + i);
+      auto state_alpha = bitset_lo_word(state);
+      auto state_beta = bitset_hi_word(state);
+      auto coeff = C[i];
+
+      // Get occupied and virtual indices
+      bitset_to_occ_vir(norb, state_alpha, occ_alpha, vir_alpha);
+      bitset_to_occ_vir(norb, state_beta, occ_beta, vir_beta);
+
+      // Precompute orbital energies
+      auto eps_alpha = ham_gen.single_orbital_ens(norb, occ_alpha, occ_beta);
+      auto eps_beta = ham_gen.single_orbital_ens(norb, occ_beta, occ_alpha);
+
+      // Compute base diagonal matrix element
+      double h_diag = ham_gen.matrix_element(state, state);
+
+      // Singles - AA
+      append_singles_asci_contributions<(N / 2), 0>(
           coeff, state, state_alpha, occ_alpha, vir_alpha, occ_beta,
-          eps_alpha.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
-          asci_pairs);
+          eps_alpha.data(), T_pq, norb, G_red, norb, V_red, norb, h_el_tol,
+          h_diag, E_ASCI, ham_gen, asci_pairs_loc);
 
-      // Doubles - BBBB
-      append_ss_doubles_asci_contributions<N / 2, N / 2>(
+      // Singles - BB
+      append_singles_asci_contributions<(N / 2), (N / 2)>(
           coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
-          eps_beta.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
-          asci_pairs);
-
-      // Doubles - AABB
-      append_os_doubles_asci_contributions(
-          coeff, state, state_alpha, state_beta, occ_alpha, occ_beta, vir_alpha,
-          vir_beta, eps_alpha.data(), eps_beta.data(), V_pqrs, norb, h_el_tol,
-          h_diag, E_ASCI, ham_gen, asci_pairs);
-    }
+          eps_beta.data(), T_pq, norb, G_red, norb, V_red, norb, h_el_tol,
+          h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+
+      if(hb) {
+        // Doubles - AAAA / BBBB / AABB through the heat-bath lists
+        append_ss_doubles_asci_contributions<N / 2, 0>(
+            coeff, state, state_alpha, occ_alpha, occ_beta, eps_alpha.data(),
+            *hb, h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+        append_ss_doubles_asci_contributions<N / 2, N / 2>(
+            coeff, state, state_beta, occ_beta, occ_alpha, eps_beta.data(),
+            *hb, h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+        append_os_doubles_asci_contributions(
+            coeff, state, state_alpha, state_beta, occ_alpha, occ_beta,
+            eps_alpha.data(), eps_beta.data(), *hb, h_el_tol, h_diag, E_ASCI,
+            ham_gen, asci_pairs_loc);
+      } else if(not asci_settings.just_singles) {
+        // Doubles - AAAA
+        append_ss_doubles_asci_contributions<N / 2, 0>(
+            coeff, state, state_alpha, occ_alpha, vir_alpha, occ_beta,
+            eps_alpha.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
+            asci_pairs_loc);
+
+        // Doubles - BBBB
+        append_ss_doubles_asci_contributions<N / 2, N / 2>(
+            coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
+            eps_beta.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
+            asci_pairs_loc);
+
+        // Doubles - AABB
+        append_os_doubles_asci_contributions(
+            coeff, state, state_alpha, state_beta, occ_alpha, occ_beta,
+            vir_alpha, vir_beta, eps_alpha.data(), eps_beta.data(), V_pqrs,
+            norb, h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+      }
 
-    // Prune Down Contributions
-    if(asci_pairs.size() > asci_settings.pair_size_max) {
-      // Remove small contributions
-      auto it = std::partition(
-          asci_pairs.begin(), asci_pairs.end(), [=](const auto& x) {
-            return std::abs(x.rv) > asci_settings.rv_prune_tol;
-          });
-      asci_pairs.erase(it, asci_pairs.end());
-      logger->info("  * Pruning at DET = {} NSZ = {}", i, asci_pairs.size());
-
-      // Extra Pruning if not sufficient
-      if(asci_pairs.size() > asci_settings.pair_size_max) {
-        logger->info("    * Removing Duplicates");
-        sort_and_accumulate_asci_pairs(asci_pairs);
-        logger->info("    * NSZ = {}", asci_pairs.size());
+      if(asci_settings.spin_flip) {
+        asci_pairs_loc.erase(
+            spin_flip_adapt_asci_pairs(asci_pairs_loc.begin() + size_before,
+                                       asci_pairs_loc.end()),
+            asci_pairs_loc.end());
       }
 
-    }  // Pruning
-  }    // Loop over search determinants
+      if(asci_settings.hash_accumulate) {
+        tables[ithread].insert(asci_pairs_loc.begin(), asci_pairs_loc.end());
+        asci_pairs_loc.clear();
+      } else {
+        // Prune Down Contributions
+        prune_asci_pairs(asci_settings, pair_size_max_loc, asci_pairs_loc, i);
+      }
+    }  // Loop over search determinants
+
+    if(not asci_settings.hash_accumulate)
+      concatenate_asci_pairs(asci_pairs_loc, asci_pairs, npairs);
+  }
+
+  if(asci_settings.hash_accumulate) {
+    log_asci_contrib_tables(tables);
+    return merge_asci_contrib_tables(tables);
+  }
+
+  // Pruning does not guarantee that each thread stays within its share
+  prune_asci_pairs(asci_settings, asci_settings.pair_size_max, asci_pairs,
+                   ncdets);
 
   return asci_pairs;
 }
@@ -147,78 +365,43 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
     wavefunction_iterator_t<N> cdets_end, const double E_ASCI,
     const std::vector<double>& C, size_t norb, const double* T_pq,
     const double* G_red, const double* V_red, const double* G_pqrs,
-    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen, MPI_Comm comm) {
+    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen, MPI_Comm comm,
+    size_t top_k = 0, constraint_histogram_cache<N>* con_cache = nullptr,
+    alpha_sorted_dets<N>* cdets_sorted = nullptr) {
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double, std::milli>;
 
   auto logger = spdlog::get("asci_search");
   const size_t ncdets = std::distance(cdets_begin, cdets_end);
+  if(asci_settings.stream_top_k) asci_settings.hash_accumulate = true;
 
   asci_contrib_container<wfn_t<N>> asci_pairs;
-  std::vector<uint32_t> occ_alpha, vir_alpha;
-  std::vector<uint32_t> occ_beta, vir_beta;
-
-  // Get unique alpha strings
-  std::vector<wfn_t<N>> uniq_alpha_wfn(cdets_begin, cdets_end);
-  std::transform(uniq_alpha_wfn.begin(), uniq_alpha_wfn.end(),
-                 uniq_alpha_wfn.begin(),
-                 [=](const auto& w) { return w & full_mask<N / 2, N>(); });
-  std::sort(uniq_alpha_wfn.begin(), uniq_alpha_wfn.end(),
-            bitset_less_comparator<N>{});
-  {
-    auto it = std::unique(uniq_alpha_wfn.begin(), uniq_alpha_wfn.end());
-    uniq_alpha_wfn.erase(it, uniq_alpha_wfn.end());
-  }
-  const size_t nuniq_alpha = uniq_alpha_wfn.size();
-
-  // For each unique alpha, create a list of beta string and store metadata
-  struct beta_coeff_data {
-    wfn_t<N> beta_string;
-    std::vector<uint32_t> occ_beta;
-    std::vector<uint32_t> vir_beta;
-    std::vector<double> orb_ens_alpha;
-    std::vector<double> orb_ens_beta;
-    double coeff;
-    double h_diag;
-
-    beta_coeff_data(double c, size_t norb,
-                    const std::vector<uint32_t>& occ_alpha, wfn_t<N> w,
-                    const HamiltonianGenerator<N>& ham_gen) {
-      coeff = c;
-
-      // Compute Beta string
-      const auto beta_shift = w >> N / 2;
-      // Reduce the number of times things shift in inner loop
-      beta_string = beta_shift << N / 2;
-
-      // Compute diagonal matrix element
-      h_diag = ham_gen.matrix_element(w, w);
-
-      // Compute occ/vir for beta string
-      bitset_to_occ_vir(norb, beta_shift, occ_beta, vir_beta);
 
-      // Precompute orbital energies
-      orb_ens_alpha = ham_gen.single_orbital_ens(norb, occ_alpha, occ_beta);
-      orb_ens_beta = ham_gen.single_orbital_ens(norb, occ_beta, occ_alpha);
-    }
-  };
-
-  struct unique_alpha_data {
-    std::vector<beta_coeff_data> bcd;
-  };
-
-  std::vector<unique_alpha_data> uad(nuniq_alpha);
-  for(auto i = 0; i < nuniq_alpha; ++i) {
-    const auto wfn_a = uniq_alpha_wfn[i];
-    std::vector<uint32_t> occ_alpha, vir_alpha;
-    bitset_to_occ_vir(norb, wfn_a, occ_alpha, vir_alpha);
-    for(auto j = 0; j < ncdets; ++j) {
-      const auto w = *(cdets_begin + j);
-      if((w & full_mask<N / 2, N>()) == wfn_a) {
-        uad[i].bcd.emplace_back(C[j], norb, occ_alpha, w, ham_gen);
-      }
-    }
+  // Group the search determinants by unique alpha string, unless the store
+  // is given by the caller (see asci_iter), and precompute the data of their
+  // excitations
+  alpha_sorted_dets<N> cdets_sorted_loc;
+  if(!cdets_sorted) {
+    cdets_sorted_loc = alpha_sorted_dets<N>(cdets_begin, cdets_end);
+    cdets_sorted = &cdets_sorted_loc;
   }
+  if(cdets_sorted->ndets != ncdets)
+    throw std::runtime_error("Determinant store does not match the search");
+  if(!cdets_sorted->has_excitation_data())
+    cdets_sorted->compute_excitation_data(norb, ham_gen);
+  const auto& cdets_store = *cdets_sorted;
+  const double* cdets_C = C.data();  // C is shadowed by the constraints
+
+  const size_t nuniq_alpha = cdets_store.ngroups();
+  std::vector<wfn_t<N>> uniq_alpha_wfn(nuniq_alpha);
+  for(size_t i = 0; i < nuniq_alpha; ++i)
+    uniq_alpha_wfn[i] = cdets_store.alpha_det(i);
+
+  // Heat-bath lists for the BBBB doubles of alpha strings which satisfy a
+  // constraint (the constrained excitations are already restricted)
+  const heat_bath_doubles* hb = nullptr;
+  if(asci_settings.heat_bath)
+    hb = &ham_gen.heat_bath(asci_settings.h_el_tol);
 
   auto world_rank = comm_rank(comm);
   auto world_size = comm_size(comm);
@@ -254,10 +437,22 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
     logger->info("  * Will Generate up to {}", cl_string);
   }
 
+  // Constraint histograms are updated incrementally from `con_cache` (owned
+  // by the caller and kept between ASCI iterations) if it is given
   auto gen_c_st = clock_type::now();
-  auto constraints =
-      dist_constraint_general(asci_settings.constraint_level, norb,
-                              n_sing_alpha, n_doub_alpha, uniq_alpha_wfn, comm);
+  std::vector<wfn_constraint<N>> constraints;
+  if(asci_settings.dynamic_constraints) {
+    // All ranks hold all constraints, sorted by decreasing estimated cost
+    auto constraint_sizes = generate_constraint_general(
+        asci_settings.constraint_level, norb, n_sing_alpha, n_doub_alpha,
+        uniq_alpha_wfn, world_size, con_cache, comm);
+    constraints.reserve(constraint_sizes.size());
+    for(const auto& [c, nw] : constraint_sizes) constraints.push_back(c);
+  } else {
+    constraints = dist_constraint_general(
+        asci_settings.constraint_level, norb, n_sing_alpha, n_doub_alpha,
+        uniq_alpha_wfn, comm, con_cache);
+  }
   auto gen_c_en = clock_type::now();
   duration_type gen_c_dur = gen_c_en - gen_c_st;
   logger->info("  * GEN_DUR = {:.2e} ms", gen_c_dur.count());
@@ -267,130 +462,232 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
                                        2 * n_doub_alpha +  // AAAA + BBBB
                                        n_sing_alpha * n_sing_alpha  // AABB
                                        ));
-  asci_pairs.reserve(max_size);
-
-  // Process ASCI pair contributions for each constraint
-  for(auto con : constraints) {
-    auto size_before = asci_pairs.size();
-
-    const double h_el_tol = asci_settings.h_el_tol;
-    const auto& [C, B, C_min] = con;
-    wfn_t<N> O = full_mask<N>(norb);
-
-    // Loop over unique alpha strings
-    for(size_t i_alpha = 0; i_alpha < nuniq_alpha; ++i_alpha) {
-      const auto& det = uniq_alpha_wfn[i_alpha];
-      const auto occ_alpha = bits_to_indices(det);
-
-      // AA excitations
-      for(const auto& bcd : uad[i_alpha].bcd) {
-        const auto& beta = bcd.beta_string;
-        const auto& coeff = bcd.coeff;
-        const auto& h_diag = bcd.h_diag;
-        const auto& occ_beta = bcd.occ_beta;
-        const auto& orb_ens_alpha = bcd.orb_ens_alpha;
-        generate_constraint_singles_contributions_ss(
-            coeff, det, C, O, B, beta, occ_alpha, occ_beta,
-            orb_ens_alpha.data(), T_pq, norb, G_red, norb, V_red, norb,
-            h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs);
-      }
+  const size_t ncon = constraints.size();
+  size_t npairs = 0;
+
+  // Shared counter of the next constraint in the dynamic mode, which is
+  // updated by all threads (one at a time)
+  std::optional<mpi_shared_counter> next_con;
+  if(asci_settings.dynamic_constraints) {
+#ifdef _OPENMP
+    int thread_level;
+    MPI_Query_thread(&thread_level);
+    if(thread_level < MPI_THREAD_SERIALIZED and omp_get_max_threads() > 1)
+      throw std::runtime_error(
+          "dynamic_constraints requires MPI_THREAD_SERIALIZED with OpenMP");
+#endif
+    next_con.emplace(comm);
+  }
 
-      // AAAA excitations
-      for(const auto& bcd : uad[i_alpha].bcd) {
-        const auto& beta = bcd.beta_string;
-        const auto& coeff = bcd.coeff;
-        const auto& h_diag = bcd.h_diag;
-        const auto& occ_beta = bcd.occ_beta;
-        const auto& orb_ens_alpha = bcd.orb_ens_alpha;
-        generate_constraint_doubles_contributions_ss(
-            coeff, det, C, O, B, beta, occ_alpha, occ_beta,
-            orb_ens_alpha.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI,
-            ham_gen, asci_pairs);
-      }
+  std::vector<asci_contrib_hash_table<wfn_t<N>>> tables;
+
+  // Constraints are distributed over the threads, each of which appends into
+  // a thread-local container. Constraints generate disjoint sets of
+  // determinants, such that the per-constraint S&A is exact within each
+  // thread. Pruning is performed against an equal share of pair_size_max.
+  // With hash_accumulate, the contributions of each alpha string are
+  // accumulated into thread-local hash tables instead.
+  //
+  // In the dynamic mode, each thread fetches one constraint at a time from the
+  // shared counter until all constraints are taken, such that threads and
+  // ranks which are done early take over the remaining constraints.
+#pragma omp parallel
+  {
+#ifdef _OPENMP
+    const size_t nthreads = omp_get_num_threads();
+    const size_t ithread = omp_get_thread_num();
+#else
+    const size_t nthreads = 1;
+    const size_t ithread = 0;
+#endif
+    const size_t pair_size_max_loc =
+        std::max<size_t>(asci_settings.pair_size_max / nthreads, 1);
+
+    asci_contrib_container<wfn_t<N>> asci_pairs_loc;
+    if(asci_settings.hash_accumulate) {
+#pragma omp single
+      tables =
+          make_asci_contrib_tables<wfn_t<N>>(asci_settings, nthreads, top_k);
+    } else {
+      asci_pairs_loc.reserve(max_size / nthreads);
+    }
 
-      // AABB excitations
-      for(const auto& bcd : uad[i_alpha].bcd) {
-        const auto& beta = bcd.beta_string;
-        const auto& coeff = bcd.coeff;
-        const auto& h_diag = bcd.h_diag;
-        const auto& occ_beta = bcd.occ_beta;
-        const auto& vir_beta = bcd.vir_beta;
-        const auto& orb_ens_alpha = bcd.orb_ens_alpha;
-        const auto& orb_ens_beta = bcd.orb_ens_beta;
-        generate_constraint_doubles_contributions_os(
-            coeff, det, C, O, B, beta, occ_alpha, occ_beta, vir_beta,
-            orb_ens_alpha.data(), orb_ens_beta.data(), V_pqrs, norb, h_el_tol,
-            h_diag, E_ASCI, ham_gen, asci_pairs);
-      }
+    // ASCI pair contributions of a constraint
+    auto process_constraint = [&](size_t i_con) {
+      const auto& con = constraints[i_con];
+      auto size_before = asci_pairs_loc.size();
+
+      const double h_el_tol = asci_settings.h_el_tol;
+      const auto& [C, B, C_min] = con;
+      wfn_t<N> O = full_mask<N>(norb);
+
+      // Loop over unique alpha strings
+      for(size_t i_alpha = 0; i_alpha < nuniq_alpha; ++i_alpha) {
+        const size_t size_alpha = asci_pairs_loc.size();
+        const auto& det = uniq_alpha_wfn[i_alpha];
+        const auto& occ_alpha = cdets_store.alpha_occ[i_alpha];
+        const size_t j_st = cdets_store.alpha_ptr[i_alpha];
+        const size_t j_en = cdets_store.alpha_ptr[i_alpha + 1];
+
+        // AA excitations
+        for(size_t j = j_st; j < j_en; ++j) {
+          const auto beta = cdets_store.beta_det(j);
+          const auto coeff = cdets_C[cdets_store.index[j]];
+          const auto h_diag = cdets_store.h_diag[j];
+          const auto& occ_beta = cdets_store.beta_occ[j];
+          const auto& orb_ens_alpha = cdets_store.orb_ens_alpha[j];
+          generate_constraint_singles_contributions_ss(
+              coeff, det, C, O, B, beta, occ_alpha, occ_beta,
+              orb_ens_alpha.data(), T_pq, norb, G_red, norb, V_red, norb,
+              h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+        }
 
-      // If the alpha determinant satisfies the constraint,
-      // append BB and BBBB excitations
-      if(satisfies_constraint(det, C, C_min)) {
-        for(const auto& bcd : uad[i_alpha].bcd) {
-          const auto& beta = bcd.beta_string;
-          const auto& coeff = bcd.coeff;
-          const auto& h_diag = bcd.h_diag;
-          const auto& occ_beta = bcd.occ_beta;
-          const auto& vir_beta = bcd.vir_beta;
-          const auto& eps_beta = bcd.orb_ens_beta;
-
-          const auto state = det | beta;
-          const auto state_beta = bitset_hi_word(beta);
-          // BB Excitations
-          append_singles_asci_contributions<(N / 2), (N / 2)>(
-              coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
-              eps_beta.data(), T_pq, norb, G_red, norb, V_red, norb, h_el_tol,
-              h_diag, E_ASCI, ham_gen, asci_pairs);
-
-          // BBBB Excitations
-          append_ss_doubles_asci_contributions<N / 2, N / 2>(
-              coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
-              eps_beta.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
-              asci_pairs);
-
-        }  // Beta Loop
-      }    // Triplet Check
-
-      // Prune Down Contributions
-      if(asci_pairs.size() > asci_settings.pair_size_max) {
-        // Remove small contributions
-        auto it = std::partition(
-            asci_pairs.begin(), asci_pairs.end(), [=](const auto& x) {
-              return std::abs(x.rv) > asci_settings.rv_prune_tol;
-            });
-        asci_pairs.erase(it, asci_pairs.end());
-
-        auto c_indices = bits_to_indices(C);
-        std::string c_string;
-        for(int i = 0; i < c_indices.size(); ++i)
-          c_string += std::to_string(c_indices[i]) + " ";
-        logger->info("  * Pruning at CON = {}, NSZ = {}", c_string,
-                     asci_pairs.size());
-
-        // Extra Pruning if not sufficient
-        if(asci_pairs.size() > asci_settings.pair_size_max) {
-          logger->info("    * Removing Duplicates");
-          auto uit = sort_and_accumulate_asci_pairs(
-              asci_pairs.begin() + size_before, asci_pairs.end());
-          asci_pairs.erase(uit, asci_pairs.end());
-          logger->info("    * NSZ = {}", asci_pairs.size());
+        // AAAA excitations
+        for(size_t j = j_st; j < j_en; ++j) {
+          const auto beta = cdets_store.beta_det(j);
+          const auto coeff = cdets_C[cdets_store.index[j]];
+          const auto h_diag = cdets_store.h_diag[j];
+          const auto& occ_beta = cdets_store.beta_occ[j];
+          const auto& orb_ens_alpha = cdets_store.orb_ens_alpha[j];
+          generate_constraint_doubles_contributions_ss(
+              coeff, det, C, O, B, beta, occ_alpha, occ_beta,
+              orb_ens_alpha.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI,
+              ham_gen, asci_pairs_loc);
         }
 
-      }  // Pruning
-    }    // Unique Alpha Loop
+        // AABB excitations
+        for(size_t j = j_st; j < j_en; ++j) {
+          const auto beta = cdets_store.beta_det(j);
+          const auto coeff = cdets_C[cdets_store.index[j]];
+          const auto h_diag = cdets_store.h_diag[j];
+          const auto& occ_beta = cdets_store.beta_occ[j];
+          const auto& vir_beta = cdets_store.beta_vir[j];
+          const auto& orb_ens_alpha = cdets_store.orb_ens_alpha[j];
+          const auto& orb_ens_beta = cdets_store.orb_ens_beta[j];
+          generate_constraint_doubles_contributions_os(
+              coeff, det, C, O, B, beta, occ_alpha, occ_beta, vir_beta,
+              orb_ens_alpha.data(), orb_ens_beta.data(), V_pqrs, norb,
+              h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+        }
 
-    // Local S&A for each quad
-    {
-      auto uit = sort_and_accumulate_asci_pairs(
-          asci_pairs.begin() + size_before, asci_pairs.end());
-      asci_pairs.erase(uit, asci_pairs.end());
+        // If the alpha determinant satisfies the constraint,
+        // append BB and BBBB excitations
+        if(satisfies_constraint(det, C, C_min)) {
+          for(size_t j = j_st; j < j_en; ++j) {
+            const auto beta = cdets_store.beta_det(j);
+            const auto coeff = cdets_C[cdets_store.index[j]];
+            const auto h_diag = cdets_store.h_diag[j];
+            const auto& occ_beta = cdets_store.beta_occ[j];
+            const auto& vir_beta = cdets_store.beta_vir[j];
+            const auto& eps_beta = cdets_store.orb_ens_beta[j];
+
+            const auto state = det | beta;
+            const auto state_beta = bitset_hi_word(beta);
+            // BB Excitations
+            append_singles_asci_contributions<(N / 2), (N / 2)>(
+                coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
+                eps_beta.data(), T_pq, norb, G_red, norb, V_red, norb,
+                h_el_tol, h_diag, E_ASCI, ham_gen, asci_pairs_loc);
+
+            // BBBB Excitations
+            if(hb)
+              append_ss_doubles_asci_contributions<N / 2, N / 2>(
+                  coeff, state, state_beta, occ_beta, occ_alpha,
+                  eps_beta.data(), *hb, h_el_tol, h_diag, E_ASCI, ham_gen,
+                  asci_pairs_loc);
+            else
+              append_ss_doubles_asci_contributions<N / 2, N / 2>(
+                  coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
+                  eps_beta.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI,
+                  ham_gen, asci_pairs_loc);
+
+          }  // Beta Loop
+        }    // Triplet Check
+
+        if(asci_settings.spin_flip) {
+          asci_pairs_loc.erase(
+              spin_flip_adapt_asci_pairs(asci_pairs_loc.begin() + size_alpha,
+                                         asci_pairs_loc.end()),
+              asci_pairs_loc.end());
+        }
+
+        // Accumulate into the score table or prune down contributions
+        if(asci_settings.hash_accumulate) {
+          tables[ithread].insert(asci_pairs_loc.begin(),
+                                 asci_pairs_loc.end());
+          asci_pairs_loc.clear();
+        } else if(asci_pairs_loc.size() > pair_size_max_loc) {
+          // Remove small contributions
+          auto it = std::partition(asci_pairs_loc.begin(),
+                                   asci_pairs_loc.end(), [=](const auto& x) {
+                                     return std::abs(x.rv) >
+                                            asci_settings.rv_prune_tol;
+                                   });
+          asci_pairs_loc.erase(it, asci_pairs_loc.end());
+
+          auto c_indices = bits_to_indices(C);
+          std::string c_string;
+          for(int i = 0; i < c_indices.size(); ++i)
+            c_string += std::to_string(c_indices[i]) + " ";
+          logger->info("  * Pruning at CON = {}, NSZ = {}", c_string,
+                       asci_pairs_loc.size());
+
+          // Extra Pruning if not sufficient
+          if(asci_pairs_loc.size() > pair_size_max_loc) {
+            logger->info("    * Removing Duplicates");
+            auto uit = sort_and_accumulate_asci_pairs(
+                asci_pairs_loc.begin() + size_before, asci_pairs_loc.end());
+            asci_pairs_loc.erase(uit, asci_pairs_loc.end());
+            logger->info("    * NSZ = {}", asci_pairs_loc.size());
+          }
+
+        }  // Pruning
+      }    // Unique Alpha Loop
+
+      // Local S&A for each quad
+      if(not asci_settings.hash_accumulate) {
+        auto uit = sort_and_accumulate_asci_pairs(
+            asci_pairs_loc.begin() + size_before, asci_pairs_loc.end());
+        asci_pairs_loc.erase(uit, asci_pairs_loc.end());
+      }
+    };
+
+    if(next_con) {
+      // Each thread claims the next constraint when it is done with its
+      // previous one (no per-batch synchronization)
+      for(;;) {
+        size_t i_con;
+#pragma omp critical(asci_next_constraint)
+        i_con = next_con->fetch_add(1);
+        if(i_con >= ncon) break;
+        process_constraint(i_con);
+      }
+    } else {
+#pragma omp for schedule(dynamic)
+      for(size_t i_con = 0; i_con < ncon; ++i_con) process_constraint(i_con);
     }
-  }  // Constraint Loop
+
+    if(not asci_settings.hash_accumulate)
+      concatenate_asci_pairs(asci_pairs_loc, asci_pairs, npairs);
+  }
+
+  if(asci_settings.hash_accumulate) {
+    log_asci_contrib_tables(tables);
+    return merge_asci_contrib_tables(tables);
+  }
 
   return asci_pairs;
 }
 #endif
 
+/**
+ *  @brief Select the `ndets_max` determinants of the next ASCI space from
+ *  the core determinants [`cdets_begin`, `cdets_end`).
+ *
+ *  `cdets_sorted` is an optional alpha-sorted store of the core
+ *  determinants (see asci_iter), which the constraint search uses instead
+ *  of grouping them again. Its excitation data is computed if absent.
+ */
 template <size_t N>
 std::vector<wfn_t<N>> asci_search(
     ASCISettings asci_settings, size_t ndets_max,
@@ -399,7 +696,9 @@ std::vector<wfn_t<N>> asci_search(
     const std::vector<double>& C, size_t norb, const double* T_pq,
     const double* G_red, const double* V_red, const double* G_pqrs,
     const double* V_pqrs,
-    HamiltonianGenerator<N>& ham_gen MACIS_MPI_CODE(, MPI_Comm comm)) {
+    HamiltonianGenerator<N>& ham_gen MACIS_MPI_CODE(, MPI_Comm comm),
+    constraint_histogram_cache<N>* con_cache = nullptr,
+    alpha_sorted_dets<N>* cdets_sorted = nullptr) {
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double>;
 
@@ -435,8 +734,29 @@ std::vector<wfn_t<N>> asci_search(
   logger->info(
       "  NCDETS = {:6}, NDETS_MAX = {:9}, H_EL_TOL = {:4e}, RV_TOL = {:4e}",
       ncdets, ndets_max, asci_settings.h_el_tol, asci_settings.rv_prune_tol);
-  logger->info("  MAX_RV_SIZE = {}, JUST_SINGLES = {}",
-               asci_settings.pair_size_max, asci_settings.just_singles);
+  logger->info(
+      "  MAX_RV_SIZE = {}, JUST_SINGLES = {}, SPIN_FLIP = {}, HASH_ACC = {}",
+      asci_settings.pair_size_max, asci_settings.just_singles,
+      asci_settings.spin_flip, asci_settings.hash_accumulate);
+  if(asci_settings.stream_top_k)
+    logger->info("  STREAM_TOP_K: MAX_RV_MEM = {:.2e} GiB, TOP_K_FACTOR = {}",
+                 asci_settings.pair_mem_max / 1024. / 1024. / 1024.,
+                 asci_settings.stream_top_k_factor);
+
+  // Only do top-K on (ndets_max - ncdets) b/c CDETS will be added later
+  const size_t top_k_elements = ndets_max - ncdets;
+
+  // In the spin-flip adapted basis, the contributions are generated from the
+  // determinant expansion of the core space
+  std::vector<wfn_t<N>> sf_cdets;
+  std::vector<double> sf_C;
+  if(asci_settings.spin_flip) {
+    std::tie(sf_cdets, sf_C) =
+        spin_flip_unfold<N>(cdets_begin, cdets_end, C.data());
+  }
+  auto search_begin = asci_settings.spin_flip ? sf_cdets.begin() : cdets_begin;
+  auto search_end = asci_settings.spin_flip ? sf_cdets.end() : cdets_end;
+  const auto& search_C = asci_settings.spin_flip ? sf_C : C;
 
   MACIS_MPI_CODE(MPI_Barrier(comm);)
   auto asci_search_st = clock_type::now();
@@ -446,13 +766,14 @@ std::vector<wfn_t<N>> asci_search(
   asci_contrib_container<wfn_t<N>> asci_pairs;
   if(world_size == 1)
     asci_pairs = asci_contributions_standard(
-        asci_settings, cdets_begin, cdets_end, E_ASCI, C, norb, T_pq, G_red,
-        V_red, G_pqrs, V_pqrs, ham_gen);
+        asci_settings, search_begin, search_end, E_ASCI, search_C, norb, T_pq,
+        G_red, V_red, G_pqrs, V_pqrs, ham_gen, top_k_elements);
 #ifdef MACIS_ENABLE_MPI
   else
     asci_pairs = asci_contributions_constraint(
-        asci_settings, cdets_begin, cdets_end, E_ASCI, C, norb, T_pq, G_red,
-        V_red, G_pqrs, V_pqrs, ham_gen MACIS_MPI_CODE(, comm));
+        asci_settings, search_begin, search_end, E_ASCI, search_C, norb, T_pq,
+        G_red, V_red, G_pqrs, V_pqrs, ham_gen, comm, top_k_elements,
+        con_cache, asci_settings.spin_flip ? nullptr : cdets_sorted);
 #endif
   auto pairs_en = clock_type::now();
 
@@ -495,7 +816,9 @@ std::vector<wfn_t<N>> asci_search(
   // Accumulate unique score contributions
   // MPI + Constraint Search already does S&A
   auto bit_sort_st = clock_type::now();
-  if(world_size == 1) sort_and_accumulate_asci_pairs(asci_pairs);
+  if(world_size == 1 and not asci_settings.hash_accumulate and
+     not asci_settings.stream_top_k)
+    sort_and_accumulate_asci_pairs(asci_pairs);
   auto bit_sort_en = clock_type::now();
 
   {
@@ -526,26 +849,23 @@ std::vector<wfn_t<N>> asci_search(
   }
 
   auto keep_large_st = clock_type::now();
-  // Finalize scores
-  for(auto& x : asci_pairs) x.rv = -std::abs(x.rv);
-
-  // Insert all dets with their coefficients as seeds
-  for(size_t i = 0; i < ncdets; ++i) {
-    auto state = *(cdets_begin + i);
-    asci_pairs.push_back({state, std::abs(C[i])});
+  // Finalize scores, core determinants are excluded from the top-K (they
+  // are inserted below). Contributions are unique at this point, and sorted
+  // by bitstring if the S&A above has been performed.
+  const bool pairs_sorted = world_size == 1 and
+                            not asci_settings.hash_accumulate and
+                            not asci_settings.stream_top_k;
+  const size_t nsearch =
+      finalize_asci_scores(asci_pairs, cdets_begin, cdets_end, pairs_sorted);
+
+  // Remove core determinants and zero scores, unless the top-K selection
+  // below ranks them last anyway
+  if(world_size > 1 or nsearch <= top_k_elements) {
+    asci_pairs.erase(std::partition(asci_pairs.begin(), asci_pairs.end(),
+                                    [](const auto& p) { return p.rv < 0.0; }),
+                     asci_pairs.end());
   }
 
-  // Check duplicates (which correspond to the initial truncation),
-  // and keep only the duplicate with positive coefficient.
-  keep_only_largest_copy_asci_pairs(asci_pairs);
-
-  asci_pairs.erase(std::partition(asci_pairs.begin(), asci_pairs.end(),
-                                  [](const auto& p) { return p.rv < 0.0; }),
-                   asci_pairs.end());
-
-  // Only do top-K on (ndets_max - ncdets) b/c CDETS will be added later
-  const size_t top_k_elements = ndets_max - ncdets;
-
   auto keep_large_en = clock_type::now();
   duration_type keep_large_dur = keep_large_en - keep_large_st;
   if(world_size > 1) {
@@ -562,7 +882,7 @@ std::vector<wfn_t<N>> asci_search(
 
   // Do Top-K to get the largest determinant contributions
   auto asci_sort_st = clock_type::now();
-  if(world_size > 1 or asci_pairs.size() > top_k_elements) {
+  if(world_size > 1 or nsearch > top_k_elements) {
     std::vector<asci_contrib<wfn_t<N>>> topk(top_k_elements);
     if(world_size > 1) {
 #ifdef MACIS_ENABLE_MPI
@@ -619,9 +939,11 @@ std::vector<wfn_t<N>> asci_search(
 
 #endif
     } else {
-      std::nth_element(asci_pairs.begin(), asci_pairs.begin() + top_k_elements,
-                       asci_pairs.end(),
-                       asci_contrib_topk_comparator<wfn_t<N>>{});
+      // Scores are -|rv| (0 for core determinants)
+      std::nth_element(
+          asci_pairs.begin(), asci_pairs.begin() + top_k_elements,
+          asci_pairs.end(),
+          [](const auto& a, const auto& b) { return a.rv < b.rv; });
       std::copy(asci_pairs.begin(), asci_pairs.begin() + top_k_elements,
                 topk.begin());
     }
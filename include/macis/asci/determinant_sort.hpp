@@ -8,21 +8,28 @@
 
 #pragma once
 #include <macis/asci/determinant_contributions.hpp>
-#if __has_include(<boost/sort/pdqsort/pdqsort.hpp>)
-#define MACIS_USE_BOOST_SORT
-#include <boost/sort/pdqsort/pdqsort.hpp>
-#endif
+#include <macis/util/radix_sort.hpp>
 
 namespace macis {
 
+/// Sort determinants by decreasing |C|, returns the previous position of
+/// each determinant
 template <typename WfnT>
-void reorder_ci_on_coeff(std::vector<WfnT>& dets, std::vector<double>& C) {
+std::vector<uint64_t> reorder_ci_on_coeff(std::vector<WfnT>& dets,
+                                          std::vector<double>& C) {
   size_t nlocal = C.size();
   size_t ndets = dets.size();
   std::vector<uint64_t> idx(nlocal);
   std::iota(idx.begin(), idx.end(), 0);
-  std::sort(idx.begin(), idx.end(),
-            [&](auto i, auto j) { return std::abs(C[i]) > std::abs(C[j]); });
+
+  // Non-negative doubles order as their bit patterns, complement for
+  // decreasing order
+  radix_sort(idx.begin(), idx.end(), [&](auto i) {
+    uint64_t bits;
+    const double c = std::abs(C[i]);
+    std::memcpy(&bits, &c, sizeof(bits));
+    return ~bits;
+  });
 
   std::vector<double> reorder_C(nlocal);
   std::vector<WfnT> reorder_dets(ndets);
@@ -34,6 +41,7 @@ void reorder_ci_on_coeff(std::vector<WfnT>& dets, std::vector<double>& C) {
 
   C = std::move(reorder_C);
   dets = std::move(reorder_dets);
+  return idx;
 }
 
 template <typename PairIterator>
@@ -43,17 +51,10 @@ PairIterator sort_and_accumulate_asci_pairs(PairIterator pairs_begin,
 
   if(!npairs) return pairs_end;
 
-  auto comparator = [](const auto& x, const auto& y) {
-    return bitset_less(x.state, y.state);
-  };
-
-// Sort by bitstring
-#ifdef MACIS_USE_BOOST_SORT
-  boost::sort::pdqsort_branchless
-#else
-  std::sort
-#endif
-      (pairs_begin, pairs_end, comparator);
+  // Sort by bitstring, in place: the contributions may fill most of the
+  // available memory
+  radix_sort_inplace(pairs_begin, pairs_end,
+                     [](const auto& x) -> const auto& { return x.state; });
 
   // Accumulate the ASCI scores into first instance of unique bitstrings
   auto cur_it = pairs_begin;
@@ -86,17 +87,10 @@ template <typename WfnT>
 void keep_only_largest_copy_asci_pairs(
     asci_contrib_container<WfnT>& asci_pairs) {
   if(!asci_pairs.size()) return;
-  auto comparator = [](const auto& x, const auto& y) {
-    return bitset_less(x.state, y.state);
-  };
-
-// Sort by bitstring
-#ifdef MACIS_USE_BOOST_SORT
-  boost::sort::pdqsort_branchless
-#else
-  std::sort
-#endif
-      (asci_pairs.begin(), asci_pairs.end(), comparator);
+
+  // Sort by bitstring
+  radix_sort_inplace(asci_pairs.begin(), asci_pairs.end(),
+                     [](const auto& x) -> const auto& { return x.state; });
 
   // Keep the largest ASCI score in the unique instance of each bit string
   auto cur_it = asci_pairs.begin();
@@ -118,4 +112,87 @@ void keep_only_largest_copy_asci_pairs(
   asci_pairs.erase(uit, asci_pairs.end());  // Erase dead space
 }
 
+/**
+ *  @brief Finalize the scores of unique ASCI contributions for the top-K
+ *  selection.
+ *
+ *  Scores become -|rv|, such that ascending order ranks the largest
+ *  contributions first. Contributions to determinants of the core space are
+ *  marked by a zero score instead (they are part of the next space in any
+ *  case). Replaces appending the core determinants and
+ *  `keep_only_largest_copy_asci_pairs`, which requires a second sort: core
+ *  determinants are looked up in the contributions if these are sorted by
+ *  bitstring (`sorted`), and vice versa otherwise.
+ *
+ *  @returns The number of contributions with a negative score
+ */
+template <typename WfnT, typename WfnIterator>
+size_t finalize_asci_scores(asci_contrib_container<WfnT>& asci_pairs,
+                            WfnIterator cdets_begin, WfnIterator cdets_end,
+                            bool sorted) {
+  const size_t npairs = asci_pairs.size();
+  size_t nsearch = 0;
+#pragma omp parallel for schedule(static) reduction(+ : nsearch)
+  for(size_t i = 0; i < npairs; ++i) {
+    asci_pairs[i].rv = -std::abs(asci_pairs[i].rv);
+    nsearch += asci_pairs[i].rv < 0.;
+  }
+
+  if(sorted) {
+    for(auto it = cdets_begin; it != cdets_end; ++it) {
+      auto pit = std::lower_bound(
+          asci_pairs.begin(), asci_pairs.end(), *it,
+          [](const auto& p, const auto& w) { return bitset_less(p.state, w); });
+      if(pit != asci_pairs.end() and pit->state == *it) {
+        nsearch -= pit->rv < 0.;
+        pit->rv = 0.;
+      }
+    }
+  } else {
+    std::vector<WfnT> cdets(cdets_begin, cdets_end);
+    radix_sort(cdets.begin(), cdets.end());
+    size_t ncore = 0;
+#pragma omp parallel for schedule(static) reduction(+ : ncore)
+    for(size_t i = 0; i < npairs; ++i) {
+      if(std::binary_search(cdets.begin(), cdets.end(), asci_pairs[i].state,
+                            [](const auto& x, const auto& y) {
+                              return bitset_less(x, y);
+                            })) {
+        ncore += asci_pairs[i].rv < 0.;
+        asci_pairs[i].rv = 0.;
+      }
+    }
+    nsearch -= ncore;
+  }
+
+  return nsearch;
+}
+
+/**
+ *  @brief Concatenate thread-local ASCI contributions into a shared
+ *  container.
+ *
+ *  Must be encountered by all threads of the enclosing parallel region.
+ *
+ *  @param[in]     asci_pairs_loc Contributions of the calling thread
+ *  @param[out]    asci_pairs     Shared container of all contributions
+ *  @param[in,out] npairs         Shared counter, must be zero on entry
+ */
+template <typename WfnT>
+void concatenate_asci_pairs(const asci_contrib_container<WfnT>& asci_pairs_loc,
+                            asci_contrib_container<WfnT>& asci_pairs,
+                            size_t& npairs) {
+  size_t offset;
+#pragma omp atomic capture
+  {
+    offset = npairs;
+    npairs += asci_pairs_loc.size();
+  }
+#pragma omp barrier
+#pragma omp single
+  asci_pairs.resize(npairs);
+  std::copy(asci_pairs_loc.begin(), asci_pairs_loc.end(),
+            asci_pairs.begin() + offset);
+}
+
 }  // namespace macis
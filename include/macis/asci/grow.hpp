@@ -46,6 +46,12 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
   // Grow wfn until max size, or until we get stuck
   size_t prev_size = wfn.size();
   size_t iter = 1;
+  IncrementalHamiltonian<N, index_t> H_cache;
+  auto* H_cache_ptr = asci_settings.reuse_hamiltonian ? &H_cache : nullptr;
+  // Constraint histograms of the previous search
+  constraint_histogram_cache<N> con_cache;
+  // Alpha-sorted store of wfn, shared by the search, H and the RDMs
+  alpha_sorted_dets<N> dets_sorted;
   auto grow_st = hrt_t::now();
   while(wfn.size() < asci_settings.ntdets_max) {
     size_t ndets_new =
@@ -56,7 +62,8 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
     auto ai_st = hrt_t::now();
     std::tie(E, wfn, X) = asci_iter<N, index_t>(
         asci_settings, mcscf_settings, ndets_new, E0, std::move(wfn),
-        std::move(X), ham_gen, norb MACIS_MPI_CODE(, comm));
+        std::move(X), ham_gen, norb MACIS_MPI_CODE(, comm), H_cache_ptr,
+        &con_cache, &dets_sorted);
     auto ai_en = hrt_t::now();
     dur_t ai_dur = ai_en - ai_st;
     logger->trace("  * ASCI_ITER_DUR = {:.2e} ms", ai_dur.count());
@@ -77,8 +84,15 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
             trdm(norb * norb * norb * norb, 0.0);
         matrix_span<double> ORDM(ordm.data(), norb, norb);
         rank4_span<double> TRDM(trdm.data(), norb, norb, norb, norb);
-        ham_gen.form_rdms(wfn.begin(), wfn.end(), wfn.begin(), wfn.end(),
-                          X.data(), ORDM, TRDM);
+        if(asci_settings.spin_flip) {
+          // RDMs are formed in the determinant basis
+          auto [dets, C] =
+              spin_flip_unfold<N>(wfn.begin(), wfn.end(), X.data());
+          ham_gen.form_rdms(dets.begin(), dets.end(), dets.begin(), dets.end(),
+                            C.data(), ORDM, TRDM);
+        } else {
+          ham_gen.form_rdms(dets_sorted, dets_sorted, X.data(), ORDM, TRDM);
+        }
         auto rdm_en = hrt_t::now();
         dur_t rdm_dur = rdm_en - rdm_st;
         logger->trace("    * RDM_DUR = {:.2e} ms", rdm_dur.count());
@@ -121,32 +135,46 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
       // Regenerate intermediates
       ham_gen.generate_integral_intermediates(ham_gen.V_pqrs_);
 
+      // Natural orbitals are ordered by occupation and may mix degenerate
+      // orbitals of different irreps, drop point group symmetry
+      if(ham_gen.orbsym().size()) {
+        logger->info("  * Disabling point group symmetry after rotation");
+        ham_gen.set_orbital_symmetry({});
+      }
+
+      // Cached matrix elements are no longer valid in the rotated basis
+      H_cache.clear();
+
       logger->trace("  * Rediagonalizing");
       auto rdg_st = hrt_t::now();
       std::vector<double> X_local;
-      selected_ci_diag(
-          wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
-          mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
-          X_local MACIS_MPI_CODE(, comm));
+      if(asci_settings.spin_flip) {
+        spin_flip_selected_ci_diag<N, index_t>(
+            wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+            mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+            X_local MACIS_MPI_CODE(, comm));
+      } else if(mcscf_settings.ci_direct_sigma) {
+        direct_selected_ci_diag(
+            wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+            mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+            X_local MACIS_MPI_CODE(, comm));
+      } else if(mcscf_settings.ci_mixed_precision) {
+        mixed_precision_selected_ci_diag<N, index_t>(
+            wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+            mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+            X_local MACIS_MPI_CODE(, comm));
+      } else {
+        selected_ci_diag(
+            wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+            mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+            X_local MACIS_MPI_CODE(, comm), SelectedCIOptions(mcscf_settings),
+            &dets_sorted);
+      }
 
       if(world_size > 1) {
 #ifdef MACIS_ENABLE_MPI
-        // Broadcast X_local to X
-        const size_t wfn_size = wfn.size();
-        const size_t local_count = wfn_size / world_size;
-        X.resize(wfn.size());
-
-        MPI_Allgather(X_local.data(), local_count, MPI_DOUBLE, X.data(),
-                      local_count, MPI_DOUBLE, comm);
-        if(wfn_size % world_size) {
-          const size_t nrem = wfn_size % world_size;
-          auto* X_rem = X.data() + world_size * local_count;
-          if(world_rank == world_size - 1) {
-            const auto* X_loc_rem = X_local.data() + local_count;
-            std::copy_n(X_loc_rem, nrem, X_rem);
-          }
-          MPI_Bcast(X_rem, nrem, MPI_DOUBLE, world_size - 1, comm);
-        }
+        // Broadcast X_local to X (local rows are contiguous in rank order)
+        allgatherv(X_local.data(), X_local.size(), X, comm);
 #endif
       } else {
         // Avoid copy
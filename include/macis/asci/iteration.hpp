@@ -13,49 +13,106 @@
 
 namespace macis {
 
+/**
+ *  @brief ASCI iteration: search for the `ndets_max` determinants of the
+ *  next space from `wfn` and diagonalize H in that space.
+ *
+ *  The determinants are grouped by alpha string once per iteration
+ *  (alpha_sorted_dets). The store of the new determinants is used to build
+ *  H and, in the next iteration, follows the reordering of the determinants
+ *  by coefficient and provides the store of the search determinants. If
+ *  `dets_sorted` is given, it holds the store of `wfn` (as left by the
+ *  previous call, or empty) and receives the store of the new determinants
+ *  (e.g. for form_rdms). Not used in the spin-flip adapted basis.
+ */
 template <size_t N, typename index_t = int32_t>
 auto asci_iter(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
                size_t ndets_max, double E0, std::vector<wfn_t<N>> wfn,
                std::vector<double> X, HamiltonianGenerator<N>& ham_gen,
-               size_t norb MACIS_MPI_CODE(, MPI_Comm comm)) {
+               size_t norb MACIS_MPI_CODE(, MPI_Comm comm),
+               IncrementalHamiltonian<N, index_t>* H_cache = nullptr,
+               constraint_histogram_cache<N>* con_cache = nullptr,
+               alpha_sorted_dets<N>* dets_sorted = nullptr) {
+  // The incremental Hamiltonian is always stored in full (uncompressed, on
+  // the default row distribution) and is not cached on disk
+  check_ci_hamiltonian_settings(mcscf_settings, asci_settings.spin_flip,
+                                H_cache);
+
+  alpha_sorted_dets<N> dets_sorted_loc;
+  auto& wfn_sorted = dets_sorted ? *dets_sorted : dets_sorted_loc;
+  const bool use_store = not asci_settings.spin_flip;
+  if(wfn_sorted.ndets != wfn.size() or not use_store) wfn_sorted = {};
+
   // Sort wfn on coefficient weights
-  if(wfn.size() > 1) reorder_ci_on_coeff(wfn, X);
+  if(wfn.size() > 1) {
+    auto idx = reorder_ci_on_coeff(wfn, X);
+    if(wfn_sorted.ndets) wfn_sorted.reorder(idx);
+  }
 
   // Sanity check on search determinants
   size_t nkeep = std::min(asci_settings.ncdets_max, wfn.size());
 
+  // Store of the search determinants (only used by the constraint search)
+  alpha_sorted_dets<N> cdets_sorted;
+  alpha_sorted_dets<N>* cdets_sorted_ptr = nullptr;
+#ifdef MACIS_ENABLE_MPI
+  if(use_store and comm_size(comm) > 1) {
+    cdets_sorted =
+        wfn_sorted.ndets
+            ? wfn_sorted.prefix(nkeep)
+            : alpha_sorted_dets<N>(wfn.begin(), wfn.begin() + nkeep);
+    cdets_sorted_ptr = &cdets_sorted;
+  }
+#endif
+
   // Perform the ASCI search
   wfn = asci_search(asci_settings, ndets_max, wfn.begin(), wfn.begin() + nkeep,
                     E0, X, norb, ham_gen.T(), ham_gen.G_red(), ham_gen.V_red(),
-                    ham_gen.G(), ham_gen.V(), ham_gen MACIS_MPI_CODE(, comm));
+                    ham_gen.G(), ham_gen.V(), ham_gen MACIS_MPI_CODE(, comm),
+                    con_cache, cdets_sorted_ptr);
+  cdets_sorted = {};
+
+  // Store of the new determinants
+  wfn_sorted = use_store ? alpha_sorted_dets<N>(wfn.begin(), wfn.end())
+                         : alpha_sorted_dets<N>{};
 
   // Rediagonalize
   std::vector<double> X_local;  // Precludes guess reuse
-  auto E = selected_ci_diag<N, index_t>(
-      wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
-      mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
-      X_local MACIS_MPI_CODE(, comm));
+  double E;
+  if(asci_settings.spin_flip) {
+    E = spin_flip_selected_ci_diag<N, index_t>(
+        wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+        mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+        X_local MACIS_MPI_CODE(, comm));
+  } else if(mcscf_settings.ci_direct_sigma) {
+    E = direct_selected_ci_diag<N>(
+        wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+        mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+        X_local MACIS_MPI_CODE(, comm));
+  } else if(mcscf_settings.ci_mixed_precision) {
+    E = mixed_precision_selected_ci_diag<N, index_t>(
+        wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+        mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+        X_local MACIS_MPI_CODE(, comm));
+  } else if(H_cache) {
+    // Reuse H from the previous iteration
+    E = selected_ci_diag(
+        *H_cache, wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+        mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+        X_local MACIS_MPI_CODE(, comm));
+  } else {
+    E = selected_ci_diag<N, index_t>(
+        wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+        mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+        X_local MACIS_MPI_CODE(, comm), SelectedCIOptions(mcscf_settings),
+        &wfn_sorted);
+  }
 
 #ifdef MACIS_ENABLE_MPI
   auto world_size = comm_size(comm);
-  auto world_rank = comm_rank(comm);
   if(world_size > 1) {
-    // Broadcast X_local to X
-    const size_t wfn_size = wfn.size();
-    const size_t local_count = wfn_size / world_size;
-    X.resize(wfn.size());
-
-    MPI_Allgather(X_local.data(), local_count, MPI_DOUBLE, X.data(),
-                  local_count, MPI_DOUBLE, comm);
-    if(wfn_size % world_size) {
-      const size_t nrem = wfn_size % world_size;
-      auto* X_rem = X.data() + world_size * local_count;
-      if(world_rank == world_size - 1) {
-        const auto* X_loc_rem = X_local.data() + local_count;
-        std::copy_n(X_loc_rem, nrem, X_rem);
-      }
-      MPI_Bcast(X_rem, nrem, MPI_DOUBLE, world_size - 1, comm);
-    }
+    // Broadcast X_local to X (local rows are contiguous in rank order)
+    allgatherv(X_local.data(), X_local.size(), X, comm);
   } else {
     // Avoid copy
     X = std::move(X_local);
@@ -10,6 +10,7 @@
 #include <macis/sd_operations.hpp>
 #include <macis/types.hpp>
 #include <macis/util/mpi.hpp>
+#include <unordered_map>
 #include <variant>
 
 namespace macis {
@@ -27,9 +28,7 @@ auto make_triplet(unsigned i, unsigned j, unsigned k) {
 
   con.C = 0;
   con.C.flip(i).flip(j).flip(k);
-  con.B = 1;
-  con.B <<= k;
-  con.B = con.B.to_ullong() - 1;
+  con.B = full_mask<N>(k);
   con.C_min = k;
 
   return con;
@@ -41,9 +40,7 @@ auto make_quad(unsigned i, unsigned j, unsigned k, unsigned l) {
 
   con.C = 0;
   con.C.flip(i).flip(j).flip(k).flip(l);
-  con.B = 1;
-  con.B <<= l;
-  con.B = con.B.to_ullong() - 1;
+  con.B = full_mask<N>(l);
   con.C_min = l;
 
   return con;
@@ -264,6 +261,9 @@ void generate_constraint_singles_contributions_ss(
       const auto a = fls(v_cpy);
       v_cpy.flip(a);
 
+      // Skip symmetry forbidden excitations
+      if(!ham_gen.symmetry_allowed(i, a)) continue;
+
       double h_el = T_pq[a + i * LDT];
       const double* G_ov = G_kpq + a * LDG + i * LDG2;
       const double* V_ov = V_kpq + a * LDV + i * LDV2;
@@ -314,6 +314,7 @@ void generate_constraint_doubles_contributions_ss(
       const auto ab = V[_ab];
       const auto a = ffs(ab) - 1;
       const auto b = fls(ab);
+      if(!ham_gen.symmetry_allowed(i, j, a, b)) continue;
 
       const auto G_aibj = G_ij[b + a * LDG2];
 
@@ -372,6 +373,8 @@ void generate_constraint_doubles_contributions_os(
 
       for(auto j : occ_othr)
         for(auto b : vir_othr) {
+          if(!ham_gen.symmetry_allowed(i, j, a, b)) continue;
+
           const auto jb = b + j * LDV;
           const auto V_aibj = V_ai[jb * LDV2];
 
@@ -482,39 +485,126 @@ auto dist_triplets_histogram(size_t norb, size_t ns_othr, size_t nd_othr,
 }
 #endif
 
-#ifdef MACIS_ENABLE_MPI
+/**
+ *  @brief Cache of constraint histograms (see `constraint_histogram`) summed
+ *  over a set of unique alpha strings.
+ *
+ *  The histograms are additive over the alpha strings, such that they can be
+ *  updated by the contributions of added and removed strings when the set
+ *  changes between ASCI iterations.
+ */
 template <size_t N>
-auto dist_constraint_general(size_t nlevels, size_t norb, size_t ns_othr,
-                             size_t nd_othr,
-                             const std::vector<wfn_t<N>>& unique_alpha,
-                             MPI_Comm comm) {
-  auto world_rank = comm_rank(comm);
-  auto world_size = comm_size(comm);
+struct constraint_histogram_cache {
+  size_t norb = 0;
+  size_t ns_othr = 0;
+  size_t nd_othr = 0;
+  std::vector<wfn_t<N>> alpha;  ///< Sorted (bitset_less) alpha strings
+  std::unordered_map<wfn_t<N>, size_t> counts;  ///< Histograms by constraint
+};
 
+/**
+ *  @brief Generate the constraints of the ASCI constraint search along with
+ *  estimates of their cost, sorted by decreasing cost.
+ *
+ *  Triplet constraints whose cost exceeds a share of the total work for
+ *  `nparts` parts are broken apart into constraints with one more element,
+ *  for up to `nlevels` levels. The result is identical on all PEs.
+ *
+ *  The histograms of each level are evaluated by all PEs of `comm` (over
+ *  disjoint subsets of the alpha strings) and threads, followed by a single
+ *  reduction. If `cache` is given and holds the histograms of a set of alpha
+ *  strings which differs from `unique_alpha` (sorted, unique) by fewer
+ *  strings than it holds on all PEs, only the differences are evaluated. The
+ *  cache is updated with the histograms of `unique_alpha`.
+ */
+template <size_t N>
+auto generate_constraint_general(
+    size_t nlevels, size_t norb, size_t ns_othr, size_t nd_othr,
+    const std::vector<wfn_t<N>>& unique_alpha, size_t nparts,
+    constraint_histogram_cache<N>* cache MACIS_MPI_CODE(, MPI_Comm comm)) {
   wfn_t<N> O = full_mask<N>(norb);
+#ifdef MACIS_ENABLE_MPI
+  const size_t world_rank = comm_rank(comm);
+  const size_t world_size = comm_size(comm);
+#else
+  const size_t world_rank = 0;
+  const size_t world_size = 1;
+#endif
 
-  // Global workloads
-  std::vector<size_t> workloads(world_size, 0);
+  // Alpha strings which have been added / removed since the cached
+  // histograms were evaluated
+  auto alpha_less = [](const auto& a, const auto& b) {
+    return bitset_less(a, b);
+  };
+  std::vector<wfn_t<N>> alpha_add, alpha_rem;
+  bool use_cache = cache and cache->norb == norb and
+                   cache->ns_othr == ns_othr and cache->nd_othr == nd_othr and
+                   std::is_sorted(unique_alpha.begin(), unique_alpha.end(),
+                                  alpha_less);
+  if(use_cache) {
+    std::set_difference(unique_alpha.begin(), unique_alpha.end(),
+                        cache->alpha.begin(), cache->alpha.end(),
+                        std::back_inserter(alpha_add), alpha_less);
+    std::set_difference(cache->alpha.begin(), cache->alpha.end(),
+                        unique_alpha.begin(), unique_alpha.end(),
+                        std::back_inserter(alpha_rem), alpha_less);
+    use_cache = alpha_add.size() + alpha_rem.size() < cache->alpha.size();
+  }
+  // The cached histograms are only usable if they are valid on all PEs
+  MACIS_MPI_CODE(use_cache = allreduce(int(use_cache), MPI_MIN, comm);)
+  std::unordered_map<wfn_t<N>, size_t> counts;
+
+  // Histograms of a list of constraints
+  auto histograms = [&](const std::vector<wfn_constraint<N>>& cons) {
+    const size_t ncons = cons.size();
+
+    // Partial sums over the local alpha strings, contributions of removed
+    // strings are stored after those of added ones
+    std::vector<size_t> nw(2 * ncons, 0);
+#pragma omp parallel for schedule(dynamic)
+    for(size_t i = 0; i < ncons; ++i) {
+      const auto& [C, B, _] = cons[i];
+      const bool cached = use_cache and cache->counts.count(C);
+      const auto& add = cached ? alpha_add : unique_alpha;
+      for(size_t j = world_rank; j < add.size(); j += world_size)
+        nw[i] += constraint_histogram(add[j], ns_othr, nd_othr, C, O, B);
+      if(cached) {
+        for(size_t j = world_rank; j < alpha_rem.size(); j += world_size)
+          nw[ncons + i] +=
+              constraint_histogram(alpha_rem[j], ns_othr, nd_othr, C, O, B);
+      }
+    }
+    MACIS_MPI_CODE(allreduce(nw.data(), nw.size(), MPI_SUM, comm);)
+
+    std::vector<size_t> sizes(ncons);
+    for(size_t i = 0; i < ncons; ++i) {
+      const auto& C = cons[i].C;
+      const bool cached = use_cache and cache->counts.count(C);
+      sizes[i] = (cached ? cache->counts.at(C) : 0) + nw[i] - nw[ncons + i];
+      counts[C] = sizes[i];
+    }
+    return sizes;
+  };
 
   // Generate triplets + heuristic
-  std::vector<std::pair<wfn_constraint<N>, size_t>> constraint_sizes;
-  constraint_sizes.reserve(norb * norb * norb);
-  size_t total_work = 0;
+  std::vector<wfn_constraint<N>> triplets;
+  triplets.reserve(norb * norb * norb / 6);
   for(int t_i = 0; t_i < norb; ++t_i)
     for(int t_j = 0; t_j < t_i; ++t_j)
-      for(int t_k = 0; t_k < t_j; ++t_k) {
-        auto constraint = make_triplet<N>(t_i, t_j, t_k);
-        const auto& [T, B, _] = constraint;
-
-        size_t nw = 0;
-        for(const auto& alpha : unique_alpha) {
-          nw += constraint_histogram(alpha, ns_othr, nd_othr, T, O, B);
-        }
-        if(nw) constraint_sizes.emplace_back(constraint, nw);
-        total_work += nw;
-      }
+      for(int t_k = 0; t_k < t_j; ++t_k)
+        triplets.push_back(make_triplet<N>(t_i, t_j, t_k));
+  auto triplet_sizes = histograms(triplets);
 
-  size_t local_average = (0.6 * total_work) / world_size;
+  std::vector<std::pair<wfn_constraint<N>, size_t>> constraint_sizes;
+  constraint_sizes.reserve(triplets.size());
+  size_t total_work = 0;
+  for(size_t i = 0; i < triplets.size(); ++i) {
+    if(triplet_sizes[i])
+      constraint_sizes.emplace_back(triplets[i], triplet_sizes[i]);
+    total_work += triplet_sizes[i];
+  }
+
+  size_t local_average = (0.6 * total_work) / nparts;
 
   for(size_t ilevel = 0; ilevel < nlevels; ++ilevel) {
     // Select constraints larger than average to be broken apart
@@ -533,6 +623,7 @@ auto dist_constraint_general(size_t nlevels, size_t norb, size_t ns_othr,
     if(!tps_to_next.size()) break;
 
     // Break apart constraints
+    std::vector<wfn_constraint<N>> next;
     for(auto [c, nw_trip] : tps_to_next) {
       const auto C_min = c.C_min;
 
@@ -543,19 +634,26 @@ auto dist_constraint_general(size_t nlevels, size_t norb, size_t ns_othr,
         c_next.C.flip(q_l);
         c_next.B >>= (C_min - q_l);
         c_next.C_min = q_l;
-
-        size_t nw = 0;
-
-        for(const auto& alpha : unique_alpha) {
-          nw += constraint_histogram(alpha, ns_othr, nd_othr, c_next.C, O,
-                                     c_next.B);
-        }
-        if(nw) constraint_sizes.emplace_back(c_next, nw);
-        total_work += nw;
+        next.push_back(c_next);
       }
     }
+
+    auto next_sizes = histograms(next);
+    for(size_t i = 0; i < next.size(); ++i) {
+      if(next_sizes[i]) constraint_sizes.emplace_back(next[i], next_sizes[i]);
+      total_work += next_sizes[i];
+    }
   }  // Recurse into constraints
 
+  // Only keep the histograms of this set of alpha strings
+  if(cache) {
+    cache->norb = norb;
+    cache->ns_othr = ns_othr;
+    cache->nd_othr = nd_othr;
+    cache->alpha = unique_alpha;
+    cache->counts = std::move(counts);
+  }
+
   // if(!world_rank) {
   //   const auto ntrip = std::count_if(constraint_sizes.begin(),
   //     constraint_sizes.end(), [](auto &c){ return c.first.C.count() == 3; });
@@ -578,6 +676,35 @@ auto dist_constraint_general(size_t nlevels, size_t norb, size_t ns_othr,
   std::sort(constraint_sizes.begin(), constraint_sizes.end(),
             [](const auto& a, const auto& b) { return a.second > b.second; });
 
+  return constraint_sizes;
+}
+
+#ifdef MACIS_ENABLE_MPI
+/**
+ *  @brief Generate the constraints of the ASCI constraint search and assign
+ *  them statically to the ranks of `comm`.
+ *
+ *  Constraints are assigned greedily in order of decreasing estimated cost
+ *  to the rank with the least work.
+ *
+ *  @returns The constraints of the calling rank
+ */
+template <size_t N>
+auto dist_constraint_general(size_t nlevels, size_t norb, size_t ns_othr,
+                             size_t nd_othr,
+                             const std::vector<wfn_t<N>>& unique_alpha,
+                             MPI_Comm comm,
+                             constraint_histogram_cache<N>* cache = nullptr) {
+  auto world_rank = comm_rank(comm);
+  auto world_size = comm_size(comm);
+
+  auto constraint_sizes =
+      generate_constraint_general(nlevels, norb, ns_othr, nd_othr,
+                                  unique_alpha, world_size, cache, comm);
+
+  // Global workloads
+  std::vector<size_t> workloads(world_size, 0);
+
   // Assign work
   std::vector<wfn_constraint<N>> constraints;
   constraints.reserve(constraint_sizes.size() / world_size);
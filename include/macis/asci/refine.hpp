@@ -38,13 +38,17 @@ auto asci_refine(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
   logger->info(fmt_string, 0, E0, 0.0);
 
   // Refinement Loop
+  IncrementalHamiltonian<N, index_t> H_cache;
+  auto* H_cache_ptr = asci_settings.reuse_hamiltonian ? &H_cache : nullptr;
+  // Constraint histograms of the previous search
+  constraint_histogram_cache<N> con_cache;
   const size_t ndets = wfn.size();
   bool converged = false;
   for(size_t iter = 0; iter < asci_settings.max_refine_iter; ++iter) {
     double E;
     std::tie(E, wfn, X) = asci_iter<N, index_t>(
         asci_settings, mcscf_settings, ndets, E0, std::move(wfn), std::move(X),
-        ham_gen, norb MACIS_MPI_CODE(, comm));
+        ham_gen, norb MACIS_MPI_CODE(, comm), H_cache_ptr, &con_cache);
     if(wfn.size() != ndets)
       throw std::runtime_error("Wavefunction size can't change in refinement");
 
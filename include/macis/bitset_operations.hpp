@@ -66,7 +66,7 @@ fls(Integral i) {
 template <size_t N>
 unsigned long long fast_to_ullong(const std::bitset<N>& bits) {
   // Low words
-  if constexpr(N == 64 or N == 128)
+  if constexpr(N >= 64 and N % 64 == 0)
     return *reinterpret_cast<const uint64_t*>(&bits);
   if constexpr(N == 32) return *reinterpret_cast<const uint32_t*>(&bits);
   return bits.to_ullong();
@@ -76,7 +76,7 @@ unsigned long long fast_to_ullong(const std::bitset<N>& bits) {
 template <size_t N>
 unsigned long fast_to_ulong(const std::bitset<N>& bits) {
   // Low words
-  if constexpr(N == 32 or N == 64 or N == 128)
+  if constexpr(N == 32 or (N >= 64 and N % 64 == 0))
     return *reinterpret_cast<const uint32_t*>(&bits);
   return bits.to_ulong();
 }
@@ -162,6 +162,11 @@ uint32_t ffs(std::bitset<N> bits) {
       return ffsll(as_words[0]);
     else
       return ffsll(as_words[1]) + 64;
+  } else if constexpr(N % 64 == 0) {
+    auto as_words = reinterpret_cast<uint64_t*>(&bits);
+    for(size_t w = 0; w < N / 64; ++w)
+      if(as_words[w]) return ffsll(as_words[w]) + 64 * w;
+    return 0;
   } else {
     uint32_t ind = 0;
     for(ind = 0; ind < N; ++ind)
@@ -193,6 +198,11 @@ uint32_t fls(std::bitset<N> bits) {
       return fls(as_words[1]) + 64;
     else
       return fls(as_words[0]);
+  } else if constexpr(N % 64 == 0) {
+    auto as_words = reinterpret_cast<uint64_t*>(&bits);
+    for(size_t w = N / 64 - 1; w > 0; --w)
+      if(as_words[w]) return fls(as_words[w]) + 64 * w;
+    return fls(as_words[0]);
   } else {
     uint32_t ind = 0;
     for(ind = N - 1; ind >= 0; ind--)
@@ -224,6 +234,17 @@ std::vector<uint32_t> bits_to_indices(std::bitset<N> bits) {
   return indices;
 }
 
+/// Copy `nwords` 64-bit words of `src`, starting at word `offset`, into the
+/// low words of `dst` (both widths must be multiples of 64)
+template <size_t N, size_t M>
+inline void bitset_copy_words(std::bitset<N>& dst, const std::bitset<M>& src,
+                              size_t offset, size_t nwords) {
+  static_assert(N % 64 == 0 and M % 64 == 0, "Not Supported");
+  auto* dst_words = reinterpret_cast<uint64_t*>(&dst);
+  const auto* src_words = reinterpret_cast<const uint64_t*>(&src);
+  for(size_t w = 0; w < nwords; ++w) dst_words[w] = src_words[offset + w];
+}
+
 /// Truncate a bitset to one of smaller width
 template <size_t N, size_t M>
 inline std::bitset<N> truncate_bitset(std::bitset<M> bits) {
@@ -235,6 +256,11 @@ inline std::bitset<N> truncate_bitset(std::bitset<M> bits) {
     return (bits & mask).to_ulong();
   } else if constexpr(N <= 64) {
     return (bits & mask).to_ullong();
+  } else if constexpr(N % 64 == 0) {
+    // Copy the low words
+    std::bitset<N> trunc_bits;
+    bitset_copy_words(trunc_bits, bits, 0, N / 64);
+    return trunc_bits;
   } else {
     std::bitset<N> trunc_bits = 0;
     for(size_t i = 0; i < N; ++i)
@@ -253,6 +279,11 @@ inline std::bitset<N> expand_bitset(std::bitset<M> bits) {
     return bits.to_ulong();
   } else if constexpr(M <= 64) {
     return bits.to_ullong();
+  } else if constexpr(M % 64 == 0) {
+    // Copy into the low words
+    std::bitset<N> exp_bits = 0;
+    bitset_copy_words(exp_bits, bits, 0, M / 64);
+    return exp_bits;
   } else {
     std::bitset<N> exp_bits = 0;
     for(size_t i = 0; i < M; ++i)
@@ -264,24 +295,30 @@ inline std::bitset<N> expand_bitset(std::bitset<M> bits) {
 /// Extract to lo word of a bitset of even width
 template <size_t N>
 inline std::bitset<N / 2> bitset_lo_word(std::bitset<N> bits) {
-  static_assert(N == 128 or N == 64, "Not Supported");
-  if constexpr(N == 128) {
-    return std::bitset<64>(reinterpret_cast<uint64_t*>(&bits)[0]);
-  }
+  static_assert(N == 64 or N % 128 == 0, "Not Supported");
   if constexpr(N == 64) {
     return std::bitset<32>(reinterpret_cast<uint32_t*>(&bits)[0]);
+  } else if constexpr(N == 128) {
+    return std::bitset<64>(reinterpret_cast<uint64_t*>(&bits)[0]);
+  } else {
+    std::bitset<N / 2> lo;
+    bitset_copy_words(lo, bits, 0, N / 128);
+    return lo;
   }
 }
 
 /// Extract to hi word of a bitset of even width
 template <size_t N>
 inline std::bitset<N / 2> bitset_hi_word(std::bitset<N> bits) {
-  static_assert(N == 128 or N == 64, "Not Supported");
-  if constexpr(N == 128) {
-    return std::bitset<64>(reinterpret_cast<uint64_t*>(&bits)[1]);
-  }
+  static_assert(N == 64 or N % 128 == 0, "Not Supported");
   if constexpr(N == 64) {
     return std::bitset<32>(reinterpret_cast<uint32_t*>(&bits)[1]);
+  } else if constexpr(N == 128) {
+    return std::bitset<64>(reinterpret_cast<uint64_t*>(&bits)[1]);
+  } else {
+    std::bitset<N / 2> hi;
+    bitset_copy_words(hi, bits, N / 128, N / 128);
+    return hi;
   }
 }
 
@@ -296,6 +333,14 @@ bool bitset_less(std::bitset<N> x, std::bitset<N> y) {
     auto _x = reinterpret_cast<uint128_t*>(&x);
     auto _y = reinterpret_cast<uint128_t*>(&y);
     return *_x < *_y;
+  } else if constexpr(N % 64 == 0) {
+    // Compare from the most significant word
+    auto _x = reinterpret_cast<uint64_t*>(&x);
+    auto _y = reinterpret_cast<uint64_t*>(&y);
+    for(int w = N / 64 - 1; w >= 0; w--) {
+      if(_x[w] != _y[w]) return _x[w] < _y[w];
+    }
+    return false;
   } else {
     for(int i = N - 1; i >= 0; i--) {
       if(x[i] ^ y[i]) return y[i];
@@ -7,9 +7,12 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <macis/hamiltonian_generator.hpp>
+#include <macis/spin_flip.hpp>
 #include <macis/types.hpp>
 #include <macis/util/mpi.hpp>
+#include <numeric>
 
 #ifdef MACIS_ENABLE_MPI
 #include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
@@ -19,43 +22,359 @@
 namespace macis {
 
 // Base implementation of bitset CSR generation
+//
+// If upper_triangle is set, only elements with ket index >= bra index are
+// generated (see HamiltonianGenerator::make_csr_hamiltonian_block)
 template <typename index_t, size_t N>
 sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian_block(
     wavefunction_iterator_t<N> bra_begin, wavefunction_iterator_t<N> bra_end,
     wavefunction_iterator_t<N> ket_begin, wavefunction_iterator_t<N> ket_end,
-    HamiltonianGenerator<N>& ham_gen, double H_thresh) {
+    HamiltonianGenerator<N>& ham_gen, double H_thresh,
+    bool upper_triangle = false) {
   size_t nbra = std::distance(bra_begin, bra_end);
   size_t nket = std::distance(ket_begin, ket_end);
 
   if(nbra and nket) {
     return ham_gen.template make_csr_hamiltonian_block<index_t>(
-        bra_begin, bra_end, ket_begin, ket_end, H_thresh);
+        bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
   } else {
     return sparsexx::csr_matrix<double, index_t>(nbra, nket, 0, 0);
   }
 }
 
+// If upper_triangle is set, only the upper triangle (including the diagonal)
+// of H is stored, to be used with the symmetric SpMV kernels
 template <typename index_t, size_t N>
 sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian(
     wavefunction_iterator_t<N> sd_begin, wavefunction_iterator_t<N> sd_end,
-    HamiltonianGenerator<N>& ham_gen, double H_thresh) {
+    HamiltonianGenerator<N>& ham_gen, double H_thresh,
+    bool upper_triangle = false) {
   return make_csr_hamiltonian_block<index_t>(sd_begin, sd_end, sd_begin, sd_end,
-                                             ham_gen, H_thresh);
+                                             ham_gen, H_thresh, upper_triangle);
+}
+
+// CSR generation from an alpha-sorted determinant store (e.g. shared with
+// the ASCI search), row and column indices refer to the original ordering of
+// the determinants
+template <typename index_t, size_t N>
+sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian(
+    const alpha_sorted_dets<N>& dets, HamiltonianGenerator<N>& ham_gen,
+    double H_thresh, bool upper_triangle = false) {
+  return ham_gen.template make_csr_hamiltonian_rows<index_t>(
+      dets, 0, dets.ndets, H_thresh, upper_triangle);
+}
+
+// CSR generation in the spin-flip adapted basis (see spin_flip.hpp)
+//
+// Bras and kets are canonical representatives. The determinant block is
+// generated against the kets and the spin-flipped partners of the non
+// self-conjugate kets, and the columns of the partners are folded onto their
+// representatives. H_thresh applies to the determinant matrix elements
+template <typename index_t, size_t N>
+sparsexx::csr_matrix<double, index_t> make_spin_flip_csr_hamiltonian_block(
+    wavefunction_iterator_t<N> bra_begin, wavefunction_iterator_t<N> bra_end,
+    wavefunction_iterator_t<N> ket_begin, wavefunction_iterator_t<N> ket_end,
+    HamiltonianGenerator<N>& ham_gen, double H_thresh) {
+  const size_t nbra = std::distance(bra_begin, bra_end);
+  const size_t nket = std::distance(ket_begin, ket_end);
+
+  // Kets followed by the partners of the non self-conjugate kets
+  std::vector<wfn_t<N>> kets(ket_begin, ket_end);
+  std::vector<index_t> partner_index;
+  for(size_t j = 0; j < nket; ++j) {
+    const auto flipped = spin_flip(kets[j]);
+    if(flipped == kets[j]) continue;
+    kets.emplace_back(flipped);
+    partner_index.emplace_back(j);
+  }
+
+  auto H_det = make_csr_hamiltonian_block<index_t>(
+      bra_begin, bra_end, kets.begin(), kets.end(), ham_gen, H_thresh);
+  std::vector<wfn_t<N>>().swap(kets);
+
+  const auto& rowptr_det = H_det.rowptr();
+  const auto& colind_det = H_det.colind();
+  const auto& nzval_det = H_det.nzval();
+  auto fold = [&](index_t j) -> index_t {
+    return j < index_t(nket) ? j : partner_index[j - nket];
+  };
+
+  // Count folded entries per row
+  std::vector<index_t> rowptr(nbra + 1);
+  rowptr[0] = 0;
+#pragma omp parallel
+  {
+    std::vector<index_t> cols;
+#pragma omp for schedule(dynamic, 256)
+    for(size_t i = 0; i < nbra; ++i) {
+      cols.clear();
+      for(auto k = rowptr_det[i]; k < rowptr_det[i + 1]; ++k)
+        cols.emplace_back(fold(colind_det[k]));
+      std::sort(cols.begin(), cols.end());
+      rowptr[i + 1] = std::distance(cols.begin(),
+                                    std::unique(cols.begin(), cols.end()));
+    }
+  }
+  std::partial_sum(rowptr.begin(), rowptr.end(), rowptr.begin());
+
+  // Fold and scale into the adapted basis
+  const size_t nnz = rowptr.back();
+  std::vector<index_t> colind(nnz);
+  std::vector<double> nzval(nnz);
+#pragma omp parallel
+  {
+    std::vector<std::pair<index_t, double>> row;
+#pragma omp for schedule(dynamic, 256)
+    for(size_t i = 0; i < nbra; ++i) {
+      row.clear();
+      for(auto k = rowptr_det[i]; k < rowptr_det[i + 1]; ++k)
+        row.emplace_back(fold(colind_det[k]), nzval_det[k]);
+      std::sort(row.begin(), row.end(),
+                [](auto a, auto b) { return a.first < b.first; });
+
+      const double n_bra = 2. * spin_flip_norm(*(bra_begin + i));
+      auto k = rowptr[i] - 1;
+      for(size_t r = 0; r < row.size(); ++r) {
+        if(r == 0 or row[r].first != row[r - 1].first) {
+          colind[++k] = row[r].first;
+          nzval[k] = 0.;
+        }
+        nzval[k] += row[r].second;
+      }
+      for(k = rowptr[i]; k < rowptr[i + 1]; ++k) {
+        // Self-conjugate kets only appear once
+        const auto ket = *(ket_begin + colind[k]);
+        nzval[k] *= n_bra * (spin_flip(ket) == ket ? 1. : M_SQRT1_2);
+      }
+    }
+  }
+
+  return sparsexx::csr_matrix<double, index_t>(
+      nbra, nket, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+template <typename index_t, size_t N>
+sparsexx::csr_matrix<double, index_t> make_spin_flip_csr_hamiltonian(
+    wavefunction_iterator_t<N> sd_begin, wavefunction_iterator_t<N> sd_end,
+    HamiltonianGenerator<N>& ham_gen, double H_thresh) {
+  return make_spin_flip_csr_hamiltonian_block<index_t>(
+      sd_begin, sd_end, sd_begin, sd_end, ham_gen, H_thresh);
 }
 
 #ifdef MACIS_ENABLE_MPI
+namespace detail {
+
+// Merge two column blocks of the same rows into a single CSR matrix with ncol
+// columns: the columns of A are kept, those of B are shifted by B_offset
+// (>= A.n()). The inputs are released as they are consumed
+template <typename index_t>
+sparsexx::csr_matrix<double, index_t> merge_column_blocks(
+    sparsexx::csr_matrix<double, index_t>&& A,
+    sparsexx::csr_matrix<double, index_t>&& B, size_t B_offset, size_t ncol) {
+  const size_t nrow = A.m();
+
+  // Nothing to merge, shift in place
+  if(A.nnz() == 0 or B.nnz() == 0) {
+    auto& C = A.nnz() ? A : B;
+    const index_t shift = A.nnz() ? 0 : B_offset;
+    if(shift)
+      for(auto& j : C.colind()) j += shift;
+    return sparsexx::csr_matrix<double, index_t>(nrow, ncol,
+                                                 std::move(C.rowptr()),
+                                                 std::move(C.colind()),
+                                                 std::move(C.nzval()));
+  }
+
+  const auto& Arp = A.rowptr();
+  const auto& Brp = B.rowptr();
+  std::vector<index_t> rowptr(nrow + 1);
+  rowptr[0] = 0;
+  for(size_t i = 0; i < nrow; ++i)
+    rowptr[i + 1] =
+        rowptr[i] + (Arp[i + 1] - Arp[i]) + (Brp[i + 1] - Brp[i]);
+
+  // Merge one array at a time to bound the peak memory
+  auto merge = [&](auto& A_arr, auto& B_arr, auto shift) {
+    std::decay_t<decltype(A_arr)> C_arr(rowptr.back());
+#pragma omp parallel for schedule(dynamic, 1024)
+    for(size_t i = 0; i < nrow; ++i) {
+      auto* c = C_arr.data() + rowptr[i];
+      for(auto k = Arp[i]; k < Arp[i + 1]; ++k) *(c++) = A_arr[k];
+      for(auto k = Brp[i]; k < Brp[i + 1]; ++k) *(c++) = B_arr[k] + shift;
+    }
+    std::decay_t<decltype(A_arr)>().swap(A_arr);
+    std::decay_t<decltype(B_arr)>().swap(B_arr);
+    return C_arr;
+  };
+  auto colind = merge(A.colind(), B.colind(), index_t(B_offset));
+  auto nzval = merge(A.nzval(), B.nzval(), 0.);
+
+  return sparsexx::csr_matrix<double, index_t>(
+      nrow, ncol, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+// Split the columns of A into the block [col_st, col_en), with columns
+// shifted by -col_st, and the remaining columns (which keep their indices).
+// The input is released as it is consumed
+template <typename index_t>
+std::pair<sparsexx::csr_matrix<double, index_t>,
+          sparsexx::csr_matrix<double, index_t>>
+split_column_blocks(sparsexx::csr_matrix<double, index_t>&& A, size_t col_st,
+                    size_t col_en) {
+  const size_t nrow = A.m();
+  const auto& Arp = A.rowptr();
+  const auto& Aci = A.colind();
+  auto in_block = [&](index_t j) {
+    return size_t(j) >= col_st and size_t(j) < col_en;
+  };
+
+  std::vector<index_t> rowptr_in(nrow + 1, 0), rowptr_out(nrow + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1024)
+  for(size_t i = 0; i < nrow; ++i) {
+    const auto n_in =
+        std::count_if(Aci.begin() + Arp[i], Aci.begin() + Arp[i + 1], in_block);
+    rowptr_in[i + 1] = n_in;
+    rowptr_out[i + 1] = (Arp[i + 1] - Arp[i]) - n_in;
+  }
+  std::partial_sum(rowptr_in.begin(), rowptr_in.end(), rowptr_in.begin());
+  std::partial_sum(rowptr_out.begin(), rowptr_out.end(), rowptr_out.begin());
+
+  // Split one array at a time to bound the peak memory
+  auto split = [&](auto& A_arr, auto shift) {
+    std::decay_t<decltype(A_arr)> arr_in(rowptr_in.back()),
+        arr_out(rowptr_out.back());
+#pragma omp parallel for schedule(dynamic, 1024)
+    for(size_t i = 0; i < nrow; ++i) {
+      auto* c_in = arr_in.data() + rowptr_in[i];
+      auto* c_out = arr_out.data() + rowptr_out[i];
+      for(auto k = Arp[i]; k < Arp[i + 1]; ++k) {
+        if(in_block(Aci[k]))
+          *(c_in++) = A_arr[k] - shift;
+        else
+          *(c_out++) = A_arr[k];
+      }
+    }
+    return std::make_pair(std::move(arr_in), std::move(arr_out));
+  };
+  auto nzval = split(A.nzval(), 0.);
+  std::vector<double>().swap(A.nzval());
+  auto colind = split(A.colind(), index_t(col_st));
+  std::vector<index_t>().swap(A.colind());
+
+  return std::make_pair(
+      sparsexx::csr_matrix<double, index_t>(
+          nrow, col_en - col_st, std::move(rowptr_in),
+          std::move(colind.first), std::move(nzval.first)),
+      sparsexx::csr_matrix<double, index_t>(
+          nrow, A.n(), std::move(rowptr_out), std::move(colind.second),
+          std::move(nzval.second)));
+}
+
+}  // namespace detail
+
+// Partition the rows of H into contiguous blocks of balanced work
+//
+// The work of generating a row with `ham_gen` is modeled as
+//
+//   1 + nconn + ham_gen.ket_screen_cost() * nket
+//
+// where nconn is the number of non-zero elements of the row (i.e. matrix
+// elements evaluated by the generator) and nket is the number of kets the
+// generator screens for the row (all determinants, only those to the right
+// of the row for the upper triangle). The second term models generators
+// which only visit connected kets (SortedDoubleLoopHamiltonianGenerator),
+// the third the per-row scan of DoubleLoopHamiltonianGenerator.
+//
+// nconn is evaluated exactly, with `ham_gen`, for a strided subset of (at
+// most nsample, and at most 1/16 of all) rows which is distributed over
+// `comm`, and assigned to the rows of the stride.
+template <typename index_t, size_t N>
+std::vector<std::pair<index_t, index_t>> balanced_row_extents(
+    MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
+    wavefunction_iterator_t<N> sd_end, HamiltonianGenerator<N>& ham_gen,
+    bool upper_triangle = false, size_t nsample = 2048) {
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  const size_t world_size = comm_size(comm);
+  const size_t world_rank = comm_rank(comm);
+
+  const size_t bra_stride =
+      std::max(16ul, (ndets + nsample - 1) / std::max(1ul, nsample));
+  const size_t nbra_sample = (ndets + bra_stride - 1) / bra_stride;
+
+  // Rows of the local samples
+  std::vector<wfn_t<N>> bra_sample;
+  for(size_t ib = world_rank; ib < nbra_sample; ib += world_size)
+    bra_sample.emplace_back(*(sd_begin + ib * bra_stride));
+  auto H_sample = make_csr_hamiltonian_block<index_t>(
+      bra_sample.begin(), bra_sample.end(), sd_begin, sd_end, ham_gen, 0.);
+
+  // Estimated work per row of each bra block
+  const double screen_cost = ham_gen.ket_screen_cost();
+  std::vector<double> block_cost(nbra_sample, 0.);
+#pragma omp parallel for schedule(dynamic)
+  for(size_t ib = world_rank; ib < nbra_sample; ib += world_size) {
+    const size_t i = ib * bra_stride;
+    const size_t r = ib / world_size;
+    size_t nconn = 0;
+    for(auto k = H_sample.rowptr()[r]; k < H_sample.rowptr()[r + 1]; ++k)
+      nconn += not upper_triangle or size_t(H_sample.colind()[k]) >= i;
+    const size_t nket = upper_triangle ? ndets - i : ndets;
+    block_cost[ib] = 1. + nconn + screen_cost * nket;
+  }
+  allreduce(block_cost.data(), nbra_sample, MPI_SUM, comm);
+
+  // Cut the (piecewise constant) cumulative work into equal parts
+  double total_cost = 0.;
+  for(size_t ib = 0; ib < nbra_sample; ++ib) {
+    const size_t nrow = std::min(bra_stride, ndets - ib * bra_stride);
+    total_cost += block_cost[ib] * nrow;
+  }
+
+  std::vector<std::pair<index_t, index_t>> extents(world_size);
+  size_t row = 0;
+  double cost = 0.;
+  for(size_t p = 0; p < world_size; ++p) {
+    // Leave at least one row for each of the remaining ranks
+    const size_t row_max = ndets - std::min(ndets, world_size - p - 1);
+    const double target = total_cost * (p + 1) / world_size;
+    const size_t row_st = row;
+    if(p == world_size - 1) row = ndets;
+    while(row < row_max and (row == row_st or cost < target)) {
+      cost += block_cost[row / bra_stride];
+      row++;
+    }
+    extents[p] = {index_t(row_st), index_t(row)};
+  }
+
+  return extents;
+}
+
 // Base implementation of dist-CSR H construction for bitsets
+//
+// If upper_triangle is set, only the upper triangle (including the diagonal)
+// of H is stored: the diagonal tile is upper triangular and the off-diagonal
+// tile only contains columns to the right of the local row block
+//
+// If balance_rows is set, the rows are distributed according to
+// balanced_row_extents rather than evenly
 template <typename index_t, size_t N>
 sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>
 make_dist_csr_hamiltonian(MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
                           wavefunction_iterator_t<N> sd_end,
                           HamiltonianGenerator<N>& ham_gen,
-                          const double H_thresh) {
+                          const double H_thresh, bool upper_triangle = false,
+                          bool balance_rows = false) {
   using namespace sparsexx;
   using namespace sparsexx::detail;
 
   size_t ndets = std::distance(sd_begin, sd_end);
-  dist_sparse_matrix<csr_matrix<double, index_t>> H_dist(comm, ndets, ndets);
+  using matrix_type = dist_sparse_matrix<csr_matrix<double, index_t>>;
+  auto H_dist = balance_rows
+                    ? matrix_type(comm, ndets, ndets,
+                                  balanced_row_extents<index_t, N>(
+                                      comm, sd_begin, sd_end, ham_gen,
+                                      upper_triangle))
+                    : matrix_type(comm, ndets, ndets);
 
   // Get local row bounds
   auto [bra_st, bra_en] = H_dist.row_bounds(get_mpi_rank(comm));
@@ -63,19 +382,97 @@ make_dist_csr_hamiltonian(MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
   // Build diagonal part
   H_dist.set_diagonal_tile(make_csr_hamiltonian_block<index_t>(
       sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_st,
-      sd_begin + bra_en, ham_gen, H_thresh));
+      sd_begin + bra_en, ham_gen, H_thresh, upper_triangle));
 
   auto world_size = get_mpi_size(comm);
 
   if(world_size > 1) {
-    // Create a copy of SD's with local bra dets zero'd out
-    std::vector<std::bitset<N>> sds_offdiag(sd_begin, sd_end);
-    for(auto i = bra_st; i < bra_en; ++i) sds_offdiag[i] = 0ul;
-
-    // Build off-diagonal part
-    H_dist.set_off_diagonal_tile(make_csr_hamiltonian_block<index_t>(
-        sd_begin + bra_st, sd_begin + bra_en, sds_offdiag.begin(),
-        sds_offdiag.end(), ham_gen, H_thresh));
+    // Only the remote kets [0, bra_st) and [bra_en, ndets) contribute to the
+    // off-diagonal tile (only the latter for the upper triangle)
+    auto H_left = make_csr_hamiltonian_block<index_t>(
+        sd_begin + bra_st, sd_begin + bra_en, sd_begin,
+        sd_begin + (upper_triangle ? 0 : bra_st), ham_gen, H_thresh);
+    auto H_right = make_csr_hamiltonian_block<index_t>(
+        sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_en, sd_end,
+        ham_gen, H_thresh);
+
+    H_dist.set_off_diagonal_tile(macis::detail::merge_column_blocks(
+        std::move(H_left), std::move(H_right), bra_en, ndets));
+  }
+
+  return H_dist;
+}
+
+// Dist-CSR H construction from an alpha-sorted determinant store (e.g.
+// shared with the ASCI search)
+//
+// The local rows are generated against all determinants at once and split
+// into the diagonal and off-diagonal tiles. Otherwise as the iterator
+// version (the determinants are only unpacked to balance the rows)
+template <typename index_t, size_t N>
+sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>
+make_dist_csr_hamiltonian(MPI_Comm comm, const alpha_sorted_dets<N>& dets,
+                          HamiltonianGenerator<N>& ham_gen,
+                          const double H_thresh, bool upper_triangle = false,
+                          bool balance_rows = false) {
+  using matrix_type =
+      sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>;
+
+  const size_t ndets = dets.ndets;
+  auto make_balanced = [&]() {
+    auto wfn = dets.unpack();
+    return matrix_type(comm, ndets, ndets,
+                       balanced_row_extents<index_t, N>(
+                           comm, wfn.begin(), wfn.end(), ham_gen,
+                           upper_triangle));
+  };
+  auto H_dist =
+      balance_rows ? make_balanced() : matrix_type(comm, ndets, ndets);
+
+  // Local rows against all determinants
+  auto [bra_st, bra_en] = H_dist.row_bounds(comm_rank(comm));
+  auto H_rows = ham_gen.template make_csr_hamiltonian_rows<index_t>(
+      dets, bra_st, bra_en, H_thresh, upper_triangle);
+  auto [H_diag, H_off] =
+      detail::split_column_blocks(std::move(H_rows), bra_st, bra_en);
+
+  H_dist.set_diagonal_tile(std::move(H_diag));
+  if(comm_size(comm) > 1) H_dist.set_off_diagonal_tile(std::move(H_off));
+
+  return H_dist;
+}
+
+// Dist-CSR generation in the spin-flip adapted basis (see
+// make_spin_flip_csr_hamiltonian_block)
+template <typename index_t, size_t N>
+sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>
+make_dist_spin_flip_csr_hamiltonian(MPI_Comm comm,
+                                    wavefunction_iterator_t<N> sd_begin,
+                                    wavefunction_iterator_t<N> sd_end,
+                                    HamiltonianGenerator<N>& ham_gen,
+                                    const double H_thresh) {
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>> H_dist(
+      comm, ndets, ndets);
+  auto [bra_st, bra_en] = H_dist.row_bounds(comm_rank(comm));
+
+  // Build diagonal part
+  H_dist.set_diagonal_tile(make_spin_flip_csr_hamiltonian_block<index_t>(
+      sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_st,
+      sd_begin + bra_en, ham_gen, H_thresh));
+
+  if(comm_size(comm) > 1) {
+    // Spin-flip partners are folded within each column block, such that the
+    // remote kets [0, bra_st) and [bra_en, ndets) are generated separately
+    auto H_left = make_spin_flip_csr_hamiltonian_block<index_t>(
+        sd_begin + bra_st, sd_begin + bra_en, sd_begin, sd_begin + bra_st,
+        ham_gen, H_thresh);
+    auto H_right = make_spin_flip_csr_hamiltonian_block<index_t>(
+        sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_en, sd_end,
+        ham_gen, H_thresh);
+
+    H_dist.set_off_diagonal_tile(macis::detail::merge_column_blocks(
+        std::move(H_left), std::move(H_right), bra_en, ndets));
   }
 
   return H_dist;
@@ -0,0 +1,98 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/types.hpp>
+#include <macis/util/mpi.hpp>
+#include <optional>
+#include <sparsexx/io/binary_csr.hpp>
+#include <sparsexx/util/hash.hpp>
+#include <string>
+
+namespace macis {
+
+/**
+ *  @brief Key of an on-disk Hamiltonian cache.
+ *
+ *  Hash of the (ordered) determinant list, the integrals of the generator
+ *  and the parameters which affect the stored matrix, such that a cache is
+ *  only reused for an identical Hamiltonian.
+ */
+template <size_t N>
+uint64_t hamiltonian_cache_key(wavefunction_iterator_t<N> dets_begin,
+                               wavefunction_iterator_t<N> dets_end,
+                               const HamiltonianGenerator<N>& ham_gen,
+                               double h_el_tol, bool upper_triangle) {
+  using sparsexx::detail::hash_combine;
+  const size_t norb = ham_gen.norb_;
+  const size_t ndets = std::distance(dets_begin, dets_end);
+
+  size_t seed = hash_combine(0, N);
+  seed = hash_combine(seed, ndets);
+  for(auto it = dets_begin; it != dets_end; ++it)
+    seed = hash_combine(seed, *it);
+
+  seed = hash_combine(seed, norb);
+  const auto* T = ham_gen.T();
+  const auto* V = ham_gen.V();
+  for(size_t i = 0; i < norb * norb; ++i) seed = hash_combine(seed, T[i]);
+  for(size_t i = 0; i < norb * norb * norb * norb; ++i)
+    seed = hash_combine(seed, V[i]);
+
+  seed = hash_combine(seed, h_el_tol);
+  seed = hash_combine(seed, upper_triangle);
+  return seed;
+}
+
+/**
+ *  @brief Write a (dist-)CSR Hamiltonian to an on-disk cache.
+ *
+ *  The serial matrix is written to `prefix`, the tiles of a distributed
+ *  matrix to "<prefix>.<rank>".
+ */
+template <typename SpMatType>
+void write_hamiltonian_cache(const SpMatType& H, const std::string& prefix,
+                             uint64_t key) {
+#ifdef MACIS_ENABLE_MPI
+  if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>)
+    sparsexx::write_binary_dist_csr(H, prefix, key);
+  else
+#endif
+    sparsexx::write_binary_csr(H, prefix, key);
+}
+
+/// Memory mapped (dist-)CSR Hamiltonian as loaded from an on-disk cache
+#ifdef MACIS_ENABLE_MPI
+template <typename index_t>
+using mapped_hamiltonian_t =
+    sparsexx::dist_sparse_matrix<sparsexx::mapped_csr_matrix<double, index_t>>;
+#else
+template <typename index_t>
+using mapped_hamiltonian_t = sparsexx::mapped_csr_matrix<double, index_t>;
+#endif
+
+/**
+ *  @brief Map a (dist-)CSR Hamiltonian from an on-disk cache written by
+ *  `write_hamiltonian_cache`.
+ *
+ *  @returns The memory mapped Hamiltonian, empty if the cache does not exist
+ *  or is stale (i.e. does not match `key`)
+ */
+template <typename index_t>
+std::optional<mapped_hamiltonian_t<index_t>> read_hamiltonian_cache(
+    MACIS_MPI_CODE(MPI_Comm comm, ) const std::string& prefix, uint64_t key) {
+#ifdef MACIS_ENABLE_MPI
+  return sparsexx::read_mapped_binary_dist_csr<double, index_t>(comm, prefix,
+                                                                key);
+#else
+  return sparsexx::read_mapped_binary_csr<double, index_t>(prefix, key);
+#endif
+}
+
+}  // namespace macis
@@ -8,7 +8,10 @@
 
 #pragma once
 #include <macis/bitset_operations.hpp>
+#include <macis/hamiltonian_generator/alpha_sorted_dets.hpp>
+#include <macis/hamiltonian_generator/heat_bath.hpp>
 #include <macis/sd_operations.hpp>
+#include <macis/spin_flip.hpp>
 #include <macis/types.hpp>
 #include <sparsexx/matrix_types/csr_matrix.hpp>
 
@@ -63,13 +66,54 @@ class HamiltonianGenerator {
   std::vector<double> V2_red_data_;
   matrix_span_t V2_red_;
 
+  // Orbital irreps (empty if point group symmetry is not used)
+  std::vector<uint32_t> orbsym_;
+
+  // Heat-bath double excitation lists (built on demand)
+  heat_bath_doubles heat_bath_;
+
   virtual sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
       full_det_iterator, full_det_iterator, full_det_iterator,
-      full_det_iterator, double) = 0;
+      full_det_iterator, double, bool) = 0;
 
   virtual sparse_matrix_type<int64_t> make_csr_hamiltonian_block_64bit_(
       full_det_iterator, full_det_iterator, full_det_iterator,
-      full_det_iterator, double) = 0;
+      full_det_iterator, double, bool) = 0;
+
+  virtual sparse_matrix_type<int32_t> make_csr_hamiltonian_rows_32bit_(
+      const alpha_sorted_dets<N>& dets, size_t row_st, size_t row_en,
+      double H_thresh, bool upper_triangle) {
+    return make_csr_hamiltonian_rows_unpacked_<int32_t>(
+        dets, row_st, row_en, H_thresh, upper_triangle);
+  }
+
+  virtual sparse_matrix_type<int64_t> make_csr_hamiltonian_rows_64bit_(
+      const alpha_sorted_dets<N>& dets, size_t row_st, size_t row_en,
+      double H_thresh, bool upper_triangle) {
+    return make_csr_hamiltonian_rows_unpacked_<int64_t>(
+        dets, row_st, row_en, H_thresh, upper_triangle);
+  }
+
+  // Rows of H from the unpacked determinants of a store, for generators
+  // which do not make use of the grouping
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_rows_unpacked_(
+      const alpha_sorted_dets<N>& dets, size_t row_st, size_t row_en,
+      double H_thresh, bool upper_triangle) {
+    auto wfn = dets.unpack();
+    // Only kets to the right of row_st contribute to the upper triangle, the
+    // relative column indices are shifted back below
+    const size_t ket_st = upper_triangle ? row_st : 0;
+    auto H = make_csr_hamiltonian_block<index_t>(
+        wfn.begin() + row_st, wfn.begin() + row_en, wfn.begin() + ket_st,
+        wfn.end(), H_thresh, upper_triangle);
+    if(ket_st)
+      for(auto& j : H.colind()) j += ket_st;
+    return sparse_matrix_type<index_t>(row_en - row_st, dets.ndets,
+                                       std::move(H.rowptr()),
+                                       std::move(H.colind()),
+                                       std::move(H.nzval()));
+  }
 
  public:
   HamiltonianGenerator(matrix_span_t T, rank4_span_t V);
@@ -83,6 +127,36 @@ class HamiltonianGenerator {
   inline auto* G() const { return G_pqrs_data_.data(); }
   inline auto* V() const { return V_pqrs_.data_handle(); }
 
+  /// Set the orbital irreps (see `spin_string_irrep`) used to skip symmetry
+  /// forbidden excitations, an empty `orbsym` disables point group symmetry
+  inline void set_orbital_symmetry(std::vector<uint32_t> orbsym) {
+    if(orbsym.size() and orbsym.size() != norb_)
+      throw std::runtime_error("ORBSYM is of improper dimension");
+    orbsym_ = std::move(orbsym);
+  }
+  inline const auto& orbsym() const { return orbsym_; }
+
+  /// Heat-bath double excitation lists of the current integrals, built if
+  /// absent or if `tol` differs from the one of the current lists. Not
+  /// thread safe, invalidated by `generate_integral_intermediates`
+  inline const heat_bath_doubles& heat_bath(double tol) {
+    if(heat_bath_.empty() or heat_bath_.tol != tol)
+      heat_bath_ = heat_bath_doubles(norb_, G(), V(), tol);
+    return heat_bath_;
+  }
+
+  /// Whether the single excitation i -> a is symmetry allowed
+  inline bool symmetry_allowed(uint32_t i, uint32_t a) const {
+    return orbsym_.empty() or orbsym_[i] == orbsym_[a];
+  }
+
+  /// Whether the double excitation ij -> ab is symmetry allowed
+  inline bool symmetry_allowed(uint32_t i, uint32_t j, uint32_t a,
+                               uint32_t b) const {
+    return orbsym_.empty() or
+           (orbsym_[i] ^ orbsym_[j]) == (orbsym_[a] ^ orbsym_[b]);
+  }
+
   double matrix_element_4(spin_det_t bra, spin_det_t ket, spin_det_t ex) const;
   double matrix_element_22(spin_det_t bra_alpha, spin_det_t ket_alpha,
                            spin_det_t ex_alpha, spin_det_t bra_beta,
@@ -139,16 +213,56 @@ class HamiltonianGenerator {
 
   double matrix_element(full_det_t bra, full_det_t ket) const;
 
+  /// Matrix element between spin-flip adapted functions (see spin_flip.hpp),
+  /// bra and ket are canonical representatives
+  double spin_flip_matrix_element(full_det_t bra, full_det_t ket) const;
+
+  /**
+   *  @brief Generate a (bra x ket) block of the Hamiltonian in CSR format.
+   *
+   *  If `upper_triangle` is set, only elements with ket index >= bra index
+   *  (relative to the beginning of each range) are generated, i.e. the upper
+   *  triangle (including the diagonal) of a diagonal block of H.
+   */
   template <typename index_t>
   sparse_matrix_type<index_t> make_csr_hamiltonian_block(
       full_det_iterator bra_begin, full_det_iterator bra_end,
-      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh) {
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle = false) {
+    if constexpr(std::is_same_v<index_t, int32_t>)
+      return make_csr_hamiltonian_block_32bit_(
+          bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
+    else if constexpr(std::is_same_v<index_t, int64_t>)
+      return make_csr_hamiltonian_block_64bit_(
+          bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
+    else {
+      throw std::runtime_error("Unsupported index_t");
+      abort();
+    }
+  }
+
+  /**
+   *  @brief Generate rows [`row_st`, `row_en`) of the Hamiltonian of the
+   *  determinants of an alpha-sorted store, against all of its determinants.
+   *
+   *  Row (relative to `row_st`) and column indices refer to the original
+   *  ordering of the determinants. If `upper_triangle` is set, only elements
+   *  with column index >= row index (in the original ordering) are
+   *  generated. Generators which do not make use of the grouping generate
+   *  the rows from the unpacked determinants.
+   */
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_rows(
+      const alpha_sorted_dets<N>& dets, size_t row_st, size_t row_en,
+      double H_thresh, bool upper_triangle = false) {
+    if(row_st == row_en or !dets.ndets)
+      return sparse_matrix_type<index_t>(row_en - row_st, dets.ndets, 0, 0);
     if constexpr(std::is_same_v<index_t, int32_t>)
-      return make_csr_hamiltonian_block_32bit_(bra_begin, bra_end, ket_begin,
-                                               ket_end, H_thresh);
+      return make_csr_hamiltonian_rows_32bit_(dets, row_st, row_en, H_thresh,
+                                              upper_triangle);
     else if constexpr(std::is_same_v<index_t, int64_t>)
-      return make_csr_hamiltonian_block_64bit_(bra_begin, bra_end, ket_begin,
-                                               ket_end, H_thresh);
+      return make_csr_hamiltonian_rows_64bit_(dets, row_st, row_en, H_thresh,
+                                              upper_triangle);
     else {
       throw std::runtime_error("Unsupported index_t");
       abort();
@@ -180,11 +294,34 @@ class HamiltonianGenerator {
                          full_det_iterator, full_det_iterator, double* C,
                          matrix_span_t ordm, rank4_span_t trdm) = 0;
 
+  /// Accumulate the RDMs of the determinants of alpha-sorted stores (`C`
+  /// in the original ordering), generators which do not make use of the
+  /// grouping unpack the determinants
+  virtual void form_rdms(const alpha_sorted_dets<N>& bra,
+                         const alpha_sorted_dets<N>& ket, double* C,
+                         matrix_span_t ordm, rank4_span_t trdm) {
+    auto bra_dets = bra.unpack();
+    if(&bra == &ket) {
+      form_rdms(bra_dets.begin(), bra_dets.end(), bra_dets.begin(),
+                bra_dets.end(), C, ordm, trdm);
+    } else {
+      auto ket_dets = ket.unpack();
+      form_rdms(bra_dets.begin(), bra_dets.end(), ket_dets.begin(),
+                ket_dets.end(), C, ordm, trdm);
+    }
+  }
+
   void rotate_hamiltonian_ordm(const double* ordm);
 
   virtual void SetJustSingles(bool /*_js*/) {}
   virtual bool GetJustSingles() { return false; }
   virtual size_t GetNimp() const { return N / 2; }
+
+  /// Work of screening a single ket in the generation of a row of H,
+  /// relative to the evaluation of a matrix element (see
+  /// balanced_row_extents). Zero for generators which only visit connected
+  /// kets
+  virtual double ket_screen_cost() const { return 0.; }
 };
 
 }  // namespace macis
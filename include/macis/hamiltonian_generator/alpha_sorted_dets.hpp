@@ -0,0 +1,256 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <algorithm>
+#include <macis/bitset_operations.hpp>
+#include <macis/sd_operations.hpp>
+#include <macis/types.hpp>
+#include <macis/util/radix_sort.hpp>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace macis {
+
+/**
+ *  @brief Determinants sorted by alpha string, beta strings grouped per alpha
+ *
+ *  Determinants are (stably) sorted by their alpha string and the beta
+ *  strings which share an alpha string are collected into contiguous, sorted
+ *  groups (CSR layout). Zero determinants are skipped. This allows for the
+ *  enumeration of all determinants within a double excitation of a given bra
+ *  without testing every pair:
+ *
+ *    - alpha double: the beta strings must be identical (binary search)
+ *    - alpha single: the beta strings may differ by at most a single
+ *    - alpha equal:  the beta strings may differ by at most a double
+ *
+ *  The occupied orbitals of each alpha string are stored alongside the
+ *  groups. The data needed to generate the excitations of the determinants
+ *  (virtual orbitals, orbital energies and diagonal matrix elements) is
+ *  computed on demand by `compute_excitation_data`.
+ *
+ *  A store is built once per determinant space and shared by the ASCI
+ *  search, the Hamiltonian construction (HamiltonianGenerator::
+ *  make_csr_hamiltonian_rows) and the RDMs (HamiltonianGenerator::form_rdms),
+ *  see asci_iter. It follows the reordering of its determinants (`reorder`)
+ *  and restricts to the leading ones (`prefix`) without sorting again.
+ *
+ *  @tparam N Number of bits for the full determinant representation
+ */
+template <size_t N>
+struct alpha_sorted_dets {
+  using full_det_t = std::bitset<N>;
+  using spin_det_t = std::bitset<N / 2>;
+  using full_det_iterator = wavefunction_iterator_t<N>;
+
+  /// (group index, alpha excitation count) pairs of connected alpha groups
+  using group_list_t = std::vector<std::pair<size_t, uint32_t>>;
+
+  std::vector<spin_det_t> alpha;  ///< Unique alpha strings (sorted)
+  std::vector<size_t> alpha_ptr;  ///< Group offsets into beta / index
+  std::vector<spin_det_t> beta;   ///< Beta strings (sorted per group)
+  std::vector<size_t> index;      ///< Original position of each det
+  std::vector<std::vector<uint32_t>> alpha_occ;  ///< Occupied alpha orbitals
+  size_t ndets = 0;  ///< Size of the original range (including zeros)
+
+  // Excitation data (see compute_excitation_data), per alpha group and per
+  // determinant (in the order of `beta`)
+  std::vector<std::vector<uint32_t>> alpha_vir;  ///< Virtual alpha orbitals
+  std::vector<std::vector<uint32_t>> beta_occ;   ///< Occupied beta orbitals
+  std::vector<std::vector<uint32_t>> beta_vir;   ///< Virtual beta orbitals
+  std::vector<std::vector<double>> orb_ens_alpha;  ///< Alpha orbital energies
+  std::vector<std::vector<double>> orb_ens_beta;   ///< Beta orbital energies
+  std::vector<double> h_diag;  ///< Diagonal matrix elements
+
+  alpha_sorted_dets() = default;
+
+  /// Sort a range of determinants by alpha string
+  alpha_sorted_dets(full_det_iterator begin, full_det_iterator end)
+      : ndets(std::distance(begin, end)) {
+    index.reserve(ndets);
+    for(size_t i = 0; i < ndets; ++i)
+      if((begin + i)->count()) index.emplace_back(i);
+
+    // Alpha-major ordering: swap the spin halves such that the alpha string
+    // occupies the most significant bits of the key
+    radix_sort(index.begin(), index.end(), [&](size_t i) {
+      const auto& det = *(begin + i);
+      return (det << (N / 2)) | (det >> (N / 2));
+    });
+
+    const size_t nnonzero = index.size();
+    beta.resize(nnonzero);
+    for(size_t i = 0; i < nnonzero; ++i) {
+      const auto det = *(begin + index[i]);
+      const auto a = bitset_lo_word(det);
+      beta[i] = bitset_hi_word(det);
+      if(!i or a != alpha.back()) {
+        alpha.emplace_back(a);
+        alpha_ptr.emplace_back(i);
+      }
+    }
+    alpha_ptr.emplace_back(nnonzero);
+
+    alpha_occ.resize(ngroups());
+#pragma omp parallel for schedule(dynamic, 256)
+    for(size_t g = 0; g < ngroups(); ++g)
+      bits_to_indices(alpha[g], alpha_occ[g]);
+  }
+
+  inline size_t ngroups() const { return alpha.size(); }
+  inline size_t nnonzero() const { return index.size(); }
+
+  /// Alpha string of group `g` as a full determinant (beta half empty)
+  inline full_det_t alpha_det(size_t g) const {
+    return expand_bitset<N>(alpha[g]);
+  }
+
+  /// Beta string of determinant `i` (in the order of `beta`) as a full
+  /// determinant (alpha half empty)
+  inline full_det_t beta_det(size_t i) const {
+    return expand_bitset<N>(beta[i]) << (N / 2);
+  }
+
+  /// Determinants in their original ordering
+  std::vector<full_det_t> unpack() const {
+    std::vector<full_det_t> dets(ndets);
+#pragma omp parallel for schedule(dynamic, 256)
+    for(size_t g = 0; g < ngroups(); ++g)
+      for(size_t i = alpha_ptr[g]; i < alpha_ptr[g + 1]; ++i)
+        dets[index[i]] = alpha_det(g) | beta_det(i);
+    return dets;
+  }
+
+  /**
+   *  @brief Follow a reordering of the original determinants.
+   *
+   *  `idx[i]` is the previous position of the determinant at position `i`
+   *  (e.g. as returned by reorder_ci_on_coeff). The grouping is unchanged,
+   *  such that the store remains sorted.
+   */
+  void reorder(const std::vector<uint64_t>& idx) {
+    if(idx.size() != ndets)
+      throw std::runtime_error("alpha_sorted_dets: reordering of wrong size");
+    std::vector<size_t> new_pos(ndets);
+    for(size_t i = 0; i < ndets; ++i) new_pos[idx[i]] = i;
+    for(auto& i : index) i = new_pos[i];
+  }
+
+  /// Store of the leading `n` original determinants (without excitation
+  /// data)
+  alpha_sorted_dets prefix(size_t n) const {
+    alpha_sorted_dets sub;
+    sub.ndets = std::min(n, ndets);
+    for(size_t g = 0; g < ngroups(); ++g) {
+      const size_t nnonzero_st = sub.nnonzero();
+      for(size_t i = alpha_ptr[g]; i < alpha_ptr[g + 1]; ++i) {
+        if(index[i] >= n) continue;
+        sub.beta.emplace_back(beta[i]);
+        sub.index.emplace_back(index[i]);
+      }
+      if(sub.nnonzero() == nnonzero_st) continue;
+      sub.alpha.emplace_back(alpha[g]);
+      sub.alpha_ptr.emplace_back(nnonzero_st);
+      sub.alpha_occ.emplace_back(alpha_occ[g]);
+    }
+    sub.alpha_ptr.emplace_back(sub.nnonzero());
+    return sub;
+  }
+
+  /// Whether the excitation data has been computed
+  inline bool has_excitation_data() const {
+    return h_diag.size() == nnonzero() and alpha_vir.size() == ngroups();
+  }
+
+  /**
+   *  @brief Compute the excitation data of the determinants.
+   *
+   *  Virtual orbitals of the alpha strings, and per determinant the occupied
+   *  / virtual beta orbitals, the orbital energies (single_orbital_ens) and
+   *  the diagonal matrix element. Depends on the integrals of `ham_gen`.
+   */
+  template <typename HamiltonianGeneratorType>
+  void compute_excitation_data(size_t norb,
+                               const HamiltonianGeneratorType& ham_gen) {
+    const size_t nnz = nnonzero();
+    alpha_vir.assign(ngroups(), {});
+    beta_occ.assign(nnz, {});
+    beta_vir.assign(nnz, {});
+    orb_ens_alpha.assign(nnz, {});
+    orb_ens_beta.assign(nnz, {});
+    h_diag.assign(nnz, 0.);
+#pragma omp parallel
+    {
+      std::vector<uint32_t> occ;
+#pragma omp for schedule(dynamic)
+      for(size_t g = 0; g < ngroups(); ++g) {
+        bitset_to_occ_vir(norb, alpha[g], occ, alpha_vir[g]);
+        for(size_t i = alpha_ptr[g]; i < alpha_ptr[g + 1]; ++i) {
+          bitset_to_occ_vir(norb, beta[i], beta_occ[i], beta_vir[i]);
+          orb_ens_alpha[i] =
+              ham_gen.single_orbital_ens(norb, alpha_occ[g], beta_occ[i]);
+          orb_ens_beta[i] =
+              ham_gen.single_orbital_ens(norb, beta_occ[i], alpha_occ[g]);
+          const auto det = alpha_det(g) | beta_det(i);
+          h_diag[i] = ham_gen.matrix_element(det, det);
+        }
+      }
+    }
+  }
+
+  /// Collect the alpha groups reachable from an alpha string
+  void connected_groups(spin_det_t bra_alpha, group_list_t& groups) const {
+    groups.clear();
+    for(size_t g = 0; g < ngroups(); ++g) {
+      const uint32_t ex_count = (bra_alpha ^ alpha[g]).count();
+      if(ex_count <= 4) groups.emplace_back(g, ex_count);
+    }
+  }
+
+  /**
+   *  @brief Visit all determinants which may couple to a particular bra.
+   *
+   *  Calls f(j, ket_alpha, ex_alpha, ket_beta, ex_beta) for each determinant
+   *  (original position j) within a double excitation of the bra.
+   *
+   *  @param[in] groups Output of `connected_groups` for `bra_alpha`
+   */
+  template <typename Func>
+  void visit_connected(spin_det_t bra_alpha, spin_det_t bra_beta,
+                       const group_list_t& groups, Func&& f) const {
+    for(auto [g, ex_alpha_count] : groups) {
+      const auto ket_alpha = alpha[g];
+      const auto ex_alpha = bra_alpha ^ ket_alpha;
+      const auto beta_st = beta.begin() + alpha_ptr[g];
+      const auto beta_en = beta.begin() + alpha_ptr[g + 1];
+
+      if(ex_alpha_count == 4) {
+        // Only the identical beta string can couple
+        auto it = std::lower_bound(beta_st, beta_en, bra_beta,
+                                   bitset_less_comparator<N / 2>{});
+        if(it != beta_en and *it == bra_beta) {
+          const size_t jj = std::distance(beta.begin(), it);
+          f(index[jj], ket_alpha, ex_alpha, bra_beta, spin_det_t(0));
+        }
+      } else {
+        const uint32_t max_ex_beta = 4 - ex_alpha_count;
+        for(auto it = beta_st; it != beta_en; ++it) {
+          const auto ex_beta = bra_beta ^ *it;
+          if(ex_beta.count() > max_ex_beta) continue;
+          const size_t jj = std::distance(beta.begin(), it);
+          f(index[jj], ket_alpha, ex_alpha, *it, ex_beta);
+        }
+      }
+    }
+  }
+};
+
+}  // namespace macis
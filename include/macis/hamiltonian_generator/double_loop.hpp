@@ -8,8 +8,10 @@
 
 #pragma once
 #include <macis/hamiltonian_generator.hpp>
+#include <macis/hamming_screen.hpp>
 #include <macis/sd_operations.hpp>
 #include <macis/util/rdms.hpp>
+#include <numeric>
 
 namespace macis {
 
@@ -27,71 +29,117 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
   using sparse_matrix_type = sparsexx::csr_matrix<double, index_t>;
 
  protected:
+  /// Number of kets screened by Hamming distance at a time
+  inline static constexpr size_t screen_block_ = 4096;
+
+  /**
+   *  @brief Visit the non-zero Hamiltonian elements of a single bra row.
+   *
+   *  Calls f(j, h_el) for each ket determinant j in [j_begin, j_end) (in
+   *  order) whose matrix element with the bra exceeds H_thresh in
+   *  magnitude. Kets are prescreened in blocks by their Hamming distance to
+   *  the bra (see `hamming_screen`), only the survivors are passed to
+   *  `matrix_element`.
+   */
+  template <typename Func>
+  void visit_row_(full_det_t bra, full_det_iterator ket_begin,
+                  const bitset_soa<N>& kets, size_t j_begin, size_t j_end,
+                  double H_thresh, std::vector<uint32_t>& bra_occ_alpha,
+                  std::vector<uint32_t>& bra_occ_beta,
+                  std::vector<uint32_t>& candidates, Func&& f) const {
+    if(!bra.count()) return;
+
+    // Separate out into alpha/beta components
+    spin_det_t bra_alpha = bitset_lo_word(bra);
+    spin_det_t bra_beta = bitset_hi_word(bra);
+
+    // Get occupied indices
+    bits_to_indices(bra_alpha, bra_occ_alpha);
+    bits_to_indices(bra_beta, bra_occ_beta);
+
+    // Loop over blocks of ket determinants
+    candidates.resize(screen_block_);
+    for(size_t j_blk = j_begin; j_blk < j_end; j_blk += screen_block_) {
+      // Possible non-zero connections (Hamming distance)
+      const size_t ncand = hamming_screen(
+          bra, kets, j_blk, std::min(j_blk + screen_block_, j_end), 4,
+          candidates.data());
+
+      for(size_t c = 0; c < ncand; ++c) {
+        const size_t j = candidates[c];
+        const auto ket = *(ket_begin + j);
+        if(!ket.count()) continue;
+
+        spin_det_t ket_alpha = bitset_lo_word(ket);
+        spin_det_t ket_beta = bitset_hi_word(ket);
+
+        full_det_t ex_total = bra ^ ket;
+        spin_det_t ex_alpha = bitset_lo_word(ex_total);
+        spin_det_t ex_beta = bitset_hi_word(ex_total);
+
+        // Compute Matrix Element
+        const auto h_el = this->matrix_element(
+            bra_alpha, ket_alpha, ex_alpha, bra_beta, ket_beta, ex_beta,
+            bra_occ_alpha, bra_occ_beta);
+
+        if(std::abs(h_el) > H_thresh) f(j, h_el);
+      }  // Loop over candidate kets
+    }    // Loop over ket blocks
+  }
+
   template <typename index_t>
   sparse_matrix_type<index_t> make_csr_hamiltonian_block_(
       full_det_iterator bra_begin, full_det_iterator bra_end,
-      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh) {
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle) {
     const size_t nbra_dets = std::distance(bra_begin, bra_end);
     const size_t nket_dets = std::distance(ket_begin, ket_end);
 
-    std::vector<index_t> colind, rowptr(nbra_dets + 1);
-    std::vector<double> nzval;
-
-    std::vector<uint32_t> bra_occ_alpha, bra_occ_beta;
+    // Ket words for the Hamming distance screening
+    const bitset_soa<N> kets(ket_begin, ket_end);
 
+    std::vector<index_t> rowptr(nbra_dets + 1);
     rowptr[0] = 0;
 
-    // Loop over bra determinants
-    for(size_t i = 0; i < nbra_dets; ++i) {
-      // if( (i%1000) == 0 ) std::cout << i << ", " << rowptr[i] << std::endl;
-      const auto bra = *(bra_begin + i);
-
-      size_t nrow = 0;
-      if(bra.count()) {
-        // Separate out into alpha/beta components
-        spin_det_t bra_alpha = bitset_lo_word(bra);
-        spin_det_t bra_beta = bitset_hi_word(bra);
-
-        // Get occupied indices
-        bits_to_indices(bra_alpha, bra_occ_alpha);
-        bits_to_indices(bra_beta, bra_occ_beta);
-
-        // Loop over ket determinants
-        for(size_t j = 0; j < nket_dets; ++j) {
-          const auto ket = *(ket_begin + j);
-          if(ket.count()) {
-            spin_det_t ket_alpha = bitset_lo_word(ket);
-            spin_det_t ket_beta = bitset_hi_word(ket);
-
-            full_det_t ex_total = bra ^ ket;
-            if(ex_total.count() <= 4) {
-              spin_det_t ex_alpha = bitset_lo_word(ex_total);
-              spin_det_t ex_beta = bitset_hi_word(ex_total);
-
-              // Compute Matrix Element
-              const auto h_el = this->matrix_element(
-                  bra_alpha, ket_alpha, ex_alpha, bra_beta, ket_beta, ex_beta,
-                  bra_occ_alpha, bra_occ_beta);
-
-              if(std::abs(h_el) > H_thresh) {
-                nrow++;
-                colind.emplace_back(j);
-                nzval.emplace_back(h_el);
-              }
-
-            }  // Possible non-zero connection (Hamming distance)
-
-          }  // Non-zero ket determinant
-        }    // Loop over ket determinants
-
-      }  // Non-zero bra determinant
-
-      rowptr[i + 1] = rowptr[i] + nrow;  // Update rowptr
-
-    }  // Loop over bra determinants
-
-    colind.shrink_to_fit();
-    nzval.shrink_to_fit();
+    // Count pass: number of non-zeros per bra row
+#pragma omp parallel
+    {
+      std::vector<uint32_t> bra_occ_alpha, bra_occ_beta, candidates;
+#pragma omp for schedule(dynamic)
+      for(size_t i = 0; i < nbra_dets; ++i) {
+        index_t nrow = 0;
+        const size_t j_st = upper_triangle ? std::min(i, nket_dets) : 0;
+        visit_row_(*(bra_begin + i), ket_begin, kets, j_st, nket_dets,
+                   H_thresh, bra_occ_alpha, bra_occ_beta, candidates,
+                   [&](size_t, double) { nrow++; });
+        rowptr[i + 1] = nrow;
+      }
+    }
+
+    // Scan row counts into row offsets
+    std::partial_sum(rowptr.begin(), rowptr.end(), rowptr.begin());
+
+    const size_t nnz = rowptr.back();
+    std::vector<index_t> colind(nnz);
+    std::vector<double> nzval(nnz);
+
+    // Fill pass: each row writes into its own (exactly sized) segment
+#pragma omp parallel
+    {
+      std::vector<uint32_t> bra_occ_alpha, bra_occ_beta, candidates;
+#pragma omp for schedule(dynamic)
+      for(size_t i = 0; i < nbra_dets; ++i) {
+        size_t k = rowptr[i];
+        const size_t j_st = upper_triangle ? std::min(i, nket_dets) : 0;
+        visit_row_(*(bra_begin + i), ket_begin, kets, j_st, nket_dets,
+                   H_thresh, bra_occ_alpha, bra_occ_beta, candidates,
+                   [&](size_t j, double h_el) {
+                     colind[k] = j;
+                     nzval[k] = h_el;
+                     k++;
+                   });
+      }
+    }
 
     return sparse_matrix_type<index_t>(nbra_dets, nket_dets, std::move(rowptr),
                                        std::move(colind), std::move(nzval));
@@ -99,28 +147,34 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
 
   sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
       full_det_iterator bra_begin, full_det_iterator bra_end,
-      full_det_iterator ket_begin, full_det_iterator ket_end,
-      double H_thresh) override {
-    return make_csr_hamiltonian_block_<int32_t>(bra_begin, bra_end, ket_begin,
-                                                ket_end, H_thresh);
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle) override {
+    return make_csr_hamiltonian_block_<int32_t>(
+        bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
   }
 
   sparse_matrix_type<int64_t> make_csr_hamiltonian_block_64bit_(
       full_det_iterator bra_begin, full_det_iterator bra_end,
-      full_det_iterator ket_begin, full_det_iterator ket_end,
-      double H_thresh) override {
-    return make_csr_hamiltonian_block_<int64_t>(bra_begin, bra_end, ket_begin,
-                                                ket_end, H_thresh);
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle) override {
+    return make_csr_hamiltonian_block_<int64_t>(
+        bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
   }
 
  public:
+  using base_type::form_rdms;
+
   void form_rdms(full_det_iterator bra_begin, full_det_iterator bra_end,
                  full_det_iterator ket_begin, full_det_iterator ket_end,
                  double *C, matrix_span_t ordm, rank4_span_t trdm) override {
     const size_t nbra_dets = std::distance(bra_begin, bra_end);
     const size_t nket_dets = std::distance(ket_begin, ket_end);
 
+    // Ket words for the Hamming distance screening
+    const bitset_soa<N> kets(ket_begin, ket_end);
+
     std::vector<uint32_t> bra_occ_alpha, bra_occ_beta;
+    std::vector<uint32_t> candidates(screen_block_);
 
     // Loop over bra determinants
     for(size_t i = 0; i < nbra_dets; ++i) {
@@ -135,36 +189,45 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
         bits_to_indices(bra_alpha, bra_occ_alpha);
         bits_to_indices(bra_beta, bra_occ_beta);
 
-        // Loop over ket determinants
-        for(size_t j = 0; j < nket_dets; ++j) {
-          const auto ket = *(ket_begin + j);
-          if(ket.count()) {
+        // Loop over blocks of ket determinants
+        for(size_t j_blk = 0; j_blk < nket_dets; j_blk += screen_block_) {
+          // Possible non-zero connections (Hamming distance)
+          const size_t ncand = hamming_screen(
+              bra, kets, j_blk, std::min(j_blk + screen_block_, nket_dets), 4,
+              candidates.data());
+
+          for(size_t c = 0; c < ncand; ++c) {
+            const size_t j = candidates[c];
+            const auto ket = *(ket_begin + j);
+            if(!ket.count()) continue;
+
             spin_det_t ket_alpha = bitset_lo_word(ket);
             spin_det_t ket_beta = bitset_hi_word(ket);
 
             full_det_t ex_total = bra ^ ket;
-            if(ex_total.count() <= 4) {
-              spin_det_t ex_alpha = bitset_lo_word(ex_total);
-              spin_det_t ex_beta = bitset_hi_word(ex_total);
+            spin_det_t ex_alpha = bitset_lo_word(ex_total);
+            spin_det_t ex_beta = bitset_hi_word(ex_total);
 
-              const double val = C[i] * C[j];
+            const double val = C[i] * C[j];
 
-              // Compute Matrix Element
-              if(std::abs(val) > 1e-16) {
-                rdm_contributions(bra_alpha, ket_alpha, ex_alpha, bra_beta,
-                                  ket_beta, ex_beta, bra_occ_alpha,
-                                  bra_occ_beta, val, ordm, trdm);
-              }
-            }  // Possible non-zero connection (Hamming distance)
-
-          }  // Non-zero ket determinant
-        }    // Loop over ket determinants
+            // Compute Matrix Element
+            if(std::abs(val) > 1e-16) {
+              rdm_contributions(bra_alpha, ket_alpha, ex_alpha, bra_beta,
+                                ket_beta, ex_beta, bra_occ_alpha, bra_occ_beta,
+                                val, ordm, trdm);
+            }
+          }  // Loop over candidate kets
+        }    // Loop over ket blocks
 
       }  // Non-zero bra determinant
     }    // Loop over bra determinants
   }
 
  public:
+  /// Every ket is screened by Hamming distance, which takes about 3% of the
+  /// time of a matrix element (scalar screening, H2O cc-pVDZ CISD space)
+  double ket_screen_cost() const override { return 0.03; }
+
   template <typename... Args>
   DoubleLoopHamiltonianGenerator(Args &&...args)
       : HamiltonianGenerator<N>(std::forward<Args>(args)...) {}
@@ -0,0 +1,119 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace macis {
+
+/**
+ *  @brief Heat-bath lists of double excitations.
+ *
+ *  For each pair of holes (i,j), the particle pairs (a,b) together with the
+ *  integral of the excitation ij -> ab, sorted by decreasing magnitude:
+ *
+ *    - same spin (i < j, a < b):   G(a,i,b,j) = (ai|bj) - (aj|bi)
+ *    - opposite spin (i alpha, j beta): V(a,i,b,j) = (ai|bj)
+ *
+ *  Integrals below `tol` (and vanishing ones) are dropped. The double
+ *  excitations of a determinant with a screening threshold >= `tol` on the
+ *  integral are then enumerated by traversing the lists of its occupied
+ *  pairs up to the first integral below the threshold (skipping occupied
+ *  particles), rather than by visiting every (i,a,j,b).
+ */
+struct heat_bath_doubles {
+  struct entry {
+    double val;  ///< Integral of the excitation
+    uint32_t a;  ///< First particle
+    uint32_t b;  ///< Second particle
+  };
+
+  size_t norb = 0;
+  double tol = -1.;
+  std::vector<size_t> ss_ptr;  ///< Same spin list offsets by i * norb + j
+  std::vector<entry> ss;       ///< Same spin lists
+  std::vector<size_t> os_ptr;  ///< Opposite spin list offsets by i * norb + j
+  std::vector<entry> os;       ///< Opposite spin lists
+
+  heat_bath_doubles() = default;
+
+  /**
+   *  @param[in] _norb Number of orbitals
+   *  @param[in] G     Antisymmetrized integrals (see HamiltonianGenerator)
+   *  @param[in] V     Two-electron integrals
+   *  @param[in] _tol  Smallest integral magnitude to keep
+   */
+  heat_bath_doubles(size_t _norb, const double* G, const double* V,
+                    double _tol)
+      : norb(_norb), tol(_tol) {
+    const size_t norb2 = norb * norb;
+    build(ss_ptr, ss, [&](size_t i, size_t j, size_t a, size_t b) {
+      if(j <= i or b <= a or a == i or a == j or b == i or b == j) return 0.;
+      return G[(a + i * norb) * norb2 + b + j * norb];
+    });
+    build(os_ptr, os, [&](size_t i, size_t j, size_t a, size_t b) {
+      if(a == i or b == j) return 0.;
+      return V[a + i * norb + (b + j * norb) * norb2];
+    });
+  }
+
+  inline bool empty() const { return ss_ptr.empty(); }
+
+  inline const entry* ss_begin(uint32_t i, uint32_t j) const {
+    return ss.data() + ss_ptr[i * norb + j];
+  }
+  inline const entry* ss_end(uint32_t i, uint32_t j) const {
+    return ss.data() + ss_ptr[i * norb + j + 1];
+  }
+  inline const entry* os_begin(uint32_t i, uint32_t j) const {
+    return os.data() + os_ptr[i * norb + j];
+  }
+  inline const entry* os_end(uint32_t i, uint32_t j) const {
+    return os.data() + os_ptr[i * norb + j + 1];
+  }
+
+ private:
+  /// Collect the (non-zero) integrals `integral(i,j,a,b)` >= tol for each
+  /// (i,j), excluded excitations are reported as zero
+  template <typename Integral>
+  void build(std::vector<size_t>& ptr, std::vector<entry>& list,
+             Integral&& integral) {
+    const size_t norb2 = norb * norb;
+    auto keep = [&](double val) { return val != 0. and std::abs(val) >= tol; };
+    ptr.assign(norb2 + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+    for(size_t ij = 0; ij < norb2; ++ij) {
+      const size_t i = ij / norb, j = ij % norb;
+      for(size_t a = 0; a < norb; ++a)
+        for(size_t b = 0; b < norb; ++b)
+          ptr[ij + 1] += keep(integral(i, j, a, b));
+    }
+    std::partial_sum(ptr.begin(), ptr.end(), ptr.begin());
+
+    list.resize(ptr.back());
+#pragma omp parallel for schedule(dynamic)
+    for(size_t ij = 0; ij < norb2; ++ij) {
+      const size_t i = ij / norb, j = ij % norb;
+      auto* it = list.data() + ptr[ij];
+      for(size_t a = 0; a < norb; ++a)
+        for(size_t b = 0; b < norb; ++b) {
+          const double val = integral(i, j, a, b);
+          if(keep(val)) *(it++) = {val, uint32_t(a), uint32_t(b)};
+        }
+      std::sort(list.data() + ptr[ij], it, [](const auto& x, const auto& y) {
+        return std::abs(x.val) > std::abs(y.val);
+      });
+    }
+  }
+};
+
+}  // namespace macis
@@ -67,6 +67,9 @@ void HamiltonianGenerator<N>::generate_integral_intermediates(rank4_span_t V) {
       G2_red_(i, j) = 0.5 * G_pqrs_(i, i, j, j);
       V2_red_(i, j) = V(i, i, j, j);
     }
+
+  // Heat-bath lists refer to the previous integrals
+  heat_bath_ = heat_bath_doubles();
 }
 
 }  // namespace macis
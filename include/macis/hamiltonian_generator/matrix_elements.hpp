@@ -29,6 +29,14 @@ double HamiltonianGenerator<N>::matrix_element(full_det_t bra,
                         ex_beta, bra_occ_alpha, bra_occ_beta);
 }
 
+template <size_t N>
+double HamiltonianGenerator<N>::spin_flip_matrix_element(full_det_t bra,
+                                                         full_det_t ket) const {
+  const double scale = 2. * spin_flip_norm(bra) * spin_flip_norm(ket);
+  return scale *
+         (matrix_element(bra, ket) + matrix_element(bra, spin_flip(ket)));
+}
+
 template <size_t N>
 double HamiltonianGenerator<N>::matrix_element(
     spin_det_t bra_alpha, spin_det_t ket_alpha, spin_det_t ex_alpha,
@@ -0,0 +1,248 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <algorithm>
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/hamiltonian_generator/alpha_sorted_dets.hpp>
+#include <macis/sd_operations.hpp>
+#include <macis/util/rdms.hpp>
+#include <numeric>
+
+namespace macis {
+
+/**
+ *  @brief Hamiltonian generator which groups determinants by alpha string.
+ *
+ *  Determinants are sorted into alpha_sorted_dets, such that only pairs of
+ *  alpha strings which differ by at most a double excitation are visited,
+ *  and within those, only beta strings which remain in the excitation budget
+ *  are considered.
+ *
+ *  The input determinants need not be sorted; row and column indices of the
+ *  generated matrices refer to the original ordering of the bra and ket
+ *  ranges, respectively, and are identical to those generated by
+ *  DoubleLoopHamiltonianGenerator.
+ */
+template <size_t N>
+class SortedDoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
+ public:
+  using base_type = HamiltonianGenerator<N>;
+  using full_det_t = typename base_type::full_det_t;
+  using spin_det_t = typename base_type::spin_det_t;
+  using full_det_iterator = typename base_type::full_det_iterator;
+  using matrix_span_t = typename base_type::matrix_span_t;
+  using rank4_span_t = typename base_type::rank4_span_t;
+
+  template <typename index_t>
+  using sparse_matrix_type = sparsexx::csr_matrix<double, index_t>;
+
+ protected:
+  using group_list_t = typename alpha_sorted_dets<N>::group_list_t;
+
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_block_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle) {
+    const bool same_range = bra_begin == ket_begin and bra_end == ket_end;
+    sorted_dets_t bra_sorted(bra_begin, bra_end);
+    auto ket_sorted =
+        same_range ? sorted_dets_t{} : sorted_dets_t(ket_begin, ket_end);
+    const auto& ket = same_range ? bra_sorted : ket_sorted;
+    return make_csr_hamiltonian_block<index_t>(bra_sorted, ket, H_thresh,
+                                               upper_triangle);
+  }
+
+  sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle) override {
+    return make_csr_hamiltonian_block_<int32_t>(
+        bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
+  }
+
+  sparse_matrix_type<int64_t> make_csr_hamiltonian_block_64bit_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh,
+      bool upper_triangle) override {
+    return make_csr_hamiltonian_block_<int64_t>(
+        bra_begin, bra_end, ket_begin, ket_end, H_thresh, upper_triangle);
+  }
+
+  sparse_matrix_type<int32_t> make_csr_hamiltonian_rows_32bit_(
+      const alpha_sorted_dets<N>& dets, size_t row_st, size_t row_en,
+      double H_thresh, bool upper_triangle) override {
+    return make_csr_hamiltonian_rows_<int32_t>(dets, row_st, row_en, dets,
+                                               H_thresh, upper_triangle);
+  }
+
+  sparse_matrix_type<int64_t> make_csr_hamiltonian_rows_64bit_(
+      const alpha_sorted_dets<N>& dets, size_t row_st, size_t row_en,
+      double H_thresh, bool upper_triangle) override {
+    return make_csr_hamiltonian_rows_<int64_t>(dets, row_st, row_en, dets,
+                                               H_thresh, upper_triangle);
+  }
+
+  // Rows [row_st, row_en) (original ordering of the bras) of a (bra x ket)
+  // block, elements with ket index < bra index are skipped if
+  // upper_triangle is set
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_rows_(
+      const alpha_sorted_dets<N>& bra_sorted, size_t row_st, size_t row_en,
+      const alpha_sorted_dets<N>& ket, double H_thresh, bool upper_triangle) {
+    const size_t nrow = row_en - row_st;
+    const size_t nket_dets = ket.ndets;
+    auto in_rows = [&](size_t i) { return i >= row_st and i < row_en; };
+
+    std::vector<std::vector<std::pair<index_t, double>>> rows(nrow);
+
+#pragma omp parallel
+    {
+      std::vector<uint32_t> bra_occ_beta;
+      group_list_t ket_groups;
+
+      // Loop over bra alpha strings (rows of distinct bras are disjoint)
+#pragma omp for schedule(dynamic)
+      for(size_t ig = 0; ig < bra_sorted.ngroups(); ++ig) {
+        const auto ii_st = bra_sorted.index.begin() + bra_sorted.alpha_ptr[ig];
+        const auto ii_en =
+            bra_sorted.index.begin() + bra_sorted.alpha_ptr[ig + 1];
+        if(std::none_of(ii_st, ii_en, in_rows)) continue;
+
+        const auto bra_alpha = bra_sorted.alpha[ig];
+        const auto& bra_occ_alpha = bra_sorted.alpha_occ[ig];
+        ket.connected_groups(bra_alpha, ket_groups);
+        if(ket_groups.empty()) continue;
+
+        // Loop over bra beta strings which share this alpha string
+        for(size_t ii = bra_sorted.alpha_ptr[ig];
+            ii < bra_sorted.alpha_ptr[ig + 1]; ++ii) {
+          const auto i = bra_sorted.index[ii];
+          if(not in_rows(i)) continue;
+          const auto bra_beta = bra_sorted.beta[ii];
+          bits_to_indices(bra_beta, bra_occ_beta);
+
+          auto& row = rows[i - row_st];
+          ket.visit_connected(
+              bra_alpha, bra_beta, ket_groups,
+              [&](size_t j, spin_det_t ket_alpha, spin_det_t ex_alpha,
+                  spin_det_t ket_beta, spin_det_t ex_beta) {
+                if(upper_triangle and j < i) return;
+                const auto h_el = this->matrix_element(
+                    bra_alpha, ket_alpha, ex_alpha, bra_beta, ket_beta, ex_beta,
+                    bra_occ_alpha, bra_occ_beta);
+                if(std::abs(h_el) > H_thresh) row.emplace_back(j, h_el);
+              });
+
+          // Restore column ordering of the original ket range
+          std::sort(row.begin(), row.end(),
+                    [](auto a, auto b) { return a.first < b.first; });
+        }
+      }
+    }
+
+    // Pack into CSR
+    std::vector<index_t> rowptr(nrow + 1);
+    rowptr[0] = 0;
+    for(size_t i = 0; i < nrow; ++i)
+      rowptr[i + 1] = rowptr[i] + rows[i].size();
+
+    const size_t nnz = rowptr.back();
+    std::vector<index_t> colind(nnz);
+    std::vector<double> nzval(nnz);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for(size_t i = 0; i < nrow; ++i) {
+      auto& row = rows[i];
+      for(size_t k = 0; k < row.size(); ++k) {
+        colind[rowptr[i] + k] = row[k].first;
+        nzval[rowptr[i] + k] = row[k].second;
+      }
+      std::vector<std::pair<index_t, double>>().swap(row);
+    }
+
+    return sparse_matrix_type<index_t>(nrow, nket_dets, std::move(rowptr),
+                                       std::move(colind), std::move(nzval));
+  }
+
+ public:
+  using sorted_dets_t = alpha_sorted_dets<N>;
+  using base_type::make_csr_hamiltonian_block;
+
+  /**
+   *  @brief Generate a (bra x ket) block of the Hamiltonian from prebuilt
+   *  alpha-sorted determinant stores.
+   *
+   *  Row and column indices refer to the original ordering of the ranges
+   *  from which `bra_sorted` and `ket` were constructed. Passing the same
+   *  store as bra and ket (and reusing it for e.g. `form_rdms`) avoids
+   *  regrouping the determinants. For a single store, the rows are also
+   *  available through HamiltonianGenerator::make_csr_hamiltonian_rows.
+   */
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_block(
+      const sorted_dets_t& bra_sorted, const sorted_dets_t& ket,
+      double H_thresh, bool upper_triangle = false) {
+    return make_csr_hamiltonian_rows_<index_t>(
+        bra_sorted, 0, bra_sorted.ndets, ket, H_thresh, upper_triangle);
+  }
+
+  void form_rdms(full_det_iterator bra_begin, full_det_iterator bra_end,
+                 full_det_iterator ket_begin, full_det_iterator ket_end,
+                 double *C, matrix_span_t ordm, rank4_span_t trdm) override {
+    const bool same_range = bra_begin == ket_begin and bra_end == ket_end;
+    sorted_dets_t bra_sorted(bra_begin, bra_end);
+    auto ket_sorted =
+        same_range ? sorted_dets_t{} : sorted_dets_t(ket_begin, ket_end);
+    const auto& ket = same_range ? bra_sorted : ket_sorted;
+
+    form_rdms(bra_sorted, ket, C, ordm, trdm);
+  }
+
+  /// Accumulate the RDMs from prebuilt alpha-sorted determinant stores
+  void form_rdms(const sorted_dets_t& bra_sorted, const sorted_dets_t& ket,
+                 double *C, matrix_span_t ordm, rank4_span_t trdm) override {
+    std::vector<uint32_t> bra_occ_beta;
+    group_list_t ket_groups;
+
+    // Loop over bra alpha strings
+    for(size_t ig = 0; ig < bra_sorted.ngroups(); ++ig) {
+      const auto bra_alpha = bra_sorted.alpha[ig];
+      const auto& bra_occ_alpha = bra_sorted.alpha_occ[ig];
+      ket.connected_groups(bra_alpha, ket_groups);
+      if(ket_groups.empty()) continue;
+
+      // Loop over bra beta strings which share this alpha string
+      for(size_t ii = bra_sorted.alpha_ptr[ig];
+          ii < bra_sorted.alpha_ptr[ig + 1]; ++ii) {
+        const auto bra_beta = bra_sorted.beta[ii];
+        bits_to_indices(bra_beta, bra_occ_beta);
+
+        const auto i = bra_sorted.index[ii];
+        ket.visit_connected(
+            bra_alpha, bra_beta, ket_groups,
+            [&](size_t j, spin_det_t ket_alpha, spin_det_t ex_alpha,
+                spin_det_t ket_beta, spin_det_t ex_beta) {
+              const double val = C[i] * C[j];
+              if(std::abs(val) > 1e-16) {
+                rdm_contributions(bra_alpha, ket_alpha, ex_alpha, bra_beta,
+                                  ket_beta, ex_beta, bra_occ_alpha,
+                                  bra_occ_beta, val, ordm, trdm);
+              }
+            });
+      }
+    }
+  }
+
+ public:
+  template <typename... Args>
+  SortedDoubleLoopHamiltonianGenerator(Args &&...args)
+      : HamiltonianGenerator<N>(std::forward<Args>(args)...) {}
+};
+
+}  // namespace macis
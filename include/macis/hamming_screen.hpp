@@ -0,0 +1,241 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <cstring>
+#include <macis/types.hpp>
+#include <vector>
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#define MACIS_HAMMING_AVX512
+#endif
+#if defined(__AVX2__)
+#define MACIS_HAMMING_AVX2
+#endif
+#if defined(MACIS_HAMMING_AVX512) || defined(MACIS_HAMMING_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace macis {
+
+/**
+ *  @brief Structure-of-arrays storage of a list of bitsets.
+ *
+ *  The bitsets are split into 64-bit words, and the `w`-th words of all
+ *  bitsets are stored contiguously, such that a block of bitsets may be
+ *  processed with (vector) loads of consecutive elements.
+ *
+ *  @tparam N Width of the bitsets, must be a multiple of 64
+ */
+template <size_t N>
+class bitset_soa {
+  static_assert(N % 64 == 0, "N Must Be a Multiple of 64");
+
+ public:
+  constexpr static size_t nwords = N / 64;
+
+ protected:
+  size_t n_ = 0;
+  std::vector<uint64_t> words_;  ///< words_[w * n_ + j]
+
+ public:
+  bitset_soa() = default;
+
+  bitset_soa(wavefunction_iterator_t<N> begin, wavefunction_iterator_t<N> end)
+      : n_(std::distance(begin, end)), words_(nwords * n_) {
+#pragma omp parallel for schedule(static)
+    for(size_t j = 0; j < n_; ++j) {
+      uint64_t w_j[nwords];
+      std::memcpy(w_j, &*(begin + j), sizeof(w_j));
+      for(size_t w = 0; w < nwords; ++w) words_[w * n_ + j] = w_j[w];
+    }
+  }
+
+  inline size_t size() const { return n_; }
+
+  /// Contiguous `w`-th words of all bitsets
+  inline const uint64_t* word(size_t w) const {
+    return words_.data() + w * n_;
+  }
+};
+
+namespace detail {
+
+/// Portable Hamming distance screening of kets [j, j_end), see
+/// `hamming_screen`
+template <size_t N>
+size_t hamming_screen_scalar(const uint64_t* bra_w, const bitset_soa<N>& kets,
+                             size_t j, size_t j_end, uint32_t max_dist,
+                             uint32_t* candidates) {
+  size_t ncand = 0;
+  for(; j < j_end; ++j) {
+    uint32_t dist = 0;
+    for(size_t w = 0; w < bitset_soa<N>::nwords; ++w)
+      dist += __builtin_popcountll(bra_w[w] ^ kets.word(w)[j]);
+    if(dist <= max_dist) candidates[ncand++] = j;
+  }
+  return ncand;
+}
+
+#ifdef MACIS_HAMMING_AVX2
+/// Per-byte popcount of a 256-bit vector (nibble lookup)
+inline __m256i popcount_epi8(__m256i v) {
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                       2, 3, 2, 3, 3, 4);
+  const __m256i lo_mask = _mm256_set1_epi8(0x0f);
+  const __m256i lo = _mm256_and_si256(v, lo_mask);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lo_mask);
+  return _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),
+                         _mm256_shuffle_epi8(lut, hi));
+}
+
+/// AVX2 Hamming distance screening (4 kets at a time)
+template <size_t N>
+size_t hamming_screen_avx2(const uint64_t* bra_w, const bitset_soa<N>& kets,
+                           size_t j, size_t j_end, uint32_t max_dist,
+                           uint32_t* candidates) {
+  constexpr size_t nwords = bitset_soa<N>::nwords;
+  size_t ncand = 0;
+  if constexpr(nwords <= 31) {
+    // Per-byte counts are accumulated over the words (<= 8 * 31 < 256)
+    // and reduced to 64-bit lanes once
+    __m256i bra_v[nwords];
+    for(size_t w = 0; w < nwords; ++w)
+      bra_v[w] = _mm256_set1_epi64x(bra_w[w]);
+    const __m256i max_v = _mm256_set1_epi64x(max_dist);
+    for(; j + 4 <= j_end; j += 4) {
+      __m256i cnt = _mm256_setzero_si256();
+      for(size_t w = 0; w < nwords; ++w) {
+        const __m256i k = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(kets.word(w) + j));
+        cnt = _mm256_add_epi8(cnt,
+                              popcount_epi8(_mm256_xor_si256(bra_v[w], k)));
+      }
+      const __m256i dist = _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+      const __m256i gt = _mm256_cmpgt_epi64(dist, max_v);
+      unsigned mask = ~_mm256_movemask_pd(_mm256_castsi256_pd(gt)) & 0xF;
+      while(mask) {
+        candidates[ncand++] = j + __builtin_ctz(mask);
+        mask &= mask - 1;
+      }
+    }
+  }
+  return ncand + hamming_screen_scalar(bra_w, kets, j, j_end, max_dist,
+                                       candidates + ncand);
+}
+#endif
+
+#ifdef MACIS_HAMMING_AVX512
+/// AVX-512 VPOPCNTDQ Hamming distance screening (8 kets at a time)
+template <size_t N>
+size_t hamming_screen_avx512(const uint64_t* bra_w, const bitset_soa<N>& kets,
+                             size_t j, size_t j_end, uint32_t max_dist,
+                             uint32_t* candidates) {
+  constexpr size_t nwords = bitset_soa<N>::nwords;
+  size_t ncand = 0;
+  __m512i bra_v[nwords];
+  for(size_t w = 0; w < nwords; ++w) bra_v[w] = _mm512_set1_epi64(bra_w[w]);
+  const __m512i max_v = _mm512_set1_epi64(max_dist);
+  for(; j + 8 <= j_end; j += 8) {
+    __m512i dist = _mm512_setzero_si512();
+    for(size_t w = 0; w < nwords; ++w) {
+      const __m512i k = _mm512_loadu_si512(kets.word(w) + j);
+      dist = _mm512_add_epi64(
+          dist, _mm512_popcnt_epi64(_mm512_xor_si512(bra_v[w], k)));
+    }
+    unsigned mask = _mm512_cmple_epu64_mask(dist, max_v);
+    while(mask) {
+      candidates[ncand++] = j + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return ncand + hamming_screen_scalar(bra_w, kets, j, j_end, max_dist,
+                                       candidates + ncand);
+}
+#endif
+
+}  // namespace detail
+
+/// Instruction sets available to `hamming_screen`
+enum class hamming_isa { scalar, avx2, avx512 };
+
+/// Whether a `hamming_screen` path has been compiled in
+inline constexpr bool hamming_isa_available(hamming_isa isa) {
+  switch(isa) {
+#ifdef MACIS_HAMMING_AVX512
+    case hamming_isa::avx512:
+      return true;
+#endif
+#ifdef MACIS_HAMMING_AVX2
+    case hamming_isa::avx2:
+      return true;
+#endif
+    case hamming_isa::scalar:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Widest `hamming_screen` path which has been compiled in
+#if defined(MACIS_HAMMING_AVX512)
+inline constexpr hamming_isa hamming_isa_default = hamming_isa::avx512;
+#elif defined(MACIS_HAMMING_AVX2)
+inline constexpr hamming_isa hamming_isa_default = hamming_isa::avx2;
+#else
+inline constexpr hamming_isa hamming_isa_default = hamming_isa::scalar;
+#endif
+
+/**
+ *  @brief Screen a block of kets by Hamming distance to a bra.
+ *
+ *  Collects the indices `j` in [`j_begin`, `j_end`) for which
+ *  popcount(bra ^ kets[j]) <= `max_dist`, in increasing order. The distances
+ *  are evaluated 8 (AVX-512 VPOPCNTDQ) or 4 (AVX2) kets at a time if
+ *  available at compile time, with a portable scalar fallback. A specific
+ *  path may be requested through `isa` (e.g. for testing), unavailable
+ *  paths fall back to the scalar one.
+ *
+ *  @param[in]  bra        Bra bitset
+ *  @param[in]  kets       Ket bitsets in SoA storage
+ *  @param[in]  j_begin    First ket index of the block
+ *  @param[in]  j_end      One past the last ket index of the block
+ *  @param[in]  max_dist   Maximum Hamming distance of the survivors
+ *  @param[out] candidates Indices of the survivors, must hold at least
+ *                         `j_end - j_begin` elements
+ *  @param[in]  isa        Instruction set of the screening
+ *
+ *  @returns The number of survivors
+ */
+template <size_t N>
+size_t hamming_screen(std::bitset<N> bra, const bitset_soa<N>& kets,
+                      size_t j_begin, size_t j_end, uint32_t max_dist,
+                      uint32_t* candidates,
+                      hamming_isa isa = hamming_isa_default) {
+  uint64_t bra_w[bitset_soa<N>::nwords];
+  std::memcpy(bra_w, &bra, sizeof(bra_w));
+
+  switch(isa) {
+#ifdef MACIS_HAMMING_AVX512
+    case hamming_isa::avx512:
+      return detail::hamming_screen_avx512(bra_w, kets, j_begin, j_end,
+                                           max_dist, candidates);
+#endif
+#ifdef MACIS_HAMMING_AVX2
+    case hamming_isa::avx2:
+      return detail::hamming_screen_avx2(bra_w, kets, j_begin, j_end,
+                                         max_dist, candidates);
+#endif
+    default:
+      return detail::hamming_screen_scalar(bra_w, kets, j_begin, j_end,
+                                           max_dist, candidates);
+  }
+}
+
+}  // namespace macis
@@ -0,0 +1,271 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <algorithm>
+#include <macis/csr_hamiltonian.hpp>
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/types.hpp>
+#include <macis/util/mpi.hpp>
+#include <memory>
+#include <numeric>
+#include <sparsexx/util/submatrix.hpp>
+#include <unordered_map>
+
+namespace macis {
+
+/**
+ *  @brief (Dist-)CSR Hamiltonian which is updated incrementally as the
+ *  determinant space changes.
+ *
+ *  Keeps the Hamiltonian and the determinant-to-index map of the previous
+ *  call to `update`. On subsequent calls, rows of retained determinants
+ *  which were previously owned by this rank are reused: entries in columns
+ *  of discarded determinants are dropped and only the couplings to newly
+ *  added determinants are generated. Rows of new determinants (or of
+ *  retained determinants which changed owner) are generated in full. The
+ *  result is identical to `make_csr_hamiltonian` / `make_dist_csr_hamiltonian`
+ *  for the new determinant space.
+ *
+ *  The cache does not track the integrals of the generator, it must be
+ *  invalidated through `clear` if they change (e.g. orbital rotations).
+ *
+ *  @tparam N       Number of bits for the full determinant representation
+ *  @tparam index_t Index type of the CSR matrices
+ */
+template <size_t N, typename index_t = int32_t>
+class IncrementalHamiltonian {
+ public:
+  using wfn_type = wfn_t<N>;
+  using wfn_iterator = wavefunction_iterator_t<N>;
+  using csr_type = sparsexx::csr_matrix<double, index_t>;
+#ifdef MACIS_ENABLE_MPI
+  using matrix_type = sparsexx::dist_sparse_matrix<csr_type>;
+#else
+  using matrix_type = csr_type;
+#endif
+
+ protected:
+  std::unique_ptr<matrix_type> H_;
+  std::unordered_map<wfn_type, size_t> det_index_;  ///< Previous space
+  double H_thresh_ = 0.;
+  size_t row_st_ = 0;
+  size_t row_en_ = 0;
+  size_t nrows_reused_ = 0;
+
+  /// Visit (global column, value) of a cached local row
+  template <typename Func>
+  void for_each_cached_entry_(size_t r, Func&& f) const {
+#ifdef MACIS_ENABLE_MPI
+    const auto& D = H_->diagonal_tile();
+    for(auto k = D.rowptr()[r]; k < D.rowptr()[r + 1]; ++k)
+      f(D.colind()[k] + row_st_, D.nzval()[k]);
+    if(H_->off_diagonal_tile_ptr()) {
+      const auto& O = H_->off_diagonal_tile();
+      for(auto k = O.rowptr()[r]; k < O.rowptr()[r + 1]; ++k)
+        f(O.colind()[k], O.nzval()[k]);
+    }
+#else
+    for(auto k = H_->rowptr()[r]; k < H_->rowptr()[r + 1]; ++k)
+      f(H_->colind()[k], H_->nzval()[k]);
+#endif
+  }
+
+  /// Form the local rows [row_st, row_en) of H (global columns)
+  csr_type update_rows_(size_t row_st, size_t row_en, wfn_iterator dets_begin,
+                        wfn_iterator dets_end, HamiltonianGenerator<N>& ham_gen,
+                        double H_thresh) {
+    const size_t ndets = std::distance(dets_begin, dets_end);
+    const size_t nlocal = row_en - row_st;
+
+    // Map the new determinants onto the previous space
+    std::vector<int64_t> new_to_old(ndets, -1), old_to_new(H_->n(), -1);
+    std::vector<wfn_type> added_dets;
+    std::vector<index_t> added_index;
+    for(size_t i = 0; i < ndets; ++i) {
+      const auto det = *(dets_begin + i);
+      auto it = det_index_.find(det);
+      if(it != det_index_.end()) {
+        new_to_old[i] = it->second;
+        old_to_new[it->second] = i;
+      } else {
+        added_dets.emplace_back(det);
+        added_index.emplace_back(i);
+      }
+    }
+
+    // Partition local rows into reusable and (re)generated rows
+    std::vector<int64_t> row_source(nlocal);  // Index into reuse/gen lists
+    std::vector<wfn_type> reuse_dets, gen_dets;
+    std::vector<size_t> reuse_old_rows;
+    for(size_t i = 0; i < nlocal; ++i) {
+      const auto o = new_to_old[row_st + i];
+      if(o >= int64_t(row_st_) and o < int64_t(row_en_)) {
+        row_source[i] = reuse_dets.size();
+        reuse_dets.emplace_back(*(dets_begin + row_st + i));
+        reuse_old_rows.emplace_back(o - row_st_);
+      } else {
+        row_source[i] = -int64_t(gen_dets.size()) - 1;
+        gen_dets.emplace_back(*(dets_begin + row_st + i));
+      }
+    }
+    nrows_reused_ = reuse_dets.size();
+
+    // Couplings of retained rows to the added determinants
+    auto H_add = make_csr_hamiltonian_block<index_t>(
+        reuse_dets.begin(), reuse_dets.end(), added_dets.begin(),
+        added_dets.end(), ham_gen, H_thresh);
+
+    // Full rows of new (or migrated) determinants
+    auto H_gen = make_csr_hamiltonian_block<index_t>(
+        gen_dets.begin(), gen_dets.end(), dets_begin, dets_end, ham_gen,
+        H_thresh);
+
+    // Count entries per local row
+    std::vector<index_t> rowptr(nlocal + 1);
+    rowptr[0] = 0;
+#pragma omp parallel for schedule(dynamic, 256)
+    for(size_t i = 0; i < nlocal; ++i) {
+      index_t nrow = 0;
+      if(row_source[i] >= 0) {
+        const auto r = row_source[i];
+        for_each_cached_entry_(reuse_old_rows[r], [&](auto j, auto) {
+          if(old_to_new[j] >= 0) nrow++;
+        });
+        if(H_add.m()) nrow += H_add.rowptr()[r + 1] - H_add.rowptr()[r];
+      } else {
+        const auto r = -row_source[i] - 1;
+        nrow = H_gen.rowptr()[r + 1] - H_gen.rowptr()[r];
+      }
+      rowptr[i + 1] = nrow;
+    }
+    std::partial_sum(rowptr.begin(), rowptr.end(), rowptr.begin());
+
+    // Fill local rows with sorted global column indices
+    const size_t nnz = rowptr.back();
+    std::vector<index_t> colind(nnz);
+    std::vector<double> nzval(nnz);
+#pragma omp parallel
+    {
+      std::vector<std::pair<index_t, double>> row;
+#pragma omp for schedule(dynamic, 256)
+      for(size_t i = 0; i < nlocal; ++i) {
+        row.clear();
+        if(row_source[i] >= 0) {
+          const auto r = row_source[i];
+          for_each_cached_entry_(reuse_old_rows[r], [&](auto j, auto v) {
+            if(old_to_new[j] >= 0) row.emplace_back(old_to_new[j], v);
+          });
+          if(H_add.m()) {
+            for(auto k = H_add.rowptr()[r]; k < H_add.rowptr()[r + 1]; ++k)
+              row.emplace_back(added_index[H_add.colind()[k]],
+                               H_add.nzval()[k]);
+          }
+          std::sort(row.begin(), row.end(),
+                    [](auto a, auto b) { return a.first < b.first; });
+        } else {
+          const auto r = -row_source[i] - 1;
+          for(auto k = H_gen.rowptr()[r]; k < H_gen.rowptr()[r + 1]; ++k)
+            row.emplace_back(H_gen.colind()[k], H_gen.nzval()[k]);
+        }
+
+        for(size_t k = 0; k < row.size(); ++k) {
+          colind[rowptr[i] + k] = row[k].first;
+          nzval[rowptr[i] + k] = row[k].second;
+        }
+      }
+    }
+
+    return csr_type(nlocal, ndets, std::move(rowptr), std::move(colind),
+                    std::move(nzval));
+  }
+
+ public:
+  IncrementalHamiltonian() = default;
+
+  /// Invalidate the cached Hamiltonian
+  void clear() {
+    H_.reset();
+    det_index_.clear();
+    nrows_reused_ = 0;
+  }
+
+  /// Whether a Hamiltonian is currently cached
+  inline bool valid() const { return bool(H_); }
+
+  /// Number of local rows reused in the last call to `update`
+  inline size_t nrows_reused() const { return nrows_reused_; }
+
+  /**
+   *  @brief Form the Hamiltonian over a new determinant space.
+   *
+   *  @param[in] comm       MPI communicator (MPI builds only)
+   *  @param[in] dets_begin Beginning of the new determinant space
+   *  @param[in] dets_end   End of the new determinant space
+   *  @param[in] ham_gen    Hamiltonian generator
+   *  @param[in] H_thresh   Matrix element threshold
+   *
+   *  @returns The (dist-)CSR Hamiltonian, valid until the next call to
+   *  `update` or `clear`
+   */
+  const matrix_type& update(MACIS_MPI_CODE(MPI_Comm comm, )
+                                wfn_iterator dets_begin,
+                            wfn_iterator dets_end,
+                            HamiltonianGenerator<N>& ham_gen,
+                            double H_thresh) {
+    const size_t ndets = std::distance(dets_begin, dets_end);
+
+    if(!H_ or H_thresh != H_thresh_ or ndets == 0) {
+      // Nothing to reuse, generate from scratch
+#ifdef MACIS_ENABLE_MPI
+      H_ = std::make_unique<matrix_type>(make_dist_csr_hamiltonian<index_t>(
+          comm, dets_begin, dets_end, ham_gen, H_thresh));
+#else
+      H_ = std::make_unique<matrix_type>(make_csr_hamiltonian<index_t>(
+          dets_begin, dets_end, ham_gen, H_thresh));
+#endif
+      nrows_reused_ = 0;
+    } else {
+#ifdef MACIS_ENABLE_MPI
+      auto H_new = std::make_unique<matrix_type>(comm, ndets, ndets);
+      auto [row_st, row_en] = H_new->row_bounds(comm_rank(comm));
+      auto H_loc = update_rows_(row_st, row_en, dets_begin, dets_end, ham_gen,
+                                H_thresh);
+
+      // Split local rows into diagonal / off-diagonal tiles
+      const int64_t nlocal = row_en - row_st;
+      std::pair<int64_t, int64_t> lo = {0, row_st}, up = {nlocal, row_en};
+      H_new->set_diagonal_tile(sparsexx::extract_submatrix(H_loc, lo, up));
+      if(comm_size(comm) > 1) {
+        H_new->set_off_diagonal_tile(
+            sparsexx::extract_submatrix_inclrow_exclcol(H_loc, lo, up));
+      }
+      H_ = std::move(H_new);
+#else
+      H_ = std::make_unique<matrix_type>(
+          update_rows_(0, ndets, dets_begin, dets_end, ham_gen, H_thresh));
+#endif
+    }
+
+    // Update the determinant-to-index map
+    det_index_.clear();
+    det_index_.reserve(ndets);
+    for(size_t i = 0; i < ndets; ++i) det_index_[*(dets_begin + i)] = i;
+    H_thresh_ = H_thresh;
+#ifdef MACIS_ENABLE_MPI
+    std::tie(row_st_, row_en_) = H_->row_bounds(comm_rank(comm));
+#else
+    row_st_ = 0;
+    row_en_ = ndets;
+#endif
+
+    return *H_;
+  }
+};
+
+}  // namespace macis
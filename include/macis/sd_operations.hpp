@@ -11,6 +11,8 @@
 #include <cassert>
 #include <macis/bitset_operations.hpp>
 #include <numeric>
+#include <stdexcept>
+#include <vector>
 
 namespace macis {
 
@@ -474,6 +476,74 @@ std::vector<std::bitset<N>> generate_hilbert_space(size_t norbs, size_t nalpha,
   return states;
 }
 
+/**
+ *  @brief Irrep of a spin string.
+ *
+ *  Irreps of D2h and its subgroups are labelled such that the direct product
+ *  of two irreps is the bitwise XOR of their labels (see
+ *  `read_fcidump_orbsym`).
+ *
+ *  @param[in] state  Spin string (orbital occupations)
+ *  @param[in] orbsym Irreps of the orbitals
+ */
+template <size_t N>
+uint32_t spin_string_irrep(std::bitset<N> state,
+                           const std::vector<uint32_t>& orbsym) {
+  uint32_t irrep = 0;
+  while(state.any()) {
+    const auto i = ffs(state) - 1;
+    irrep ^= orbsym[i];
+    state.flip(i);
+  }
+  return irrep;
+}
+
+/// Irrep of a determinant (see `spin_string_irrep`)
+template <size_t N>
+uint32_t det_irrep(std::bitset<N> state, const std::vector<uint32_t>& orbsym) {
+  return spin_string_irrep(bitset_lo_word(state), orbsym) ^
+         spin_string_irrep(bitset_hi_word(state), orbsym);
+}
+
+/**
+ *  @brief Generate the determinants of a given irrep in a CAS.
+ *
+ *  Same ordering as the full `generate_hilbert_space`, restricted to the
+ *  determinants which transform as `irrep`.
+ *
+ *  @param[in] norbs  Number of orbitals
+ *  @param[in] nalpha Number of alpha electrons
+ *  @param[in] nbeta  Number of beta electrons
+ *  @param[in] orbsym Irreps of the orbitals, empty for no symmetry
+ *  @param[in] irrep  Target irrep
+ */
+template <size_t N>
+std::vector<std::bitset<N>> generate_hilbert_space(
+    size_t norbs, size_t nalpha, size_t nbeta,
+    const std::vector<uint32_t>& orbsym, uint32_t irrep) {
+  if(orbsym.empty()) return generate_hilbert_space<N>(norbs, nalpha, nbeta);
+  if(orbsym.size() != norbs)
+    throw std::runtime_error("ORBSYM is of improper dimension");
+
+  auto alpha_dets = generate_combs<N>(norbs, nalpha);
+  auto beta_dets = generate_combs<N>(norbs, nbeta);
+
+  std::vector<uint32_t> beta_irreps(beta_dets.size());
+  std::transform(beta_dets.begin(), beta_dets.end(), beta_irreps.begin(),
+                 [&](auto d) { return spin_string_irrep(d, orbsym); });
+
+  std::vector<std::bitset<N>> states;
+  for(auto alpha_det : alpha_dets) {
+    const auto alpha_irrep = spin_string_irrep(alpha_det, orbsym);
+    for(size_t i = 0; i < beta_dets.size(); ++i) {
+      if((alpha_irrep ^ beta_irreps[i]) != irrep) continue;
+      states.emplace_back(alpha_det | (beta_dets[i] << (N / 2)));
+    }
+  }
+
+  return states;
+}
+
 template <size_t N>
 void generate_cis_hilbert_space(size_t norb, std::bitset<N> state,
                                 std::vector<std::bitset<N>>& dets) {
@@ -26,20 +26,36 @@
 
 namespace macis {
 
+/**
+ *  @brief Davidson operator for a stored (dist-)sparse matrix.
+ *
+ *  If `upper_triangle` is set, the matrix is assumed to be symmetric with
+ *  only its upper triangle (including the diagonal) stored, and the action
+ *  is evaluated through the symmetric SpMV kernels.
+ *
+ *  The scratch buffers of the SpMV kernels are owned by the operator and
+ *  reused across applications.
+ */
 template <typename SpMatType>
 class SparseMatrixOperator {
   using index_type = typename SpMatType::index_type;
+  using value_type = typename SpMatType::value_type;
 
   const SpMatType& m_matrix_;
+  bool m_upper_triangle_;
+  mutable sparsexx::spblas::spmbv_workspace<value_type> m_spmbv_ws_;
 #ifdef MACIS_ENABLE_MPI
   sparsexx::spblas::spmv_info<index_type> m_spmv_info_;
+  mutable sparsexx::spblas::pspmv_workspace<value_type, index_type> m_pspmv_ws_;
 #endif
 
  public:
-  SparseMatrixOperator(const SpMatType& m) : m_matrix_(m) {
+  SparseMatrixOperator(const SpMatType& m, bool upper_triangle = false)
+      : m_matrix_(m), m_upper_triangle_(upper_triangle) {
 #ifdef MACIS_ENABLE_MPI
     if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
       m_spmv_info_ = sparsexx::spblas::generate_spmv_comm_info(m);
+      m_pspmv_ws_ = {size_t(m.n()), m_spmv_info_};
     }
 #endif
   }
@@ -48,10 +64,19 @@ class SparseMatrixOperator {
                        double beta, double* AV, size_t LDAV) const {
 #ifdef MACIS_ENABLE_MPI
     if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
-      sparsexx::spblas::pgespmv(alpha, m_matrix_, V, beta, AV, m_spmv_info_);
+      if(m_upper_triangle_)
+        sparsexx::spblas::pgespmv_sym(alpha, m_matrix_, V, beta, AV,
+                                      m_spmv_info_, &m_pspmv_ws_);
+      else
+        sparsexx::spblas::pgespmv(alpha, m_matrix_, V, beta, AV, m_spmv_info_,
+                                  &m_pspmv_ws_);
     } else {
 #endif
-      sparsexx::spblas::gespmbv(m, alpha, m_matrix_, V, LDV, beta, AV, LDAV);
+      if(m_upper_triangle_)
+        sparsexx::spblas::gespmbv_sym(m, alpha, m_matrix_, V, LDV, beta, AV,
+                                      LDAV, &m_spmbv_ws_);
+      else
+        sparsexx::spblas::gespmbv(m, alpha, m_matrix_, V, LDV, beta, AV, LDAV);
 #ifdef MACIS_ENABLE_MPI
     }
 #endif
@@ -101,7 +126,9 @@ void p_diagonal_guess(size_t N_local, const SpMatType& A, double* X) {
   for(size_t i = 0; i < N_local; ++i) X[i] = 0.;
 
   // Get owner rank
-  int owner_rank = min_idx / remote_counts[0];
+  auto owner_it =
+      std::upper_bound(row_starts.begin(), row_starts.end(), int(min_idx));
+  int owner_rank = std::distance(row_starts.begin(), owner_it) - 1;
   if(world_rank == owner_rank) {
     X[min_idx - A.local_row_start()] = 1.;
   }
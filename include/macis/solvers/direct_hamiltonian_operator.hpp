@@ -0,0 +1,208 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/hamiltonian_generator/alpha_sorted_dets.hpp>
+#include <macis/types.hpp>
+#include <macis/util/mpi.hpp>
+#include <vector>
+
+namespace macis {
+
+/**
+ *  @brief Matrix-free Hamiltonian operator for the Davidson eigensolver.
+ *
+ *  Computes H*V on the fly through the matrix element kernels of a
+ *  HamiltonianGenerator rather than through a stored (dist-)CSR matrix.
+ *  Connected determinant pairs are enumerated through alpha_sorted_dets,
+ *  which is the only persistent storage (O(ndets)).
+ *
+ *  In distributed mode, each rank owns a contiguous block of rows with the
+ *  same partitioning as the default sparsexx::dist_sparse_matrix, such that
+ *  the operator is a drop-in replacement for the distributed CSR matrix in
+ *  p_davidson.
+ *
+ *  @tparam N Number of bits for the full determinant representation
+ */
+template <size_t N>
+class DirectHamiltonianOperator {
+ public:
+  using generator_type = HamiltonianGenerator<N>;
+  using full_det_iterator = wavefunction_iterator_t<N>;
+  using spin_det_t = std::bitset<N / 2>;
+
+ protected:
+  using sorted_dets_t = alpha_sorted_dets<N>;
+  using group_list_t = typename sorted_dets_t::group_list_t;
+
+  const generator_type& ham_gen_;
+  double H_thresh_;
+
+  full_det_iterator dets_begin_;
+  size_t ndets_;
+  size_t row_st_;
+  size_t row_en_;
+
+  sorted_dets_t bra_;  ///< Local rows (indices relative to row_st_)
+  sorted_dets_t ket_;  ///< All columns
+  std::vector<group_list_t> ket_groups_;  ///< Connected ket groups per bra
+
+#ifdef MACIS_ENABLE_MPI
+  MPI_Comm comm_ = MPI_COMM_NULL;
+  std::vector<int> row_counts_;
+  std::vector<int> row_displs_;
+#endif
+
+  void setup_() {
+    bra_ = sorted_dets_t(dets_begin_ + row_st_, dets_begin_ + row_en_);
+    ket_ = sorted_dets_t(dets_begin_, dets_begin_ + ndets_);
+
+    ket_groups_.resize(bra_.ngroups());
+#pragma omp parallel for schedule(dynamic)
+    for(size_t ig = 0; ig < bra_.ngroups(); ++ig) {
+      ket_.connected_groups(bra_.alpha[ig], ket_groups_[ig]);
+    }
+  }
+
+  /// Y(i,:) = alpha * H(i,:) * X + beta * Y(i,:) for local rows i
+  void apply_local_(size_t m, double alpha, const double* X, size_t LDX,
+                    double beta, double* Y, size_t LDY) const {
+    // Y = beta * Y (zero determinants receive no further contributions)
+    const size_t nlocal = local_row_extent();
+    for(size_t k = 0; k < m; ++k)
+      for(size_t i = 0; i < nlocal; ++i) {
+        Y[i + k * LDY] = (beta == 0.) ? 0. : beta * Y[i + k * LDY];
+      }
+
+#pragma omp parallel
+    {
+      std::vector<uint32_t> bra_occ_beta;
+      std::vector<double> acc(m);
+
+#pragma omp for schedule(dynamic)
+      for(size_t ig = 0; ig < bra_.ngroups(); ++ig) {
+        const auto bra_alpha = bra_.alpha[ig];
+        const auto& bra_occ_alpha = bra_.alpha_occ[ig];
+
+        for(size_t ii = bra_.alpha_ptr[ig]; ii < bra_.alpha_ptr[ig + 1];
+            ++ii) {
+          const auto bra_beta = bra_.beta[ii];
+          bits_to_indices(bra_beta, bra_occ_beta);
+
+          std::fill(acc.begin(), acc.end(), 0.);
+          ket_.visit_connected(
+              bra_alpha, bra_beta, ket_groups_[ig],
+              [&](size_t j, spin_det_t ket_alpha, spin_det_t ex_alpha,
+                  spin_det_t ket_beta, spin_det_t ex_beta) {
+                const auto h_el = ham_gen_.matrix_element(
+                    bra_alpha, ket_alpha, ex_alpha, bra_beta, ket_beta,
+                    ex_beta, bra_occ_alpha, bra_occ_beta);
+                if(std::abs(h_el) > H_thresh_) {
+                  for(size_t k = 0; k < m; ++k) acc[k] += h_el * X[j + k * LDX];
+                }
+              });
+
+          const auto i = bra_.index[ii];
+          for(size_t k = 0; k < m; ++k) Y[i + k * LDY] += alpha * acc[k];
+        }
+      }
+    }
+  }
+
+ public:
+  /// Serial operator over all determinants in [dets_begin, dets_end)
+  DirectHamiltonianOperator(full_det_iterator dets_begin,
+                            full_det_iterator dets_end,
+                            const generator_type& ham_gen, double H_thresh)
+      : ham_gen_(ham_gen),
+        H_thresh_(H_thresh),
+        dets_begin_(dets_begin),
+        ndets_(std::distance(dets_begin, dets_end)),
+        row_st_(0),
+        row_en_(ndets_) {
+    setup_();
+  }
+
+#ifdef MACIS_ENABLE_MPI
+  /// Distributed operator, rows are partitioned over `comm`
+  DirectHamiltonianOperator(MPI_Comm comm, full_det_iterator dets_begin,
+                            full_det_iterator dets_end,
+                            const generator_type& ham_gen, double H_thresh)
+      : ham_gen_(ham_gen),
+        H_thresh_(H_thresh),
+        dets_begin_(dets_begin),
+        ndets_(std::distance(dets_begin, dets_end)),
+        comm_(comm) {
+    const auto world_size = comm_size(comm);
+    const auto world_rank = comm_rank(comm);
+
+    // Same partitioning as the default dist_sparse_matrix
+    const size_t nrow_per_rank = ndets_ / world_size;
+    row_counts_.resize(world_size, nrow_per_rank);
+    row_counts_.back() += ndets_ % world_size;
+    row_displs_.resize(world_size);
+    for(int i = 0; i < world_size; ++i) row_displs_[i] = i * nrow_per_rank;
+
+    row_st_ = row_displs_[world_rank];
+    row_en_ = row_st_ + row_counts_[world_rank];
+
+    setup_();
+  }
+
+  inline MPI_Comm comm() const { return comm_; }
+#endif
+
+  inline size_t m() const { return ndets_; }
+  inline size_t n() const { return ndets_; }
+  inline size_t local_row_start() const { return row_st_; }
+  inline size_t local_row_extent() const { return row_en_ - row_st_; }
+
+  /// Diagonal elements of the local rows through `matrix_element_diag`
+  std::vector<double> diagonal() const {
+    const size_t nlocal = local_row_extent();
+    std::vector<double> D(nlocal, 0.);
+
+#pragma omp parallel
+    {
+      std::vector<uint32_t> occ_alpha, occ_beta;
+#pragma omp for schedule(dynamic)
+      for(size_t i = 0; i < nlocal; ++i) {
+        const auto det = *(dets_begin_ + row_st_ + i);
+        if(!det.count()) continue;
+        bits_to_indices(bitset_lo_word(det), occ_alpha);
+        bits_to_indices(bitset_hi_word(det), occ_beta);
+        D[i] = ham_gen_.matrix_element_diag(occ_alpha, occ_beta);
+      }
+    }
+
+    return D;
+  }
+
+  void operator_action(size_t m, double alpha, const double* V, size_t LDV,
+                       double beta, double* AV, size_t LDAV) const {
+#ifdef MACIS_ENABLE_MPI
+    if(comm_ != MPI_COMM_NULL) {
+      // Gather the full vector(s) onto every rank
+      std::vector<double> V_full(ndets_ * m);
+      for(size_t k = 0; k < m; ++k) {
+        MPI_Allgatherv(V + k * LDV, local_row_extent(), MPI_DOUBLE,
+                       V_full.data() + k * ndets_, row_counts_.data(),
+                       row_displs_.data(), MPI_DOUBLE, comm_);
+      }
+      apply_local_(m, alpha, V_full.data(), ndets_, beta, AV, LDAV);
+    } else {
+#endif
+      apply_local_(m, alpha, V, LDV, beta, AV, LDAV);
+#ifdef MACIS_ENABLE_MPI
+    }
+#endif
+  }
+};
+
+}  // namespace macis
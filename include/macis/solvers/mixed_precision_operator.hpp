@@ -0,0 +1,304 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/csr_hamiltonian.hpp>
+#include <macis/util/mpi.hpp>
+#include <sparsexx/matrix_types/csr_matrix.hpp>
+#include <sparsexx/spblas/spmbv.hpp>
+#include <type_traits>
+#include <vector>
+
+#ifdef MACIS_ENABLE_MPI
+#include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
+#include <sparsexx/spblas/pspmbv.hpp>
+#endif
+
+namespace macis {
+
+namespace detail {
+
+/**
+ *  @brief Copy a CSR matrix into a reduced precision CSR matrix.
+ *
+ *  If D is provided, the diagonal elements (column index == row index +
+ *  `diag_offset`) are excluded from the copy and stored in D (full
+ *  precision) instead.
+ */
+template <typename T, typename index_t>
+sparsexx::csr_matrix<T, index_t> reduce_csr_precision(
+    const sparsexx::csr_matrix<double, index_t>& A,
+    std::vector<double>* D = nullptr, int64_t diag_offset = 0) {
+  const int64_t M = A.m();
+  const auto indexing = A.indexing();
+  const auto& rowptr = A.rowptr();
+  const auto& colind = A.colind();
+  const auto& nzval = A.nzval();
+
+  auto is_diag = [&](int64_t i, int64_t k) {
+    return D and colind[k] - indexing == i + diag_offset;
+  };
+
+  if(D) D->assign(M, 0.);
+  std::vector<index_t> new_rowptr(M + 1);
+  new_rowptr[0] = 0;
+  for(int64_t i = 0; i < M; ++i) {
+    index_t nrow = 0;
+    for(auto k = rowptr[i] - indexing; k < rowptr[i + 1] - indexing; ++k) {
+      if(is_diag(i, k))
+        (*D)[i] = nzval[k];
+      else
+        nrow++;
+    }
+    new_rowptr[i + 1] = new_rowptr[i] + nrow;
+  }
+
+  sparsexx::csr_matrix<T, index_t> A_red(M, A.n(), new_rowptr.back(), 0);
+  A_red.rowptr() = std::move(new_rowptr);
+#pragma omp parallel for schedule(dynamic, 1024)
+  for(int64_t i = 0; i < M; ++i) {
+    auto k_red = A_red.rowptr()[i];
+    for(auto k = rowptr[i] - indexing; k < rowptr[i + 1] - indexing; ++k) {
+      if(is_diag(i, k)) continue;
+      A_red.colind()[k_red] = colind[k] - indexing;
+      A_red.nzval()[k_red] = static_cast<T>(nzval[k]);
+      k_red++;
+    }
+  }
+
+  return A_red;
+}
+
+/**
+ *  @brief Generate a reduced precision CSR matrix by blocks of rows.
+ *
+ *  `gen_rows(r_st, r_en)` returns the rows [r_st, r_en) of the matrix in
+ *  double precision, each block is converted (see `reduce_csr_precision`)
+ *  and released before the next one is generated. The matrix is thus never
+ *  held in double precision as a whole.
+ */
+template <typename T, typename index_t, typename RowGen>
+sparsexx::csr_matrix<T, index_t> generate_reduced_csr(
+    size_t nrow, size_t ncol, RowGen&& gen_rows,
+    std::vector<double>* D = nullptr, int64_t diag_offset = 0) {
+  // At most 16 blocks (of at least 1024 rows)
+  const size_t nrow_block = std::max<size_t>(1024, (nrow + 15) / 16);
+
+  std::vector<sparsexx::csr_matrix<T, index_t>> blocks;
+  std::vector<double> D_blk;
+  if(D) D->clear();
+  size_t nnz = 0;
+  for(size_t r_st = 0; r_st < nrow; r_st += nrow_block) {
+    const size_t r_en = std::min(r_st + nrow_block, nrow);
+    blocks.emplace_back(reduce_csr_precision<T>(
+        gen_rows(r_st, r_en), D ? &D_blk : nullptr, diag_offset + r_st));
+    nnz += blocks.back().nnz();
+    if(D) D->insert(D->end(), D_blk.begin(), D_blk.end());
+  }
+
+  // Concatenate the blocks, each of which is released once it is copied
+  std::vector<index_t> rowptr, colind;
+  std::vector<T> nzval;
+  rowptr.reserve(nrow + 1);
+  colind.reserve(nnz);
+  nzval.reserve(nnz);
+  rowptr.push_back(0);
+  for(auto& blk : blocks) {
+    const index_t offset = rowptr.back();
+    for(int64_t i = 0; i < blk.m(); ++i)
+      rowptr.push_back(offset + blk.rowptr()[i + 1]);
+    colind.insert(colind.end(), blk.colind().begin(), blk.colind().end());
+    nzval.insert(nzval.end(), blk.nzval().begin(), blk.nzval().end());
+    blk = sparsexx::csr_matrix<T, index_t>();
+  }
+
+  return sparsexx::csr_matrix<T, index_t>(
+      nrow, ncol, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Davidson operator for a (dist-)sparse matrix stored in mixed
+ *  precision.
+ *
+ *  The off-diagonal elements are stored in single precision while the
+ *  (dominant) diagonal is kept in double precision. The matrix elements are
+ *  promoted on the fly, such that all products are accumulated in double
+ *  precision. This reduces the memory footprint of the matrix by roughly a
+ *  third and the memory traffic of the SpMV accordingly, at the cost of
+ *  O(1e-7) relative errors in the off-diagonal matrix elements.
+ *
+ *  @tparam SpMatType Double precision (dist-)CSR type the operator is formed
+ *                    from
+ */
+template <typename SpMatType>
+class MixedPrecisionMatrixOperator {
+ public:
+  using index_type = typename SpMatType::index_type;
+  using reduced_csr_type = sparsexx::csr_matrix<float, index_type>;
+
+#ifdef MACIS_ENABLE_MPI
+  inline static constexpr bool is_distributed =
+      sparsexx::is_dist_sparse_matrix_v<SpMatType>;
+  using reduced_matrix_type =
+      std::conditional_t<is_distributed,
+                         sparsexx::dist_sparse_matrix<reduced_csr_type>,
+                         reduced_csr_type>;
+#else
+  inline static constexpr bool is_distributed = false;
+  using reduced_matrix_type = reduced_csr_type;
+#endif
+
+ protected:
+  std::vector<double> D_;  ///< Local diagonal (double precision)
+  reduced_matrix_type H_;  ///< Off-diagonal elements (single precision)
+#ifdef MACIS_ENABLE_MPI
+  sparsexx::spblas::spmv_info<index_type> spmv_info_;
+#endif
+
+  static reduced_matrix_type reduce_(const SpMatType& H,
+                                     std::vector<double>& D) {
+#ifdef MACIS_ENABLE_MPI
+    if constexpr(is_distributed) {
+      reduced_matrix_type H_red(H.comm(), H.m(), H.n());
+      H_red.set_diagonal_tile(
+          detail::reduce_csr_precision<float>(H.diagonal_tile(), &D));
+      if(H.off_diagonal_tile_ptr()) {
+        H_red.set_off_diagonal_tile(
+            detail::reduce_csr_precision<float>(H.off_diagonal_tile()));
+      }
+      return H_red;
+    } else
+#endif
+      return detail::reduce_csr_precision<float>(H, &D);
+  }
+
+ public:
+  MixedPrecisionMatrixOperator(const SpMatType& H) : H_(reduce_(H, D_)) {
+#ifdef MACIS_ENABLE_MPI
+    if constexpr(is_distributed) {
+      spmv_info_ = sparsexx::spblas::generate_spmv_comm_info(H_);
+    }
+#endif
+  }
+
+  /// Operator from reduced precision off-diagonal elements `H` and the
+  /// local diagonal `D`
+  MixedPrecisionMatrixOperator(reduced_matrix_type&& H, std::vector<double>&& D)
+      : D_(std::move(D)), H_(std::move(H)) {
+#ifdef MACIS_ENABLE_MPI
+    if constexpr(is_distributed) {
+      spmv_info_ = sparsexx::spblas::generate_spmv_comm_info(H_);
+    }
+#endif
+  }
+
+  /// Diagonal elements of the local rows
+  inline const std::vector<double>& diagonal() const { return D_; }
+
+  inline size_t mem_footprint() const {
+    return H_.mem_footprint() + D_.capacity() * sizeof(double);
+  }
+
+  inline size_t nnz() const { return H_.nnz() + D_.size(); }
+
+  void operator_action(size_t m, double alpha, const double* V, size_t LDV,
+                       double beta, double* AV, size_t LDAV) const {
+#ifdef MACIS_ENABLE_MPI
+    if constexpr(is_distributed) {
+      sparsexx::spblas::pgespmv<reduced_matrix_type, double>(
+          alpha, H_, V, beta, AV, spmv_info_);
+    } else {
+#endif
+      sparsexx::spblas::gespmbv(m, alpha, H_, V, LDV, beta, AV, LDAV);
+#ifdef MACIS_ENABLE_MPI
+    }
+#endif
+
+    // Diagonal contribution
+    const size_t nlocal = D_.size();
+#pragma omp parallel for collapse(2)
+    for(size_t k = 0; k < m; ++k)
+      for(size_t i = 0; i < nlocal; ++i) {
+        AV[i + k * LDAV] += alpha * D_[i] * V[i + k * LDV];
+      }
+  }
+};
+
+/**
+ *  @brief Generate the mixed precision (dist-)CSR Hamiltonian of a set of
+ *  determinants.
+ *
+ *  Equivalent to forming MixedPrecisionMatrixOperator from the result of
+ *  make_(dist_)csr_hamiltonian, but H is generated by blocks of rows which
+ *  are converted as they are produced, such that the double precision H is
+ *  never held as a whole.
+ */
+template <typename index_t, size_t N>
+auto make_mixed_precision_hamiltonian(MACIS_MPI_CODE(MPI_Comm comm, )
+                                          wavefunction_iterator_t<N> sd_begin,
+                                      wavefunction_iterator_t<N> sd_end,
+                                      HamiltonianGenerator<N>& ham_gen,
+                                      double H_thresh) {
+  using csr_type = sparsexx::csr_matrix<double, index_t>;
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  std::vector<double> D;
+
+#ifdef MACIS_ENABLE_MPI
+  using operator_type =
+      MixedPrecisionMatrixOperator<sparsexx::dist_sparse_matrix<csr_type>>;
+  typename operator_type::reduced_matrix_type H(comm, ndets, ndets);
+  // (not a structured binding, which can not be captured in C++17)
+  const auto bra_bounds = H.row_bounds(comm_rank(comm));
+  const size_t bra_st = bra_bounds.first, bra_en = bra_bounds.second;
+  const auto bra_begin = sd_begin + bra_st;
+  const auto bra_end = sd_begin + bra_en;
+  const size_t nlocal = bra_en - bra_st;
+
+  // Diagonal tile
+  H.set_diagonal_tile(detail::generate_reduced_csr<float, index_t>(
+      nlocal, nlocal,
+      [&](size_t r_st, size_t r_en) {
+        return make_csr_hamiltonian_block<index_t>(
+            bra_begin + r_st, bra_begin + r_en, bra_begin, bra_end, ham_gen,
+            H_thresh);
+      },
+      &D));
+
+  // Off-diagonal tile from the remote kets [0, bra_st) and [bra_en, ndets)
+  if(comm_size(comm) > 1) {
+    H.set_off_diagonal_tile(detail::generate_reduced_csr<float, index_t>(
+        nlocal, ndets, [&](size_t r_st, size_t r_en) {
+          auto H_left = make_csr_hamiltonian_block<index_t>(
+              bra_begin + r_st, bra_begin + r_en, sd_begin, bra_begin,
+              ham_gen, H_thresh);
+          auto H_right = make_csr_hamiltonian_block<index_t>(
+              bra_begin + r_st, bra_begin + r_en, bra_end, sd_end, ham_gen,
+              H_thresh);
+          return detail::merge_column_blocks(std::move(H_left),
+                                             std::move(H_right), bra_en,
+                                             ndets);
+        }));
+  }
+#else
+  using operator_type = MixedPrecisionMatrixOperator<csr_type>;
+  auto H = detail::generate_reduced_csr<float, index_t>(
+      ndets, ndets,
+      [&](size_t r_st, size_t r_en) {
+        return make_csr_hamiltonian_block<index_t>(
+            sd_begin + r_st, sd_begin + r_en, sd_begin, sd_end, ham_gen,
+            H_thresh);
+      },
+      &D);
+#endif
+
+  return operator_type(std::move(H), std::move(D));
+}
+
+}  // namespace macis
@@ -8,21 +8,49 @@
 
 #pragma once
 #include <chrono>
+#include <limits>
 #include <macis/csr_hamiltonian.hpp>
+#include <macis/hamiltonian_cache.hpp>
 #include <macis/hamiltonian_generator.hpp>
+#include <macis/incremental_hamiltonian.hpp>
 #include <macis/solvers/davidson.hpp>
+#include <macis/solvers/direct_hamiltonian_operator.hpp>
+#include <macis/solvers/mixed_precision_operator.hpp>
 #include <macis/types.hpp>
+#include <macis/util/mcscf.hpp>
 #include <macis/util/mpi.hpp>
+#include <sparsexx/matrix_types/compressed_csr_matrix.hpp>
 #include <sparsexx/matrix_types/dense_conversions.hpp>
 #include <sparsexx/util/submatrix.hpp>
 
 namespace macis {
 
+namespace detail {
+
+/// Mutes a logger (if `quiet` is set) for the lifetime of the guard
+class quiet_logger_guard {
+  std::shared_ptr<spdlog::logger> logger_;
+  spdlog::level::level_enum level_;
+
+ public:
+  quiet_logger_guard(std::shared_ptr<spdlog::logger> logger, bool quiet)
+      : logger_(std::move(logger)), level_(logger_->level()) {
+    if(quiet) logger_->set_level(spdlog::level::off);
+  }
+  ~quiet_logger_guard() noexcept { logger_->set_level(level_); }
+
+  quiet_logger_guard(const quiet_logger_guard&) = delete;
+  quiet_logger_guard& operator=(const quiet_logger_guard&) = delete;
+};
+
+}  // namespace detail
+
 #ifdef MACIS_ENABLE_MPI
 template <typename SpMatType>
 double parallel_selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
                                  double davidson_res_tol,
-                                 std::vector<double>& C_local, MPI_Comm comm) {
+                                 std::vector<double>& C_local, MPI_Comm comm,
+                                 bool upper_triangle = false) {
   auto logger = spdlog::get("ci_solver");
   if(!logger) {
     logger = spdlog::stdout_color_mt("ci_solver");
@@ -51,7 +79,7 @@ double parallel_selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
   }
 
   // Setup Davidson Functor
-  SparseMatrixOperator op(H);
+  SparseMatrixOperator op(H, upper_triangle);
 
   // Solve EVP
   MPI_Barrier(comm);
@@ -75,7 +103,8 @@ double parallel_selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
 template <typename SpMatType>
 double serial_selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
                                double davidson_res_tol,
-                               std::vector<double>& C) {
+                               std::vector<double>& C,
+                               bool upper_triangle = false) {
   auto logger = spdlog::get("ci_solver");
   if(!logger) {
     logger = spdlog::stdout_color_mt("ci_solver");
@@ -104,7 +133,7 @@ double serial_selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
   }
 
   // Setup Davidson Functor
-  SparseMatrixOperator op(H);
+  SparseMatrixOperator op(H, upper_triangle);
 
   // Solve EVP
   auto dav_st = clock_type::now();
@@ -121,6 +150,165 @@ double serial_selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
   return E;
 }
 
+/**
+ *  @brief Report statistics of a stored Hamiltonian and solve for its lowest
+ *  eigenpair.
+ *
+ *  @param[in] H_dur          Wall time (ms) spent forming H
+ *  @param[in] upper_triangle Whether only the upper triangle of H is stored
+ */
+template <typename SpMatType>
+double stored_selected_ci_diag(const SpMatType& H, double H_dur,
+                               size_t davidson_max_m, double davidson_res_tol,
+                               std::vector<double>& C_local
+                                   MACIS_MPI_CODE(, MPI_Comm comm),
+                               bool upper_triangle = false) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+
+  // Get total NNZ
+#ifdef MACIS_ENABLE_MPI
+  size_t local_nnz = H.nnz();
+  size_t total_nnz = allreduce(local_nnz, MPI_SUM, comm);
+  size_t max_nnz = allreduce(local_nnz, MPI_MAX, comm);
+  size_t min_nnz = allreduce(local_nnz, MPI_MIN, comm);
+  const char* nnz_label = upper_triangle ? "NNZ_STORED" : "NNZ";
+#else
+  size_t total_nnz = H.nnz();
+#endif
+
+  // Number of non-zeros of the full matrix, the (stored) upper triangle
+  // includes the diagonal
+  const size_t full_nnz =
+      upper_triangle ? 2 * total_nnz - std::min<size_t>(total_nnz, H.n())
+                     : total_nnz;
+  logger->info("  {}   = {:6}, {}     = {:.5e} ms", "NNZ", full_nnz, "H_DUR",
+               H_dur);
+  if(upper_triangle)
+    logger->info("  {} = {:6} (upper triangle)", "NNZ_STORED", total_nnz);
+
+#ifdef MACIS_ENABLE_MPI
+  auto world_size = comm_size(comm);
+  if(world_size > 1) {
+    double local_hdur = H_dur;
+    double max_hdur = allreduce(local_hdur, MPI_MAX, comm);
+    double min_hdur = allreduce(local_hdur, MPI_MIN, comm);
+    double avg_hdur = allreduce(local_hdur, MPI_SUM, comm);
+    avg_hdur /= world_size;
+    logger->info(
+        "  H_DUR_MAX = {:.2e} ms, H_DUR_MIN = {:.2e} ms, H_DUR_AVG = {:.2e} ms",
+        max_hdur, min_hdur, avg_hdur);
+  }
+#endif
+  logger->info("  {} = {:.2e} GiB", "HMEM_LOC",
+               H.mem_footprint() / 1073741824.);
+  logger->info("  {} = {:.2f}%", "H_SPARSE",
+               full_nnz / double(H.n() * H.n()) * 100);
+#ifdef MACIS_ENABLE_MPI
+  if(world_size > 1) {
+    // Stored elements per rank
+    logger->info("  {}_MAX = {}, {}_MIN = {}, {}_AVG = {}", nnz_label, max_nnz,
+                 nnz_label, min_nnz, nnz_label,
+                 total_nnz / double(world_size));
+  }
+#endif
+
+  // Solve EVP
+#ifdef MACIS_ENABLE_MPI
+  auto E = parallel_selected_ci_diag(H, davidson_max_m, davidson_res_tol,
+                                     C_local, comm, upper_triangle);
+#else
+  auto E = serial_selected_ci_diag(H, davidson_max_m, davidson_res_tol,
+                                   C_local, upper_triangle);
+#endif
+
+  return E;
+}
+
+/**
+ *  @brief Options of the stored Hamiltonian of `selected_ci_diag`.
+ *
+ *  If `upper_triangle` is set, only the upper triangle of H is generated and
+ *  stored, and H*V is evaluated through the symmetric SpMV kernels.
+ *
+ *  If `compress_colind` is set, the column indices of H are delta-encoded
+ *  (sparsexx::compressed_csr_matrix) after generation.
+ *
+ *  If `balance_rows` is set (MPI only), the rows of H are distributed
+ *  according to their estimated work (see balanced_row_extents).
+ *
+ *  If `ham_cache` is set, H is memory mapped from the binary CSR file(s)
+ *  "`ham_cache`(.<rank>)" if they were written for the same determinants,
+ *  integrals and storage (see hamiltonian_cache_key), skipping the
+ *  generation of H. Otherwise H is generated, and the cache is (re)written
+ *  if `write_ham_cache` is set.
+ *  A mapped H is used as stored on disk, i.e. `compress_colind` only
+ *  applies to generated Hamiltonians.
+ *
+ *  If `quiet` is set, the "ci_solver" logger is muted for the duration of the
+ *  call.
+ */
+struct SelectedCIOptions {
+  bool quiet = false;
+  bool upper_triangle = false;
+  bool compress_colind = false;
+  bool balance_rows = false;
+  std::string ham_cache;
+  bool write_ham_cache = false;
+
+  SelectedCIOptions() = default;
+
+  /// Storage of H as requested by the ci_* members of `settings`
+  explicit SelectedCIOptions(const MCSCFSettings& settings,
+                             bool _quiet = false)
+      : quiet(_quiet),
+        upper_triangle(settings.ci_ham_upper_triangle),
+        compress_colind(settings.ci_compress_colind),
+        balance_rows(settings.ci_balance_rows),
+        ham_cache(settings.ci_ham_cache),
+        write_ham_cache(settings.ci_ham_cache_write) {}
+};
+
+/**
+ *  @brief Reject CI Hamiltonian settings which can not be honored.
+ *
+ *  At most one alternative to the stored Hamiltonian of `selected_ci_diag`
+ *  may be requested: ci_direct_sigma, ci_mixed_precision or one of those of
+ *  the caller (`spin_flip`, `reuse_hamiltonian`). The storage options of
+ *  SelectedCIOptions (ci_ham_upper_triangle, ci_compress_colind,
+ *  ci_balance_rows, ci_ham_cache) only apply to the stored Hamiltonian.
+ */
+inline void check_ci_hamiltonian_settings(const MCSCFSettings& settings,
+                                          bool spin_flip = false,
+                                          bool reuse_hamiltonian = false) {
+  std::vector<std::string> alt;
+  if(spin_flip) alt.emplace_back("spin_flip");
+  if(reuse_hamiltonian) alt.emplace_back("reuse_hamiltonian");
+  if(settings.ci_direct_sigma) alt.emplace_back("ci_direct_sigma");
+  if(settings.ci_mixed_precision) alt.emplace_back("ci_mixed_precision");
+  if(alt.size() > 1)
+    throw std::runtime_error(alt[0] + " and " + alt[1] +
+                             " can not be combined");
+
+  const bool storage = settings.ci_ham_upper_triangle or
+                       settings.ci_compress_colind or
+                       settings.ci_balance_rows or settings.ci_ham_cache.size();
+  if(alt.size() and storage)
+    throw std::runtime_error(
+        alt[0] +
+        " is incompatible with ci_ham_upper_triangle, ci_compress_colind, "
+        "ci_balance_rows and ci_ham_cache");
+}
+
+/**
+ *  @brief Selected CI diagonalization with a stored (dist-)CSR Hamiltonian.
+ *
+ *  See SelectedCIOptions for the storage of H. If `dets_sorted` is given, it
+ *  is the alpha-sorted store of [`dets_begin`, `dets_end`) (e.g. shared with
+ *  the ASCI search, see asci_iter), from which H is generated.
+ */
 template <size_t N, typename index_t = int32_t>
 double selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
                         wavefunction_iterator_t<N> dets_end,
@@ -128,11 +316,16 @@ double selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
                         size_t davidson_max_m, double davidson_res_tol,
                         std::vector<double>& C_local,
                         MACIS_MPI_CODE(MPI_Comm comm, )
-                            const bool quiet = false) {
+                            const SelectedCIOptions& opts = {},
+                        const alpha_sorted_dets<N>* dets_sorted = nullptr) {
+  const bool upper_triangle = opts.upper_triangle;
+  const auto& ham_cache = opts.ham_cache;
+
   auto logger = spdlog::get("ci_solver");
   if(!logger) {
     logger = spdlog::stdout_color_mt("ci_solver");
   }
+  detail::quiet_logger_guard quiet_guard(logger, opts.quiet);
 
   logger->info("[Selected CI Solver]:");
   logger->info("  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}", "NDETS",
@@ -142,66 +335,389 @@ double selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double, std::milli>;
 
+  auto solve = [&](const auto& H, auto H_st, auto H_en) {
+    MACIS_MPI_CODE(MPI_Barrier(comm);)
+    return stored_selected_ci_diag(H, duration_type(H_en - H_st).count(),
+                                   davidson_max_m, davidson_res_tol,
+                                   C_local MACIS_MPI_CODE(, comm),
+                                   upper_triangle);
+  };
+
+  // Map H from the on-disk cache
+  uint64_t cache_key = 0;
+  if(ham_cache.size()) {
+    cache_key = hamiltonian_cache_key(dets_begin, dets_end, ham_gen, h_el_tol,
+                                      upper_triangle);
+    MACIS_MPI_CODE(MPI_Barrier(comm);)
+    auto H_st = clock_type::now();
+    auto H = read_hamiltonian_cache<index_t>(MACIS_MPI_CODE(comm, ) ham_cache,
+                                             cache_key);
+    if(H) {
+      logger->info("  * Mapped H from {}", ham_cache);
+      return solve(*H, H_st, clock_type::now());
+    }
+    logger->info("  * No valid H in {}, will generate H", ham_cache);
+  }
+
   // Generate Hamiltonian
   MACIS_MPI_CODE(MPI_Barrier(comm);)
   auto H_st = clock_type::now();
 
 #ifdef MACIS_ENABLE_MPI
-  auto H = make_dist_csr_hamiltonian<index_t>(comm, dets_begin, dets_end,
-                                              ham_gen, h_el_tol);
+  auto H = dets_sorted
+               ? make_dist_csr_hamiltonian<index_t>(
+                     comm, *dets_sorted, ham_gen, h_el_tol, upper_triangle,
+                     opts.balance_rows)
+               : make_dist_csr_hamiltonian<index_t>(
+                     comm, dets_begin, dets_end, ham_gen, h_el_tol,
+                     upper_triangle, opts.balance_rows);
+#else
+  auto H = dets_sorted
+               ? make_csr_hamiltonian<index_t>(*dets_sorted, ham_gen, h_el_tol,
+                                               upper_triangle)
+               : make_csr_hamiltonian<index_t>(dets_begin, dets_end, ham_gen,
+                                               h_el_tol, upper_triangle);
+#endif
+
+  auto H_en = clock_type::now();
+
+  if(ham_cache.size() and opts.write_ham_cache) {
+    auto wr_st = clock_type::now();
+    write_hamiltonian_cache(H, ham_cache, cache_key);
+    auto wr_en = clock_type::now();
+    logger->info("  * Wrote H to {}, {} = {:.5e} ms", ham_cache,
+                 "H_CACHE_DUR", duration_type(wr_en - wr_st).count());
+  }
+
+  if(opts.compress_colind) {
+    using compressed_csr_type =
+        sparsexx::compressed_csr_matrix<double, index_t>;
+#ifdef MACIS_ENABLE_MPI
+    using compressed_type = sparsexx::dist_sparse_matrix<compressed_csr_type>;
 #else
-  auto H =
-      make_csr_hamiltonian<index_t>(dets_begin, dets_end, ham_gen, h_el_tol);
+    using compressed_type = compressed_csr_type;
 #endif
+    // Convert from the generated H, releasing it before the solve
+    return solve(compressed_type(std::move(H)), H_st, clock_type::now());
+  }
+
+  return solve(H, H_st, H_en);
+}
+
+/**
+ *  @brief Selected CI diagonalization with a Hamiltonian which is updated
+ *  incrementally from the previous call.
+ *
+ *  Same interface as `selected_ci_diag`, H is formed through
+ *  `IncrementalHamiltonian::update` such that only the rows / columns of
+ *  determinants which were not present in the previous space are generated.
+ */
+template <size_t N, typename index_t>
+double selected_ci_diag(IncrementalHamiltonian<N, index_t>& H_cache,
+                        wavefunction_iterator_t<N> dets_begin,
+                        wavefunction_iterator_t<N> dets_end,
+                        HamiltonianGenerator<N>& ham_gen, double h_el_tol,
+                        size_t davidson_max_m, double davidson_res_tol,
+                        std::vector<double>& C_local,
+                        MACIS_MPI_CODE(MPI_Comm comm, )
+                            const bool quiet = false) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+  detail::quiet_logger_guard quiet_guard(logger, quiet);
+
+  logger->info("[Selected CI Solver (Incremental H)]:");
+  logger->info("  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}", "NDETS",
+               std::distance(dets_begin, dets_end), "MATEL_TOL", h_el_tol,
+               "RES_TOL", davidson_res_tol, "MAX_SUB", davidson_max_m);
+
+  using clock_type = std::chrono::high_resolution_clock;
+  using duration_type = std::chrono::duration<double, std::milli>;
+
+  // Update Hamiltonian
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto H_st = clock_type::now();
+
+  const auto& H = H_cache.update(MACIS_MPI_CODE(comm, ) dets_begin, dets_end,
+                                 ham_gen, h_el_tol);
 
   auto H_en = clock_type::now();
   MACIS_MPI_CODE(MPI_Barrier(comm);)
 
-  // Get total NNZ
+  size_t nreuse = H_cache.nrows_reused();
+  MACIS_MPI_CODE(nreuse = allreduce(nreuse, MPI_SUM, comm);)
+  logger->info("  {} = {:6}", "H_ROWS_REUSED", nreuse);
+
+  return stored_selected_ci_diag(H, duration_type(H_en - H_st).count(),
+                                 davidson_max_m, davidson_res_tol,
+                                 C_local MACIS_MPI_CODE(, comm));
+}
+
+/**
+ *  @brief Selected CI diagonalization in the spin-flip adapted basis.
+ *
+ *  Same interface as `selected_ci_diag`, the determinants must be canonical
+ *  representatives (see spin_flip.hpp) and C_local is returned in the spin-flip
+ *  adapted basis. Only the even parity (e.g. singlet) states are accessible.
+ */
+template <size_t N, typename index_t = int32_t>
+double spin_flip_selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
+                                  wavefunction_iterator_t<N> dets_end,
+                                  HamiltonianGenerator<N>& ham_gen,
+                                  double h_el_tol, size_t davidson_max_m,
+                                  double davidson_res_tol,
+                                  std::vector<double>& C_local,
+                                  MACIS_MPI_CODE(MPI_Comm comm, )
+                                      const bool quiet = false) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+  detail::quiet_logger_guard quiet_guard(logger, quiet);
+
+  logger->info("[Selected CI Solver (Spin-Flip Adapted)]:");
+  logger->info("  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}", "NSFDETS",
+               std::distance(dets_begin, dets_end), "MATEL_TOL", h_el_tol,
+               "RES_TOL", davidson_res_tol, "MAX_SUB", davidson_max_m);
+
+  using clock_type = std::chrono::high_resolution_clock;
+  using duration_type = std::chrono::duration<double, std::milli>;
+
+  // Generate Hamiltonian
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto H_st = clock_type::now();
+
 #ifdef MACIS_ENABLE_MPI
-  size_t local_nnz = H.nnz();
-  size_t total_nnz = allreduce(local_nnz, MPI_SUM, comm);
-  size_t max_nnz = allreduce(local_nnz, MPI_MAX, comm);
-  size_t min_nnz = allreduce(local_nnz, MPI_MIN, comm);
+  auto H = make_dist_spin_flip_csr_hamiltonian<index_t>(
+      comm, dets_begin, dets_end, ham_gen, h_el_tol);
 #else
-  size_t total_nnz = H.nnz();
+  auto H = make_spin_flip_csr_hamiltonian<index_t>(dets_begin, dets_end,
+                                                   ham_gen, h_el_tol);
 #endif
 
-  logger->info("  {}   = {:6}, {}     = {:.5e} ms", "NNZ", total_nnz, "H_DUR",
-               duration_type(H_en - H_st).count());
+  auto H_en = clock_type::now();
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+
+  return stored_selected_ci_diag(H, duration_type(H_en - H_st).count(),
+                                 davidson_max_m, davidson_res_tol,
+                                 C_local MACIS_MPI_CODE(, comm));
+}
+
+/**
+ *  @brief Setup the Davidson guess for selected CI from the local diagonal.
+ *
+ *  The passed (local) vector is kept if it is non-trivial, otherwise it is
+ *  replaced by the unit vector of the lowest diagonal element.
+ */
+inline void selected_ci_guess(size_t ndets, const std::vector<double>& D_local,
+                              std::vector<double>& C_local
+                                  MACIS_MPI_CODE(, MPI_Comm comm)) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+
+  const size_t nlocal = D_local.size();
+  C_local.resize(nlocal, 0);
+
+  double max_c = 0.;
+  for(auto c : C_local) max_c = std::max(max_c, std::abs(c));
+  MACIS_MPI_CODE(max_c = allreduce(max_c, MPI_MAX, comm);)
+
+  if(max_c > (1. / ndets)) {
+    logger->info("  * Will use passed vector as guess");
+  } else {
+    logger->info("  * Will generate identity guess");
+    std::fill(C_local.begin(), C_local.end(), 0.);
 
+    auto D_min = std::min_element(D_local.begin(), D_local.end());
+    double local_min = nlocal ? *D_min : std::numeric_limits<double>::max();
 #ifdef MACIS_ENABLE_MPI
-  auto world_size = comm_size(comm);
-  if(world_size > 1) {
-    double local_hdur = duration_type(H_en - H_st).count();
-    double max_hdur = allreduce(local_hdur, MPI_MAX, comm);
-    double min_hdur = allreduce(local_hdur, MPI_MIN, comm);
-    double avg_hdur = allreduce(local_hdur, MPI_SUM, comm);
-    avg_hdur /= world_size;
-    logger->info(
-        "  H_DUR_MAX = {:.2e} ms, H_DUR_MIN = {:.2e} ms, H_DUR_AVG = {:.2e} ms",
-        max_hdur, min_hdur, avg_hdur);
+    // The lowest rank which holds the global minimum owns the guess
+    const auto world_rank = comm_rank(comm);
+    const auto world_size = comm_size(comm);
+    double global_min = allreduce(local_min, MPI_MIN, comm);
+    int owner = allreduce(local_min == global_min ? world_rank : world_size,
+                          MPI_MIN, comm);
+    if(world_rank == owner)
+#endif
+      C_local[std::distance(D_local.begin(), D_min)] = 1.;
+  }
+}
+
+/**
+ *  @brief Selected CI diagonalization without a stored Hamiltonian.
+ *
+ *  Same interface as `selected_ci_diag`, but H*V (and the Davidson diagonal)
+ *  are evaluated on the fly through DirectHamiltonianOperator. This trades
+ *  recomputation of matrix elements in every Davidson iteration for the
+ *  memory of the (dist-)CSR Hamiltonian.
+ */
+template <size_t N>
+double direct_selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
+                               wavefunction_iterator_t<N> dets_end,
+                               HamiltonianGenerator<N>& ham_gen,
+                               double h_el_tol, size_t davidson_max_m,
+                               double davidson_res_tol,
+                               std::vector<double>& C_local,
+                               MACIS_MPI_CODE(MPI_Comm comm, )
+                                   const bool quiet = false) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
   }
+  detail::quiet_logger_guard quiet_guard(logger, quiet);
+
+  logger->info("[Selected CI Solver (Direct)]:");
+  logger->info("  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}", "NDETS",
+               std::distance(dets_begin, dets_end), "MATEL_TOL", h_el_tol,
+               "RES_TOL", davidson_res_tol, "MAX_SUB", davidson_max_m);
+
+  using clock_type = std::chrono::high_resolution_clock;
+  using duration_type = std::chrono::duration<double, std::milli>;
+
+  // Setup operator (determinant grouping only, no matrix storage)
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto H_st = clock_type::now();
+
+  DirectHamiltonianOperator<N> op(MACIS_MPI_CODE(comm, ) dets_begin, dets_end,
+                                  ham_gen, h_el_tol);
+  auto D_local = op.diagonal();
+
+  auto H_en = clock_type::now();
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+
+  logger->info("  {} = {:.5e} ms", "H_SETUP_DUR",
+               duration_type(H_en - H_st).count());
+
+  // Setup guess
+  const size_t nlocal = op.local_row_extent();
+  selected_ci_guess(op.m(), D_local, C_local MACIS_MPI_CODE(, comm));
+
+  // Solve EVP
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto dav_st = clock_type::now();
+
+#ifdef MACIS_ENABLE_MPI
+  auto [niter, E] = p_davidson(nlocal, davidson_max_m, op, D_local.data(),
+                               davidson_res_tol, C_local.data(), comm);
+#else
+  auto [niter, E] = davidson(nlocal, davidson_max_m, op, D_local.data(),
+                             davidson_res_tol, C_local.data());
 #endif
+
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto dav_en = clock_type::now();
+
+  logger->info("  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms", "DAV_NITER",
+               niter, "E0", E, "DAVIDSON_DUR",
+               duration_type(dav_en - dav_st).count());
+
+  return E;
+}
+
+/**
+ *  @brief Selected CI diagonalization with a mixed precision Hamiltonian.
+ *
+ *  Same interface as `selected_ci_diag`. H is generated by blocks of rows
+ *  into a MixedPrecisionMatrixOperator (single precision off-diagonal
+ *  elements, see make_mixed_precision_hamiltonian), such that it is never
+ *  held in double precision. Once the residual reaches the resolution
+ *  of the reduced precision matrix, the eigenpair is polished to
+ *  `davidson_res_tol` with the (exact) DirectHamiltonianOperator, such that
+ *  no double precision copy of H has to be kept.
+ */
+template <size_t N, typename index_t = int32_t>
+double mixed_precision_selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
+                                        wavefunction_iterator_t<N> dets_end,
+                                        HamiltonianGenerator<N>& ham_gen,
+                                        double h_el_tol, size_t davidson_max_m,
+                                        double davidson_res_tol,
+                                        std::vector<double>& C_local,
+                                        MACIS_MPI_CODE(MPI_Comm comm, )
+                                            const bool quiet = false) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+  detail::quiet_logger_guard quiet_guard(logger, quiet);
+
+  logger->info("[Selected CI Solver (Mixed Precision)]:");
+  logger->info("  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}", "NDETS",
+               std::distance(dets_begin, dets_end), "MATEL_TOL", h_el_tol,
+               "RES_TOL", davidson_res_tol, "MAX_SUB", davidson_max_m);
+
+  using clock_type = std::chrono::high_resolution_clock;
+  using duration_type = std::chrono::duration<double, std::milli>;
+
+  // Generate Hamiltonian, converted to reduced precision by blocks of rows
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto H_st = clock_type::now();
+
+  auto op = make_mixed_precision_hamiltonian<index_t>(
+      MACIS_MPI_CODE(comm, ) dets_begin, dets_end, ham_gen, h_el_tol);
+
+  auto H_en = clock_type::now();
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+
+  size_t total_nnz = op.nnz();
+  MACIS_MPI_CODE(total_nnz = allreduce(total_nnz, MPI_SUM, comm);)
+  logger->info("  {}   = {:6}, {}     = {:.5e} ms", "NNZ", total_nnz, "H_DUR",
+               duration_type(H_en - H_st).count());
   logger->info("  {} = {:.2e} GiB", "HMEM_LOC",
-               H.mem_footprint() / 1073741824.);
-  logger->info("  {} = {:.2f}%", "H_SPARSE",
-               total_nnz / double(H.n() * H.n()) * 100);
+               op.mem_footprint() / 1073741824.);
+
+  // Setup guess
+  const size_t ndets = std::distance(dets_begin, dets_end);
+  const auto& D_local = op.diagonal();
+  const size_t nlocal = D_local.size();
+  selected_ci_guess(ndets, D_local, C_local MACIS_MPI_CODE(, comm));
+
+  // Residual norms below this are not resolved by single precision
+  // off-diagonal elements
+  const double mixed_res_tol = std::max(davidson_res_tol, 1e-5);
+
+  // Solve EVP in mixed precision
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto dav_st = clock_type::now();
+
 #ifdef MACIS_ENABLE_MPI
-  if(world_size > 1) {
-    logger->info("  NNZ_MAX = {}, NNZ_MIN = {}, NNZ_AVG = {}", max_nnz, min_nnz,
-                 total_nnz / double(world_size));
-  }
+  auto [niter, E] = p_davidson(nlocal, davidson_max_m, op, D_local.data(),
+                               mixed_res_tol, C_local.data(), comm);
+#else
+  auto [niter, E] = davidson(nlocal, davidson_max_m, op, D_local.data(),
+                             mixed_res_tol, C_local.data());
 #endif
 
-  // Solve EVP
+  MACIS_MPI_CODE(MPI_Barrier(comm);)
+  auto dav_en = clock_type::now();
+
+  logger->info("  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms", "DAV_NITER",
+               niter, "E0", E, "DAVIDSON_DUR",
+               duration_type(dav_en - dav_st).count());
+
+  if(davidson_res_tol < mixed_res_tol) {
+    // Polish in full precision
+    auto pol_st = clock_type::now();
+    DirectHamiltonianOperator<N> op_full(MACIS_MPI_CODE(comm, ) dets_begin,
+                                         dets_end, ham_gen, h_el_tol);
 #ifdef MACIS_ENABLE_MPI
-  auto E = parallel_selected_ci_diag(H, davidson_max_m, davidson_res_tol,
-                                     C_local, comm);
+    std::tie(niter, E) =
+        p_davidson(nlocal, davidson_max_m, op_full, D_local.data(),
+                   davidson_res_tol, C_local.data(), comm);
 #else
-  auto E =
-      serial_selected_ci_diag(H, davidson_max_m, davidson_res_tol, C_local);
+    std::tie(niter, E) = davidson(nlocal, davidson_max_m, op_full,
+                                  D_local.data(), davidson_res_tol,
+                                  C_local.data());
 #endif
+    MACIS_MPI_CODE(MPI_Barrier(comm);)
+    auto pol_en = clock_type::now();
+
+    logger->info("  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms", "POL_NITER",
+                 niter, "E0", E, "POLISH_DUR",
+                 duration_type(pol_en - pol_st).count());
+  }
 
   return E;
 }
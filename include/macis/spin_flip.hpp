@@ -0,0 +1,127 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <cmath>
+#include <macis/bitset_operations.hpp>
+#include <macis/types.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Spin-flip (time-reversal) adapted determinant basis for Ms = 0 states.
+//
+// The Hamiltonian is invariant under the exchange of the alpha and beta
+// strings of all determinants, such that its Ms = 0 eigenstates satisfy
+// C(|ab>) = +/- C(|ba>). The states with even parity (which includes the
+// closed shell determinants, i.e. the singlets) are expanded in the
+// functions
+//
+//   |D'> = (|D> + |D~>) / sqrt(2)  if D != D~
+//   |D'> =  |D>                    if D == D~
+//
+// where D~ is the spin-flipped determinant and D is the lesser (see
+// bitset_less) of the pair, its canonical representative. Matrix elements in
+// this basis are given by
+//
+//   <D'|H|E'> = 2 n(D) n(E) (<D|H|E> + <D|H|E~>)
+//
+// with n(D) = 1/sqrt(2) if D != D~ and 1/2 otherwise.
+
+namespace macis {
+
+/// Exchange the alpha and beta strings of a determinant
+template <size_t N>
+inline wfn_t<N> spin_flip(wfn_t<N> state) {
+  return (state << (N / 2)) | (state >> (N / 2));
+}
+
+/// Whether a determinant is the canonical representative of its spin-flip
+/// pair
+template <size_t N>
+inline bool is_spin_flip_canonical(wfn_t<N> state) {
+  return not bitset_less(spin_flip(state), state);
+}
+
+/// Canonical representative of the spin-flip pair of a determinant
+template <size_t N>
+inline wfn_t<N> spin_flip_canonical(wfn_t<N> state) {
+  const auto flipped = spin_flip(state);
+  return bitset_less(flipped, state) ? flipped : state;
+}
+
+/// Normalization n(D) of a spin-flip adapted function (see above)
+template <size_t N>
+inline double spin_flip_norm(wfn_t<N> state) {
+  return spin_flip(state) == state ? 0.5 : M_SQRT1_2;
+}
+
+/**
+ *  @brief Expand a wave function in the spin-flip adapted basis into
+ *  determinants.
+ *
+ *  @param[in] dets_begin Beginning of the canonical representatives
+ *  @param[in] dets_end   End of the canonical representatives
+ *  @param[in] C          Coefficients in the spin-flip adapted basis
+ *
+ *  @returns The representatives followed by the spin-flipped partners of the
+ *  non self-conjugate representatives, and their coefficients
+ */
+template <size_t N>
+std::pair<std::vector<wfn_t<N>>, std::vector<double>> spin_flip_unfold(
+    wavefunction_iterator_t<N> dets_begin, wavefunction_iterator_t<N> dets_end,
+    const double* C) {
+  const size_t ndets = std::distance(dets_begin, dets_end);
+  std::vector<wfn_t<N>> dets(dets_begin, dets_end);
+  std::vector<double> C_det(C, C + ndets);
+  for(size_t i = 0; i < ndets; ++i) {
+    const auto flipped = spin_flip(dets[i]);
+    if(flipped == dets[i]) continue;
+    C_det[i] *= M_SQRT1_2;
+    dets.emplace_back(flipped);
+    C_det.emplace_back(C_det[i]);
+  }
+  return std::make_pair(std::move(dets), std::move(C_det));
+}
+
+/**
+ *  @brief Project a wave function in the determinant basis onto the (even
+ *  parity) spin-flip adapted basis.
+ *
+ *  Determinants are replaced by their canonical representatives (in order
+ *  of first appearance), such that this also serves to adapt a determinant
+ *  list.
+ *
+ *  @returns The canonical representatives and their coefficients
+ */
+template <size_t N>
+std::pair<std::vector<wfn_t<N>>, std::vector<double>> spin_flip_fold(
+    wavefunction_iterator_t<N> dets_begin, wavefunction_iterator_t<N> dets_end,
+    const double* C) {
+  const size_t ndets = std::distance(dets_begin, dets_end);
+  std::vector<wfn_t<N>> dets;
+  std::vector<double> C_sf;
+  std::unordered_map<wfn_t<N>, size_t> index;
+  for(size_t i = 0; i < ndets; ++i) {
+    const auto det = spin_flip_canonical(*(dets_begin + i));
+    auto [it, inserted] = index.try_emplace(det, dets.size());
+    if(inserted) {
+      dets.emplace_back(det);
+      C_sf.emplace_back(0.);
+    }
+    C_sf[it->second] += spin_flip_norm(det) * C[i];
+  }
+
+  // Self-conjugate determinants only appear once
+  for(size_t i = 0; i < dets.size(); ++i)
+    if(spin_flip(dets[i]) == dets[i]) C_sf[i] *= 2;
+
+  return std::make_pair(std::move(dets), std::move(C_sf));
+}
+
+}  // namespace macis
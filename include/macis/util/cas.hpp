@@ -49,11 +49,26 @@ double compute_casci_rdms(
                  rank4_span<double>(V, no, no, no, no));
 
   // Compute Lowest Energy Eigenvalue (ED)
-  auto dets = generate_hilbert_space<nbits>(norb.get(), nalpha, nbeta);
-  double E0 =
-      selected_ci_diag(dets.begin(), dets.end(), ham_gen, settings.ci_matel_tol,
-                       settings.ci_max_subspace, settings.ci_res_tol, C,
-                       MACIS_MPI_CODE(comm, ) true);
+  auto dets = generate_hilbert_space<nbits>(
+      norb.get(), nalpha, nbeta, settings.ci_orbsym, settings.ci_target_irrep);
+  double E0;
+  check_ci_hamiltonian_settings(settings);
+  if(settings.ci_direct_sigma) {
+    E0 = direct_selected_ci_diag(
+        dets.begin(), dets.end(), ham_gen, settings.ci_matel_tol,
+        settings.ci_max_subspace, settings.ci_res_tol, C,
+        MACIS_MPI_CODE(comm, ) true);
+  } else if(settings.ci_mixed_precision) {
+    E0 = mixed_precision_selected_ci_diag(
+        dets.begin(), dets.end(), ham_gen, settings.ci_matel_tol,
+        settings.ci_max_subspace, settings.ci_res_tol, C,
+        MACIS_MPI_CODE(comm, ) true);
+  } else {
+    E0 = selected_ci_diag(
+        dets.begin(), dets.end(), ham_gen, settings.ci_matel_tol,
+        settings.ci_max_subspace, settings.ci_res_tol, C,
+        MACIS_MPI_CODE(comm, ) SelectedCIOptions(settings, true));
+  }
 
   // Compute RDMs
   ham_gen.form_rdms(dets.begin(), dets.end(), dets.begin(), dets.end(),
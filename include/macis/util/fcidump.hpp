@@ -9,6 +9,7 @@
 #pragma once
 #include <macis/types.hpp>
 #include <string>
+#include <vector>
 
 namespace macis {
 
@@ -28,6 +29,28 @@ uint32_t read_fcidump_norb(std::string fname);
  */
 double read_fcidump_core(std::string fname);
 
+/**
+ *  @brief Extract the orbital irreps (ORBSYM) from a FCIDUMP file
+ *
+ *  Irreps are returned 0-based (ORBSYM - 1), such that the direct product of
+ *  two irreps of D2h or one of its subgroups is the bitwise XOR of their
+ *  labels.
+ *
+ *  @param[in] fname Filename of FCIDUMP file
+ *  @returns The irreps of the orbitals in `fname`, empty if the header does
+ *  not specify ORBSYM
+ */
+std::vector<uint32_t> read_fcidump_orbsym(std::string fname);
+
+/**
+ *  @brief Extract the irrep of the target state (ISYM) from a FCIDUMP file
+ *
+ *  @param[in] fname Filename of FCIDUMP file
+ *  @returns The 0-based irrep (ISYM - 1) of the target state, 0 if the
+ *  header does not specify ISYM
+ */
+uint32_t read_fcidump_isym(std::string fname);
+
 /**
  *  @brief Extract the one-body Hamiltonian from a FCIDUMP file
  *
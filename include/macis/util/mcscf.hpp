@@ -9,6 +9,8 @@
 #pragma once
 #include <macis/types.hpp>
 #include <macis/util/mpi.hpp>
+#include <string>
+#include <vector>
 
 namespace macis {
 
@@ -27,6 +29,16 @@ struct MCSCFSettings {
   double ci_res_tol = 1e-8;
   size_t ci_max_subspace = 20;
   double ci_matel_tol = std::numeric_limits<double>::epsilon();
+  bool ci_sorted_ham_gen = false;
+  bool ci_direct_sigma = false;
+  bool ci_ham_upper_triangle = false;  // Half storage of stored H
+  bool ci_mixed_precision = false;     // Single precision off-diagonal H
+  bool ci_compress_colind = false;     // Delta-encoded column indices of H
+  bool ci_balance_rows = false;        // Work balanced row distribution of H
+  std::string ci_ham_cache;            // On-disk cache of H (empty: none)
+  bool ci_ham_cache_write = false;     // (Re)write ci_ham_cache on a miss
+  std::vector<uint32_t> ci_orbsym;     // Active orbital irreps (empty: C1)
+  uint32_t ci_target_irrep = 0;        // Irrep of the CAS-CI state
 };
 
 double casscf_diis(MCSCFSettings settings, NumElectron nalpha,
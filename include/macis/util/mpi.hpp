@@ -20,9 +20,12 @@
 #include <mpi.h>
 
 #include <bitset>
+#include <cstdint>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 
 namespace macis {
 
@@ -219,6 +222,77 @@ void bcast(T* buffer, size_t count, int root, MPI_Comm comm) {
   }
 }
 
+/**
+ *  @brief Gather variable sized local buffers onto all PEs.
+ *
+ *  @param[in]  send  Local data
+ *  @param[in]  count Number of local elements
+ *  @param[out] recv  Local data of all PEs concatenated in rank order
+ *  @param[in]  comm  MPI communicator for PEs to participate in the gather
+ */
+template <typename T>
+void allgatherv(const T* send, size_t count, std::vector<T>& recv,
+                MPI_Comm comm) {
+  auto dtype = mpi_traits<T>::datatype();
+  const auto world_size = comm_size(comm);
+
+  size_t intmax = std::numeric_limits<int>::max();
+  if(count > intmax)
+    throw std::runtime_error("Msg over INT_MAX not yet tested");
+
+  int local_count = count;
+  std::vector<int> counts(world_size), displs(world_size + 1, 0);
+  MPI_Allgather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+  for(int i = 0; i < world_size; ++i) {
+    if(size_t(displs[i]) + counts[i] > intmax)
+      throw std::runtime_error("Msg over INT_MAX not yet tested");
+    displs[i + 1] = displs[i] + counts[i];
+  }
+
+  recv.resize(displs.back());
+  MPI_Allgatherv(send, local_count, dtype, recv.data(), counts.data(),
+                 displs.data(), dtype, comm);
+}
+
+/**
+ *  @brief Counter shared by the PEs of a communicator.
+ *
+ *  The counter is stored on rank 0 and updated through MPI one-sided atomics,
+ *  e.g. to hand out work items dynamically. Construction and destruction are
+ *  collective, only one thread per PE may access the counter at a time.
+ */
+class mpi_shared_counter {
+  MPI_Win win_;
+
+ public:
+  mpi_shared_counter(MPI_Comm comm) {
+    const MPI_Aint size = comm_rank(comm) ? 0 : sizeof(uint64_t);
+    uint64_t* base;
+    MPI_Win_allocate(size, sizeof(uint64_t), MPI_INFO_NULL, comm, &base,
+                     &win_);
+    if(size) {
+      MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win_);
+      *base = 0;
+      MPI_Win_unlock(0, win_);
+    }
+    MPI_Barrier(comm);
+  }
+
+  ~mpi_shared_counter() noexcept { MPI_Win_free(&win_); }
+
+  mpi_shared_counter(const mpi_shared_counter&) = delete;
+  mpi_shared_counter& operator=(const mpi_shared_counter&) = delete;
+
+  /// Atomically add `n` to the counter, returns its previous value
+  uint64_t fetch_add(uint64_t n) {
+    uint64_t prev;
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win_);
+    MPI_Fetch_and_op(&n, &prev, MPI_UINT64_T, 0, 0, MPI_SUM, win_);
+    MPI_Win_unlock(0, win_);
+    return prev;
+  }
+};
+
 /// MPI wrapper for `std::bitset`
 template <size_t N>
 struct mpi_traits<std::bitset<N>> {
@@ -0,0 +1,551 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace macis {
+
+namespace detail {
+
+/// Number of 64-bit words of a radix sort key
+template <typename KeyT>
+inline constexpr size_t radix_key_nwords =
+    (sizeof(KeyT) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+/// `i`-th (least significant first) 64-bit word of a radix sort key
+template <typename KeyT>
+inline uint64_t radix_key_word(const KeyT& key, size_t i) {
+  uint64_t w = 0;
+  const char* ptr = reinterpret_cast<const char*>(&key) + i * 8;
+  if constexpr(sizeof(KeyT) % sizeof(uint64_t) == 0)
+    std::memcpy(&w, ptr, sizeof(uint64_t));
+  else
+    std::memcpy(&w, ptr, std::min(sizeof(uint64_t), sizeof(KeyT) - i * 8));
+  return w;
+}
+
+/// Key ordering of the radix sort (compares from the most significant word)
+template <typename KeyT>
+inline bool radix_key_less(const KeyT& x, const KeyT& y) {
+  for(size_t i = radix_key_nwords<KeyT>; i-- > 0;) {
+    const auto x_i = radix_key_word(x, i);
+    const auto y_i = radix_key_word(y, i);
+    if(x_i != y_i) return x_i < y_i;
+  }
+  return false;
+}
+
+/// A radix sort digit: bits [shift, shift + nbits) of key word `word`
+struct radix_digit {
+  size_t word;
+  unsigned shift;
+  unsigned nbits;
+
+  template <typename KeyT>
+  inline size_t operator()(const KeyT& key) const {
+    return (radix_key_word(key, word) >> shift) & ((uint64_t(1) << nbits) - 1);
+  }
+};
+
+inline constexpr unsigned radix_bits = 8;
+inline constexpr size_t radix_nbuckets = size_t(1) << radix_bits;
+
+/**
+ *  @brief Digits of a MSD radix sort, most significant first.
+ *
+ *  Only covers the bits in `varying` (bits in which the keys differ), each
+ *  digit starts at the most significant varying bit not covered yet.
+ */
+template <size_t NWords>
+std::vector<radix_digit> radix_msd_digits(
+    const std::array<uint64_t, NWords>& varying) {
+  std::vector<radix_digit> digits;
+  for(size_t w = NWords; w-- > 0;) {
+    uint64_t mask = varying[w];
+    while(mask) {
+      const unsigned top = 64 - __builtin_clzll(mask);
+      const unsigned shift = top > radix_bits ? top - radix_bits : 0;
+      digits.push_back({w, shift, top - shift});
+      mask &= shift ? (uint64_t(1) << shift) - 1 : 0;
+    }
+  }
+  return digits;
+}
+
+/// Stable insertion sort of a (small) range by key
+template <typename T, typename KeyFunction>
+void radix_insertion_sort(T* begin, T* end, KeyFunction& key) {
+  for(T* it = begin + 1; it < end; ++it) {
+    if(not radix_key_less(key(*it), key(*(it - 1)))) continue;
+    T x = std::move(*it);
+    T* jt = it;
+    for(; jt > begin and radix_key_less(key(x), key(*(jt - 1))); --jt)
+      *jt = std::move(*(jt - 1));
+    *jt = std::move(x);
+  }
+}
+
+/**
+ *  @brief Serial MSD radix sort of src[0,n) from digit `d` on.
+ *
+ *  `dst` is scratch of the same size, the sorted range ends up in `src` if
+ *  `src_is_output` and in `dst` otherwise.
+ */
+template <typename T, typename KeyFunction>
+void radix_msd_sort(T* src, T* dst, size_t n, bool src_is_output,
+                    const std::vector<radix_digit>& digits, size_t d,
+                    KeyFunction& key) {
+  // Skip digits in which the keys of the range do not differ
+  std::array<size_t, radix_nbuckets + 1> offsets;
+  for(; d < digits.size() and n > 32; ++d) {
+    offsets.fill(0);
+    for(size_t i = 0; i < n; ++i) ++offsets[digits[d](key(src[i])) + 1];
+    if(*std::max_element(offsets.begin(), offsets.end()) != n) break;
+  }
+
+  if(d == digits.size() or n <= 32) {
+    if(n <= 32) radix_insertion_sort(src, src + n, key);
+    if(not src_is_output) std::copy(src, src + n, dst);
+    return;
+  }
+
+  // Scatter into buckets, sort buckets with the roles of src / dst swapped
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  auto pos = offsets;
+  for(size_t i = 0; i < n; ++i) dst[pos[digits[d](key(src[i]))]++] = src[i];
+  for(size_t b = 0; b < radix_nbuckets; ++b) {
+    const size_t n_b = offsets[b + 1] - offsets[b];
+    if(n_b)
+      radix_msd_sort(dst + offsets[b], src + offsets[b], n_b, not src_is_output,
+                     digits, d + 1, key);
+  }
+}
+
+/// Digits covering the bits in which any key of data[0,n) differs
+template <typename T, typename KeyFunction>
+std::vector<radix_digit> radix_varying_digits(const T* data, size_t n,
+                                              KeyFunction& key) {
+  using key_type = std::decay_t<decltype(key(*data))>;
+  constexpr size_t nwords = radix_key_nwords<key_type>;
+
+  // Bits in which any key differs from the first one
+  std::array<uint64_t, nwords> varying = {};
+  const auto key0 = key(data[0]);
+#pragma omp parallel
+  {
+    std::array<uint64_t, nwords> varying_loc = {};
+#pragma omp for schedule(static)
+    for(size_t i = 0; i < n; ++i) {
+      const auto& key_i = key(data[i]);
+      for(size_t w = 0; w < nwords; ++w)
+        varying_loc[w] |= radix_key_word(key_i, w) ^ radix_key_word(key0, w);
+    }
+#pragma omp critical
+    for(size_t w = 0; w < nwords; ++w) varying[w] |= varying_loc[w];
+  }
+  return radix_msd_digits(varying);
+}
+
+/**
+ *  @brief Histogram of data[0,n) by digit `d`, skipping digits in which all
+ *  keys coincide. With `parallel`, the histograms are taken by all OpenMP
+ *  threads.
+ *
+ *  @returns The first splitting digit (`digits.size()` if there is none),
+ *  `offsets` holds the bucket offsets of that digit
+ */
+template <typename T, typename KeyFunction>
+size_t radix_split_digit(const T* data, size_t n,
+                         const std::vector<radix_digit>& digits, size_t d,
+                         KeyFunction& key,
+                         std::array<size_t, radix_nbuckets + 1>& offsets,
+                         bool parallel = false) {
+  for(; d < digits.size(); ++d) {
+    offsets.fill(0);
+    if(parallel) {
+      // Thread-local histograms
+#pragma omp parallel
+      {
+        std::array<size_t, radix_nbuckets + 1> offsets_loc = {};
+#pragma omp for schedule(static)
+        for(size_t i = 0; i < n; ++i)
+          ++offsets_loc[digits[d](key(data[i])) + 1];
+#pragma omp critical
+        for(size_t b = 0; b <= radix_nbuckets; ++b)
+          offsets[b] += offsets_loc[b];
+      }
+    } else {
+      for(size_t i = 0; i < n; ++i) ++offsets[digits[d](key(data[i])) + 1];
+    }
+    if(*std::max_element(offsets.begin(), offsets.end()) != n) break;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  return d;
+}
+
+/**
+ *  @brief Permute data into the buckets of `digit` in place (American flag
+ *  sort).
+ *
+ *  Bucket `b` spans [offsets[b], offsets[b+1]), of which [offsets[b],
+ *  head[b]) already holds elements of the bucket.
+ */
+template <typename T, typename KeyFunction>
+void radix_permute_inplace(
+    T* data, const std::array<size_t, radix_nbuckets + 1>& offsets,
+    std::array<size_t, radix_nbuckets + 1> head, radix_digit digit,
+    KeyFunction& key) {
+  for(size_t b = 0; b < radix_nbuckets; ++b) {
+    // Buckets below b are complete, misplaced elements belong above
+    while(head[b] < offsets[b + 1]) {
+      const size_t b_i = digit(key(data[head[b]]));
+      if(b_i == b)
+        ++head[b];
+      else
+        std::swap(data[head[b]], data[head[b_i]++]);
+    }
+  }
+}
+
+/// Permute data into the buckets of `digit` in place (American flag sort)
+template <typename T, typename KeyFunction>
+void radix_permute_inplace(
+    T* data, const std::array<size_t, radix_nbuckets + 1>& offsets,
+    radix_digit digit, KeyFunction& key) {
+  radix_permute_inplace(data, offsets, offsets, digit, key);
+}
+
+/**
+ *  @brief Permute data into the buckets of `digit` in place with all OpenMP
+ *  threads.
+ *
+ *  Speculative permutation and repair (PARADIS): the unplaced part of each
+ *  bucket is divided into one block per thread, each thread permutes
+ *  elements between its own blocks (American flag sort) and leaves an
+ *  element in place once the block of its bucket is full. The repair moves
+ *  these misplaced elements to the end of each bucket, where they are
+ *  permuted in the next round. Each round leaves fewer misplaced elements,
+ *  the last ones are permuted serially.
+ */
+template <typename T, typename KeyFunction>
+void radix_permute_inplace_parallel(
+    T* data, const std::array<size_t, radix_nbuckets + 1>& offsets,
+    radix_digit digit, KeyFunction& key) {
+#ifdef _OPENMP
+  const size_t max_threads = omp_get_max_threads();
+#else
+  const size_t max_threads = 1;
+#endif
+  const size_t n = offsets[radix_nbuckets] - offsets[0];
+
+  // Bucket b holds its elements in [offsets[b], head[b])
+  auto head = offsets;
+  for(size_t round = 0; round < 8; ++round) {
+    size_t nunplaced = 0;
+    for(size_t b = 0; b < radix_nbuckets; ++b)
+      nunplaced += offsets[b + 1] - head[b];
+    if(nunplaced * max_threads <= n) break;
+
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+      const size_t nthreads = omp_get_num_threads();
+      const size_t ithread = omp_get_thread_num();
+#else
+      const size_t nthreads = 1;
+      const size_t ithread = 0;
+#endif
+      // Speculative permutation within the blocks [pos[b], end[b])
+      std::array<size_t, radix_nbuckets> pos, end;
+      for(size_t b = 0; b < radix_nbuckets; ++b) {
+        const size_t n_b = offsets[b + 1] - head[b];
+        pos[b] = head[b] + ithread * n_b / nthreads;
+        end[b] = head[b] + (ithread + 1) * n_b / nthreads;
+      }
+      for(size_t b = 0; b < radix_nbuckets; ++b)
+        while(pos[b] < end[b]) {
+          T x = std::move(data[pos[b]]);
+          size_t b_x = digit(key(x));
+          while(b_x != b and pos[b_x] < end[b_x]) {
+            std::swap(x, data[pos[b_x]++]);
+            b_x = digit(key(x));
+          }
+          data[pos[b]++] = std::move(x);
+        }
+#pragma omp barrier
+
+      // Repair: move the misplaced elements to the end of each bucket
+#pragma omp for schedule(dynamic)
+      for(size_t b = 0; b < radix_nbuckets; ++b) {
+        auto* part = std::partition(
+            data + head[b], data + offsets[b + 1],
+            [&](const T& x) { return digit(key(x)) == b; });
+        head[b] = part - data;
+      }
+    }
+  }
+
+  radix_permute_inplace(data, offsets, head, digit, key);
+}
+
+/// Serial in-place MSD radix sort of data[0,n) from digit `d` on
+template <typename T, typename KeyFunction>
+void radix_msd_sort_inplace(T* data, size_t n,
+                            const std::vector<radix_digit>& digits, size_t d,
+                            KeyFunction& key) {
+  if(n <= 32) {
+    radix_insertion_sort(data, data + n, key);
+    return;
+  }
+
+  std::array<size_t, radix_nbuckets + 1> offsets;
+  d = radix_split_digit(data, n, digits, d, key, offsets);
+  if(d == digits.size()) return;
+
+  radix_permute_inplace(data, offsets, digits[d], key);
+  for(size_t b = 0; b < radix_nbuckets; ++b) {
+    const size_t n_b = offsets[b + 1] - offsets[b];
+    if(n_b > 1)
+      radix_msd_sort_inplace(data + offsets[b], n_b, digits, d + 1, key);
+  }
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Parallel radix sort by unsigned integer / bitstring keys.
+ *
+ *  Sorts [`begin`, `end`) in increasing order of `key(x)`, where keys are
+ *  compared as unsigned integers stored in 64-bit words, least significant
+ *  word first. This is the order of `bitset_less` for std::bitset keys and of
+ *  the usual order for unsigned integer keys. The sort is stable.
+ *
+ *  MSD radix sort with 8-bit digits: buckets which are large compared to the
+ *  share of a thread are split by passes over all OpenMP threads (per-thread
+ *  histograms and scatter), the remaining buckets are sorted concurrently by
+ *  a serial MSD radix sort. Only bits in which the keys differ are
+ *  considered and digits which do not split a bucket are skipped, such that
+ *  wide (e.g. 256-bit) keys with few varying bits cost little more than
+ *  narrow ones. Requires a buffer of the size of the range, small ranges fall
+ *  back to a (stable) comparison sort.
+ *
+ *  @param[in,out] begin Start of the (contiguous) range to sort
+ *  @param[in,out] end   End of the range to sort
+ *  @param[in]     key   Functor returning the key of an element
+ */
+template <typename RandomIt, typename KeyFunction>
+void radix_sort(RandomIt begin, RandomIt end, KeyFunction key) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  constexpr size_t nbuckets = detail::radix_nbuckets;
+
+  const size_t n = std::distance(begin, end);
+  if(n < 4096) {
+    std::stable_sort(begin, end, [&](const auto& x, const auto& y) {
+      return detail::radix_key_less(key(x), key(y));
+    });
+    return;
+  }
+
+  const auto digits = detail::radix_varying_digits(&*begin, n, key);
+  if(digits.empty()) return;
+
+  value_type* data = &*begin;
+  std::vector<value_type> buffer(n);
+
+  // Sub-range [lo, hi) which has been sorted up to digit d, stored in the
+  // range (in_data) or the buffer
+  struct bucket {
+    size_t lo, hi, d;
+    bool in_data;
+  };
+#ifdef _OPENMP
+  const size_t max_threads = omp_get_max_threads();
+#else
+  const size_t max_threads = 1;
+#endif
+  const size_t par_cutoff = std::max<size_t>(n / (4 * max_threads), 4096);
+  std::vector<bucket> large = {{0, n, 0, true}}, small;
+
+  // Split large buckets with all threads
+  std::vector<size_t> counts;
+  std::array<size_t, nbuckets + 1> offsets;
+  while(large.size()) {
+    auto [lo, hi, d, in_data] = large.back();
+    large.pop_back();
+    if(d == digits.size()) {
+      small.push_back({lo, hi, d, in_data});
+      continue;
+    }
+
+    value_type* src = in_data ? data : buffer.data();
+    value_type* dst = in_data ? buffer.data() : data;
+    const auto digit = digits[d];
+    bool split = true;
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+      const size_t nthreads = omp_get_num_threads();
+      const size_t ithread = omp_get_thread_num();
+#else
+      const size_t nthreads = 1;
+      const size_t ithread = 0;
+#endif
+#pragma omp single
+      counts.assign(nbuckets * nthreads, 0);
+
+      // Thread-local histograms
+      const size_t i_st = lo + ithread * (hi - lo) / nthreads;
+      const size_t i_en = lo + (ithread + 1) * (hi - lo) / nthreads;
+      std::array<size_t, nbuckets> pos = {};
+      for(size_t i = i_st; i < i_en; ++i) ++pos[digit(key(src[i]))];
+      for(size_t b = 0; b < nbuckets; ++b)
+        counts[b * nthreads + ithread] = pos[b];
+#pragma omp barrier
+
+      // Bucket major, thread minor offsets keep the sort stable
+#pragma omp single
+      {
+        size_t offset = lo;
+        for(size_t b = 0; b < nbuckets; ++b) {
+          offsets[b] = offset;
+          for(size_t t = 0; t < nthreads; ++t) {
+            const auto count = counts[b * nthreads + t];
+            counts[b * nthreads + t] = offset;
+            offset += count;
+          }
+          if(offset - offsets[b] == hi - lo) split = false;
+        }
+        offsets[nbuckets] = offset;
+      }
+
+      if(split) {
+        for(size_t b = 0; b < nbuckets; ++b)
+          pos[b] = counts[b * nthreads + ithread];
+        for(size_t i = i_st; i < i_en; ++i)
+          dst[pos[digit(key(src[i]))]++] = src[i];
+      }
+    }
+
+    if(not split) {
+      // All keys of the bucket share the digit
+      large.push_back({lo, hi, d + 1, in_data});
+      continue;
+    }
+    for(size_t b = 0; b < nbuckets; ++b) {
+      const size_t n_b = offsets[b + 1] - offsets[b];
+      if(!n_b) continue;
+      bucket sub{offsets[b], offsets[b + 1], d + 1, not in_data};
+      (n_b > par_cutoff ? large : small).push_back(sub);
+    }
+  }
+
+  // Sort the remaining buckets concurrently, largest first
+  std::sort(small.begin(), small.end(), [](const auto& x, const auto& y) {
+    return x.hi - x.lo > y.hi - y.lo;
+  });
+#pragma omp parallel for schedule(dynamic)
+  for(size_t i = 0; i < small.size(); ++i) {
+    auto [lo, hi, d, in_data] = small[i];
+    value_type* src = in_data ? data : buffer.data();
+    value_type* dst = in_data ? buffer.data() : data;
+    detail::radix_msd_sort(src + lo, dst + lo, hi - lo, in_data, digits, d,
+                           key);
+  }
+}
+
+/**
+ *  @brief Parallel in-place radix sort by unsigned integer / bitstring keys.
+ *
+ *  Sorts [`begin`, `end`) in the same order as `radix_sort`, but permutes
+ *  the elements in place (American flag sort) instead of scattering into a
+ *  buffer of the size of the range, which halves the peak memory of sorting
+ *  large ranges. The sort is not stable. Buckets which are large compared to
+ *  the share of a thread are split one at a time by all OpenMP threads
+ *  (per-thread histograms and a block-wise in-place permutation, see
+ *  `detail::radix_permute_inplace_parallel`), the remaining buckets are
+ *  sorted concurrently.
+ *
+ *  @param[in,out] begin Start of the (contiguous) range to sort
+ *  @param[in,out] end   End of the range to sort
+ *  @param[in]     key   Functor returning the key of an element
+ */
+template <typename RandomIt, typename KeyFunction>
+void radix_sort_inplace(RandomIt begin, RandomIt end, KeyFunction key) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+  const size_t n = std::distance(begin, end);
+  if(n < 4096) {
+    std::sort(begin, end, [&](const auto& x, const auto& y) {
+      return detail::radix_key_less(key(x), key(y));
+    });
+    return;
+  }
+
+  const auto digits = detail::radix_varying_digits(&*begin, n, key);
+  if(digits.empty()) return;
+
+  value_type* data = &*begin;
+  struct bucket {
+    size_t lo, hi, d;
+  };
+#ifdef _OPENMP
+  const size_t max_threads = omp_get_max_threads();
+#else
+  const size_t max_threads = 1;
+#endif
+  const size_t par_cutoff = std::max<size_t>(n / (4 * max_threads), 4096);
+  std::vector<bucket> large = {{0, n, 0}}, small;
+
+  // Split large buckets with all threads
+  std::array<size_t, detail::radix_nbuckets + 1> offsets;
+  while(large.size()) {
+    const auto [lo, hi, d_st] = large.back();
+    large.pop_back();
+    const size_t d = detail::radix_split_digit(data + lo, hi - lo, digits, d_st,
+                                               key, offsets, true);
+    if(d == digits.size()) continue;  // All keys are equal
+
+    detail::radix_permute_inplace_parallel(data + lo, offsets, digits[d], key);
+    for(size_t b = 0; b < detail::radix_nbuckets; ++b) {
+      const size_t n_b = offsets[b + 1] - offsets[b];
+      if(n_b < 2) continue;
+      bucket sub{lo + offsets[b], lo + offsets[b + 1], d + 1};
+      (n_b > par_cutoff ? large : small).push_back(sub);
+    }
+  }
+
+  // Sort the remaining buckets concurrently, largest first
+  std::sort(small.begin(), small.end(), [](const auto& x, const auto& y) {
+    return x.hi - x.lo > y.hi - y.lo;
+  });
+#pragma omp parallel for schedule(dynamic)
+  for(size_t i = 0; i < small.size(); ++i) {
+    auto [lo, hi, d] = small[i];
+    detail::radix_msd_sort_inplace(data + lo, hi - lo, digits, d, key);
+  }
+}
+
+/// Parallel radix sort of bitstrings in `bitset_less` order
+template <typename RandomIt>
+void radix_sort(RandomIt begin, RandomIt end) {
+  radix_sort(begin, end, [](const auto& x) -> const auto& { return x; });
+}
+
+}  // namespace macis
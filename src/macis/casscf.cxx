@@ -7,6 +7,7 @@
  */
 
 #include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/sorted_double_loop.hpp>
 #include <macis/util/cas.hpp>
 #include <macis/util/mcscf.hpp>
 #include <macis/util/mcscf_impl.hpp>
@@ -19,12 +20,21 @@ double casscf_diis(MCSCFSettings settings, NumElectron nalpha,
                    size_t LDT, double* V, size_t LDV, double* A1RDM,
                    size_t LDD1, double* A2RDM,
                    size_t LDD2 MACIS_MPI_CODE(, MPI_Comm comm)) {
-  using generator_t = DoubleLoopHamiltonianGenerator<64>;
-  using functor_t = CASRDMFunctor<generator_t>;
-  functor_t op;
-  return mcscf_impl<functor_t>(op, settings, nalpha, nbeta, norb, ninact, nact,
-                               nvirt, E_core, T, LDT, V, LDV, A1RDM, LDD1,
-                               A2RDM, LDD2 MACIS_MPI_CODE(, comm));
+  if(settings.ci_sorted_ham_gen) {
+    using generator_t = SortedDoubleLoopHamiltonianGenerator<64>;
+    using functor_t = CASRDMFunctor<generator_t>;
+    functor_t op;
+    return mcscf_impl<functor_t>(op, settings, nalpha, nbeta, norb, ninact,
+                                 nact, nvirt, E_core, T, LDT, V, LDV, A1RDM,
+                                 LDD1, A2RDM, LDD2 MACIS_MPI_CODE(, comm));
+  } else {
+    using generator_t = DoubleLoopHamiltonianGenerator<64>;
+    using functor_t = CASRDMFunctor<generator_t>;
+    functor_t op;
+    return mcscf_impl<functor_t>(op, settings, nalpha, nbeta, norb, ninact,
+                                 nact, nvirt, E_core, T, LDT, V, LDV, A1RDM,
+                                 LDD1, A2RDM, LDD2 MACIS_MPI_CODE(, comm));
+  }
 }
 
 }  // namespace macis
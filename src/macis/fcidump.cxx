@@ -9,6 +9,8 @@
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -62,6 +64,57 @@ auto fcidump_line(const std::vector<std::string>& tokens) {
   return std::make_tuple(p, q, r, s, integral);
 }
 
+/**
+ *  @brief Read the &FCI namelist header of a FCIDUMP file.
+ *
+ *  On exit, `file` is positioned at the first integral line, i.e. after the
+ *  header if present and at the beginning of the file otherwise.
+ *
+ *  @returns The (upper case) contents of the header, empty if not present
+ */
+std::string fcidump_header(std::istream& file) {
+  auto upper = [](std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    return str;
+  };
+
+  std::string line;
+  std::getline(file, line);
+  line = upper(line);
+  auto pos = line.find("&FCI");
+  if(pos == std::string::npos) {
+    file.clear();
+    file.seekg(0);
+    return "";
+  }
+
+  // The namelist may span multiple lines and is terminated by &END or /
+  std::string header;
+  line = line.substr(pos + 4);
+  do {
+    line = upper(line);
+    auto end = std::min({line.find("&END"), line.find("$END"), line.find('/')});
+    header += " " + line.substr(0, end);
+    if(end != std::string::npos) break;
+  } while(std::getline(file, line));
+
+  return header;
+}
+
+/// Integer list assigned to `key` in a FCIDUMP header (empty if not present)
+std::vector<int> fcidump_header_ints(const std::string& header,
+                                     const std::string& key) {
+  std::smatch match;
+  std::regex key_regex("(^|[^A-Z])" + key + "\\s*=\\s*([-0-9,\\s]*)");
+  if(!std::regex_search(header, match, key_regex)) return {};
+
+  std::vector<int> values;
+  for(auto& token : split(match[2].str(), "[,\\s]+"))
+    values.emplace_back(std::stoi(token));
+  return values;
+}
+
 enum LineClassification { Core, OneBody, TwoBody };
 
 LineClassification line_classification(int p, int q, int r, int s) {
@@ -77,6 +130,7 @@ namespace macis {
 
 uint32_t read_fcidump_norb(std::string fname) {
   std::ifstream file(fname);
+  fcidump_header(file);
   std::string line;
   int32_t max_idx = 0;
   while(std::getline(file, line)) {
@@ -93,6 +147,7 @@ uint32_t read_fcidump_norb(std::string fname) {
 
 double read_fcidump_core(std::string fname) {
   std::ifstream file(fname);
+  fcidump_header(file);
   std::string line;
   while(std::getline(file, line)) {
     auto tokens = split(line, " ");
@@ -107,6 +162,29 @@ double read_fcidump_core(std::string fname) {
   return 0.0;
 }
 
+std::vector<uint32_t> read_fcidump_orbsym(std::string fname) {
+  std::ifstream file(fname);
+  auto orbsym = fcidump_header_ints(fcidump_header(file), "ORBSYM");
+  if(std::any_of(orbsym.begin(), orbsym.end(),
+                 [](auto s) { return s < 1 or s > 8; }))
+    throw std::runtime_error("Invalid ORBSYM in FCIDUMP");
+
+  // Convert to 0-based labels (direct product == XOR)
+  std::vector<uint32_t> irreps(orbsym.size());
+  std::transform(orbsym.begin(), orbsym.end(), irreps.begin(),
+                 [](auto s) { return s - 1; });
+  return irreps;
+}
+
+uint32_t read_fcidump_isym(std::string fname) {
+  std::ifstream file(fname);
+  auto isym = fcidump_header_ints(fcidump_header(file), "ISYM");
+  if(isym.empty()) return 0;
+  if(isym.size() != 1 or isym[0] < 1 or isym[0] > 8)
+    throw std::runtime_error("Invalid ISYM in FCIDUMP");
+  return isym[0] - 1;
+}
+
 void read_fcidump_1body(std::string fname, col_major_span<double, 2> T) {
   if(T.extent(0) != T.extent(1)) throw std::runtime_error("T must be square");
 
@@ -115,6 +193,7 @@ void read_fcidump_1body(std::string fname, col_major_span<double, 2> T) {
     throw std::runtime_error("T is of improper dimension");
 
   std::ifstream file(fname);
+  fcidump_header(file);
   std::string line;
   while(std::getline(file, line)) {
     auto tokens = split(line, " ");
@@ -148,6 +227,7 @@ void read_fcidump_2body(std::string fname, col_major_span<double, 4> V) {
     throw std::runtime_error("V is of improper dimension");
 
   std::ifstream file(fname);
+  fcidump_header(file);
   std::string line;
   while(std::getline(file, line)) {
     auto tokens = split(line, " ");
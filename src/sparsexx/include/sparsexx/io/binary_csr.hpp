@@ -0,0 +1,389 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sparsexx/matrix_types/mapped_csr_matrix.hpp>
+#include <sparsexx/matrix_types/type_traits.hpp>
+#include <sparsexx/sparsexx_config.hpp>
+#include <sparsexx/util/mapped_file.hpp>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#ifdef SPARSEXX_ENABLE_MPI
+#include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
+#endif
+
+// Binary CSR format
+//
+// A CSR block consists of a binary_csr_header followed by the rowptr (m+1),
+// colind (nnz) and nzval (nnz) arrays. The header and each array start at
+// a multiple of binary_csr_alignment bytes from the beginning of the file,
+// such that the arrays may be used in place once the file is mapped into
+// memory (see mapped_csr_matrix). The header records a user supplied key
+// (e.g. a hash of the data the matrix was generated from) which is checked
+// on load to reject stale files. Files are written to "<fname>.tmp" and
+// renamed once complete, and files which are truncated or fail the
+// consistency checks on load are treated as missing.
+//
+// A distributed matrix is stored as one file per rank, "<prefix>.<rank>",
+// each containing a binary_dist_csr_header, the row extents of all ranks
+// and the diagonal and off-diagonal tiles of the rank as CSR blocks.
+
+namespace sparsexx {
+
+namespace detail {
+
+inline constexpr size_t binary_csr_alignment = 64;
+inline constexpr uint64_t binary_csr_magic = 0x3152534358585053;  // SPXXCSR1
+inline constexpr uint64_t binary_dist_csr_magic = 0x3152534458585053;
+
+struct binary_csr_header {
+  uint64_t magic;
+  uint32_t value_size;
+  uint32_t index_size;
+  int64_t m;
+  int64_t n;
+  int64_t nnz;
+  int64_t indexing;
+  uint64_t key;
+};
+
+struct binary_dist_csr_header {
+  uint64_t magic;
+  int64_t comm_size;
+  int64_t comm_rank;
+  int64_t m;
+  int64_t n;
+  int64_t has_off_diagonal;
+  uint64_t key;
+};
+
+inline size_t binary_csr_align(size_t offset) {
+  return (offset + binary_csr_alignment - 1) / binary_csr_alignment *
+         binary_csr_alignment;
+}
+
+/// Write `n` bytes at the next aligned offset of `f`
+inline void binary_csr_write_aligned(std::ofstream& f, const void* data,
+                                     size_t n) {
+  if(!f) return;
+  const size_t pos = f.tellp();
+  const char zeros[binary_csr_alignment] = {};
+  f.write(zeros, binary_csr_align(pos) - pos);
+  f.write(static_cast<const char*>(data), n);
+}
+
+template <typename SpMatType>
+void write_binary_csr_block(std::ofstream& f, const SpMatType& A,
+                            uint64_t key) {
+  using index_t = detail::index_type_t<SpMatType>;
+  using value_t = detail::value_type_t<SpMatType>;
+
+  binary_csr_header header{binary_csr_magic, sizeof(value_t), sizeof(index_t),
+                           A.m(), A.n(), A.nnz(), A.indexing(), key};
+  binary_csr_write_aligned(f, &header, sizeof(header));
+  binary_csr_write_aligned(f, A.rowptr().data(),
+                           (A.m() + 1) * sizeof(index_t));
+  binary_csr_write_aligned(f, A.colind().data(), A.nnz() * sizeof(index_t));
+  binary_csr_write_aligned(f, A.nzval().data(), A.nnz() * sizeof(value_t));
+}
+
+/// Bounds checked pointer to `n` bytes at the next aligned offset, null if
+/// the file is truncated
+inline const char* binary_csr_map_aligned(const mapped_file& file,
+                                          size_t& offset, size_t n) {
+  offset = binary_csr_align(offset);
+  if(offset > file.size() or n > file.size() - offset) return nullptr;
+  const char* ptr = file.data() + offset;
+  offset += n;
+  return ptr;
+}
+
+/**
+ *  @brief Map a CSR block of a binary CSR file.
+ *
+ *  @returns The mapped matrix, empty if the block was written for a
+ *  different key or with different value / index types, or if it is
+ *  truncated or inconsistent
+ */
+template <typename T, typename index_t>
+std::optional<mapped_csr_matrix<T, index_t> > map_binary_csr_block(
+    std::shared_ptr<const mapped_file> file, size_t& offset, uint64_t key) {
+  const auto* header_ptr =
+      binary_csr_map_aligned(*file, offset, sizeof(binary_csr_header));
+  if(not header_ptr) return std::nullopt;
+  binary_csr_header header;
+  std::memcpy(&header, header_ptr, sizeof(header));
+  if(header.magic != binary_csr_magic or header.key != key or
+     header.value_size != sizeof(T) or header.index_size != sizeof(index_t))
+    return std::nullopt;
+
+  // Sizes must fit in the file before they are used in offset arithmetic
+  const auto m = header.m, nnz = header.nnz;
+  const int64_t fsize = file->size();
+  if(m < 0 or nnz < 0 or m >= fsize or nnz > fsize) return std::nullopt;
+
+  const auto* rowptr = reinterpret_cast<const index_t*>(
+      binary_csr_map_aligned(*file, offset, (m + 1) * sizeof(index_t)));
+  const auto* colind = reinterpret_cast<const index_t*>(
+      binary_csr_map_aligned(*file, offset, nnz * sizeof(index_t)));
+  const auto* nzval = reinterpret_cast<const T*>(
+      binary_csr_map_aligned(*file, offset, nnz * sizeof(T)));
+  if(not rowptr or not colind or not nzval) return std::nullopt;
+
+  // Row pointers must stay within the non-zeros
+  if(rowptr[0] != header.indexing or rowptr[m] - header.indexing != nnz)
+    return std::nullopt;
+  for(int64_t i = 0; i < m; ++i)
+    if(rowptr[i + 1] < rowptr[i]) return std::nullopt;
+
+  return mapped_csr_matrix<T, index_t>(std::move(file), m, header.n, nnz,
+                                       header.indexing, rowptr, colind, nzval);
+}
+
+inline bool file_exists(const std::string& fname) {
+  struct stat st;
+  return ::stat(fname.c_str(), &st) == 0;
+}
+
+/// Map a binary CSR file into memory, null if it does not exist or could
+/// not be mapped
+inline std::shared_ptr<const mapped_file> map_binary_csr_file(
+    const std::string& fname) {
+  if(not file_exists(fname)) return nullptr;
+  try {
+    return std::make_shared<const mapped_file>(fname);
+  } catch(const std::runtime_error&) {
+    return nullptr;
+  }
+}
+
+/**
+ *  @brief Write a binary CSR file through a temporary file.
+ *
+ *  The contents are written by `write(f)` to "<fname>.tmp", which is removed
+ *  if any write fails.
+ *
+ *  @returns Whether the temporary file was written successfully, in which
+ *  case it must be moved into place with commit_binary_csr_file
+ */
+template <typename Func>
+bool write_binary_csr_file(const std::string& fname, Func&& write) {
+  const auto tmp_fname = fname + ".tmp";
+  bool success;
+  {
+    std::ofstream f(tmp_fname, std::ios::binary);
+    if(f) write(f);
+    f.close();
+    success = not f.fail();
+  }
+  if(not success) std::remove(tmp_fname.c_str());
+  return success;
+}
+
+/// Move "<fname>.tmp" to `fname`
+inline bool commit_binary_csr_file(const std::string& fname) {
+  return std::rename((fname + ".tmp").c_str(), fname.c_str()) == 0;
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Write a CSR matrix to a binary CSR file.
+ *
+ *  The file is replaced only once it has been written completely, throws if
+ *  it could not be written.
+ *
+ *  @param[in] A     Matrix to write
+ *  @param[in] fname Name of the file
+ *  @param[in] key   Key which must be matched on load
+ */
+template <typename SpMatType>
+detail::enable_if_csr_arrays_t<SpMatType> write_binary_csr(const SpMatType& A,
+                                                           std::string fname,
+                                                           uint64_t key = 0) {
+  const bool success = detail::write_binary_csr_file(
+      fname, [&](auto& f) { detail::write_binary_csr_block(f, A, key); });
+  if(not success or not detail::commit_binary_csr_file(fname))
+    throw std::runtime_error("Could Not Write " + fname);
+}
+
+/**
+ *  @brief Map a binary CSR file written by write_binary_csr into memory.
+ *
+ *  @param[in] fname Name of the file
+ *  @param[in] key   Key the file must have been written with
+ *
+ *  @returns The mapped matrix, empty if the file does not exist, was
+ *  written for a different key or with different value / index types, or is
+ *  truncated or corrupt
+ */
+template <typename T, typename index_t>
+std::optional<mapped_csr_matrix<T, index_t> > read_mapped_binary_csr(
+    std::string fname, uint64_t key = 0) {
+  auto file = detail::map_binary_csr_file(fname);
+  if(not file) return std::nullopt;
+  size_t offset = 0;
+  return detail::map_binary_csr_block<T, index_t>(file, offset, key);
+}
+
+#ifdef SPARSEXX_ENABLE_MPI
+
+/**
+ *  @brief Write a distributed CSR matrix to binary CSR files.
+ *
+ *  Collective, every rank writes its tiles to "<prefix>.<rank>". The files
+ *  are replaced only once every rank has written its file completely, throws
+ *  (on all ranks) if any file could not be written.
+ *
+ *  @param[in] A      Matrix to write
+ *  @param[in] prefix Prefix of the file names
+ *  @param[in] key    Key which must be matched on load
+ */
+template <typename SpMatType>
+detail::enable_if_csr_arrays_t<SpMatType> write_binary_dist_csr(
+    const dist_sparse_matrix<SpMatType>& A, std::string prefix,
+    uint64_t key = 0) {
+  const auto comm_size = detail::get_mpi_size(A.comm());
+  const auto comm_rank = detail::get_mpi_rank(A.comm());
+  const auto fname = prefix + "." + std::to_string(comm_rank);
+
+  const bool has_off_diagonal = bool(A.off_diagonal_tile_ptr());
+  detail::binary_dist_csr_header header{detail::binary_dist_csr_magic,
+                                        comm_size,
+                                        comm_rank,
+                                        int64_t(A.m()),
+                                        int64_t(A.n()),
+                                        has_off_diagonal,
+                                        key};
+  std::vector<int64_t> extents;
+  for(int i = 0; i < comm_size; ++i) {
+    auto [row_st, row_en] = A.row_bounds(i);
+    extents.push_back(row_st);
+    extents.push_back(row_en);
+  }
+  bool success = detail::write_binary_csr_file(fname, [&](auto& f) {
+    detail::binary_csr_write_aligned(f, &header, sizeof(header));
+    detail::binary_csr_write_aligned(f, extents.data(),
+                                     extents.size() * sizeof(int64_t));
+
+    detail::write_binary_csr_block(f, A.diagonal_tile(), key);
+    if(has_off_diagonal)
+      detail::write_binary_csr_block(f, A.off_diagonal_tile(), key);
+  });
+
+  // Only replace the files once all ranks have written theirs
+  success = detail::mpi_allreduce<int>(success, MPI_MIN, A.comm());
+  if(success) success = detail::commit_binary_csr_file(fname);
+  else std::remove((fname + ".tmp").c_str());
+  if(not detail::mpi_allreduce<int>(success, MPI_MIN, A.comm()))
+    throw std::runtime_error("Could Not Write " + prefix);
+}
+
+/**
+ *  @brief Map a distributed CSR matrix written by write_binary_dist_csr
+ *  into memory.
+ *
+ *  Collective, the files must have been written from a communicator of the
+ *  same size.
+ *
+ *  @param[in] comm   Communicator over which the matrix is distributed
+ *  @param[in] prefix Prefix of the file names
+ *  @param[in] key    Key the files must have been written with
+ *
+ *  @returns The mapped matrix, empty if any rank's file does not exist,
+ *  does not match the key, value / index types or communicator size, or is
+ *  truncated or corrupt
+ */
+template <typename T, typename index_t>
+std::optional<dist_sparse_matrix<mapped_csr_matrix<T, index_t> > >
+read_mapped_binary_dist_csr(MPI_Comm comm, std::string prefix,
+                            uint64_t key = 0) {
+  using tile_type = mapped_csr_matrix<T, index_t>;
+  using extent_type = typename dist_sparse_matrix<tile_type>::extent_type;
+  const auto comm_size = detail::get_mpi_size(comm);
+  const auto comm_rank = detail::get_mpi_rank(comm);
+  const auto fname = prefix + "." + std::to_string(comm_rank);
+
+  detail::binary_dist_csr_header header{};
+  std::vector<int64_t> extents(2 * comm_size);
+  std::vector<extent_type> row_extents;
+  std::optional<tile_type> diagonal_tile, off_diagonal_tile;
+
+  // The local file is checked without throwing, such that all ranks reach
+  // the agreement on its validity below
+  auto file = detail::map_binary_csr_file(fname);
+  bool valid = bool(file);
+
+  size_t offset = 0;
+  const char* header_ptr = nullptr;
+  if(valid) {
+    header_ptr = detail::binary_csr_map_aligned(*file, offset, sizeof(header));
+    valid = header_ptr;
+  }
+  if(valid) {
+    std::memcpy(&header, header_ptr, sizeof(header));
+    valid = header.magic == detail::binary_dist_csr_magic and
+            header.key == key and header.comm_size == comm_size and
+            header.comm_rank == comm_rank;
+  }
+  if(valid) {
+    const auto* extents_ptr = detail::binary_csr_map_aligned(
+        *file, offset, 2 * comm_size * sizeof(int64_t));
+    valid = extents_ptr;
+    if(valid) {
+      std::memcpy(extents.data(), extents_ptr,
+                  extents.size() * sizeof(int64_t));
+      for(int i = 0; i < comm_size; ++i)
+        row_extents.emplace_back(extents[2 * i], extents[2 * i + 1]);
+
+      // Row extents must be contiguous and cover the matrix
+      valid = extents.front() == 0 and extents.back() == header.m;
+      for(int i = 0; i < comm_size - 1; ++i)
+        valid = valid and extents[2 * i + 1] == extents[2 * i + 2];
+    }
+    if(valid) {
+      const auto [row_st, row_en] = row_extents[comm_rank];
+      diagonal_tile =
+          detail::map_binary_csr_block<T, index_t>(file, offset, key);
+      valid = diagonal_tile and diagonal_tile->m() == row_en - row_st;
+      if(valid and header.has_off_diagonal) {
+        off_diagonal_tile =
+            detail::map_binary_csr_block<T, index_t>(file, offset, key);
+        valid = off_diagonal_tile.has_value();
+      }
+    }
+  }
+
+  // All ranks must agree on the validity of the cache and on the row
+  // extents of the files
+  if(not detail::mpi_allreduce<int>(valid, MPI_MIN, comm)) return std::nullopt;
+  auto root_extents = extents;
+  detail::mpi_bcast(root_extents, 0, comm);
+  valid = root_extents == extents;
+  if(not detail::mpi_allreduce<int>(valid, MPI_MIN, comm)) return std::nullopt;
+
+  std::optional<dist_sparse_matrix<tile_type> > A;
+  A.emplace(comm, header.m, header.n, row_extents);
+  A->set_diagonal_tile(std::move(*diagonal_tile));
+  if(off_diagonal_tile) A->set_off_diagonal_tile(std::move(*off_diagonal_tile));
+  return A;
+}
+
+#endif
+
+}  // namespace sparsexx
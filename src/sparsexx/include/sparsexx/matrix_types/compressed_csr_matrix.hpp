@@ -0,0 +1,283 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "csr_matrix.hpp"
+#include "type_fwd.hpp"
+
+namespace sparsexx {
+
+namespace detail {
+
+/**
+ *  @brief Decode the delta-encoded column indices of a single row.
+ *
+ *  @tparam CodeType Unsigned integer type of the deltas
+ *
+ *  @param[in] nnz_row Number of non-zeros in the row
+ *  @param[in] col     First column index of the row
+ *  @param[in] p       Start of the encoded deltas of the row
+ *  @param[in] f       Callback invoked as f(j, col) for the j-th non-zero
+ */
+template <typename CodeType, typename index_t, typename Func>
+inline void decode_compressed_row(int64_t nnz_row, index_t col,
+                                  const uint8_t* p, Func&& f) {
+  constexpr auto escape = std::numeric_limits<CodeType>::max();
+  if(nnz_row) f(int64_t(0), col);
+  for(int64_t j = 1; j < nnz_row; ++j) {
+    CodeType d;
+    std::memcpy(&d, p, sizeof(CodeType));
+    p += sizeof(CodeType);
+    if(d == escape) {
+      std::memcpy(&col, p, sizeof(index_t));
+      p += sizeof(index_t);
+    } else {
+      col += d;
+    }
+    f(j, col);
+  }
+}
+
+}  // namespace detail
+
+/**
+ *  @brief A class to manipulate sparse matrices stored in CSR format with
+ *  delta-encoded column indices.
+ *
+ *  The column indices of each row are stored as the first column index of
+ *  the row (base) followed by the differences of consecutive column indices
+ *  encoded in 8 or 16 bits. The width is selected per row to minimize its
+ *  storage. Differences which are not representable in the selected width
+ *  are stored as an escape code (all bits set) followed by the full column
+ *  index.
+ *
+ *  Column indices must be sorted and unique within each row. The matrix is
+ *  constructed from a csr_matrix, is immutable and always uses 0-based
+ *  indexing.
+ *
+ *  @tparam T       Field over which the elements of the sparse matrix are
+ * defined
+ *  @tparam index_t Integer type for the sparse indices
+ *  @tparam Alloc   Allocator type for internal storage
+ */
+template <typename T, typename index_t, typename Alloc>
+class compressed_csr_matrix {
+ public:
+  using value_type = T;  ///< Field over which the matrix elements are defined
+  using index_type = index_t;    ///< Sparse index type
+  using size_type = int64_t;     ///< Size type
+  using allocator_type = Alloc;  ///< Allocator type
+
+ protected:
+  using alloc_traits = typename std::allocator_traits<Alloc>;
+
+  template <typename U>
+  using rebind_alloc = typename alloc_traits::template rebind_alloc<U>;
+
+  template <typename U>
+  using internal_storage = typename std::vector<U, rebind_alloc<U> >;
+
+  size_type m_ = 0;    ///< Number of rows in the sparse matrix
+  size_type n_ = 0;    ///< Number of cols in the sparse matrix
+  size_type nnz_ = 0;  ///< Number of non-zeros in the sparse matrix
+
+  internal_storage<T> nzval_;          ///< Storage of the non-zero values
+  internal_storage<index_t> rowptr_;   ///< Offsets of each row into nzval
+  internal_storage<index_t> colbase_;  ///< First column index of each row
+  internal_storage<int64_t> deltaptr_;  ///< Byte offsets of each row
+  internal_storage<uint8_t> delta_width_;  ///< Delta width (bytes) per row
+  internal_storage<uint8_t> deltas_;       ///< Encoded column deltas
+
+  /// Number of bytes to encode a row's deltas with CodeType
+  template <typename CodeType>
+  static int64_t encoded_size_(const index_t* ci, int64_t nnz_row) {
+    constexpr auto escape = std::numeric_limits<CodeType>::max();
+    int64_t nbytes = 0;
+    for(int64_t j = 1; j < nnz_row; ++j) {
+      const auto d = int64_t(ci[j]) - int64_t(ci[j - 1]);
+      nbytes += sizeof(CodeType) + (d < escape ? 0 : sizeof(index_t));
+    }
+    return nbytes;
+  }
+
+  /// Encode a row's deltas with CodeType into p
+  template <typename CodeType>
+  static void encode_(const index_t* ci, int64_t nnz_row, index_t indexing,
+                      uint8_t* p) {
+    constexpr auto escape = std::numeric_limits<CodeType>::max();
+    for(int64_t j = 1; j < nnz_row; ++j) {
+      const auto d = int64_t(ci[j]) - int64_t(ci[j - 1]);
+      const CodeType code = d < escape ? CodeType(d) : escape;
+      std::memcpy(p, &code, sizeof(CodeType));
+      p += sizeof(CodeType);
+      if(code == escape) {
+        const index_t col = ci[j] - indexing;
+        std::memcpy(p, &col, sizeof(index_t));
+        p += sizeof(index_t);
+      }
+    }
+  }
+
+  compressed_csr_matrix(size_type m, size_type n, size_type nnz)
+      : m_(m),
+        n_(n),
+        nnz_(nnz),
+        rowptr_(m_ + 1),
+        colbase_(m_, 0),
+        deltaptr_(m_ + 1),
+        delta_width_(m_) {}
+
+  /// Delta-encode the column indices (and row pointers) of A
+  void encode_colind_(const csr_matrix<T, index_t, Alloc>& A) {
+    const auto indexing = A.indexing();
+    const auto* Arp = A.rowptr().data();
+    const auto* Aci = A.colind().data();
+
+    // Shift to 0-based indexing
+    for(size_type i = 0; i <= m_; ++i) rowptr_[i] = Arp[i] - indexing;
+
+    // Select the delta width of each row
+    bool sorted = true;
+    deltaptr_[0] = 0;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(&& : sorted)
+    for(size_type i = 0; i < m_; ++i) {
+      const auto* ci = Aci + rowptr_[i];
+      const int64_t nnz_row = rowptr_[i + 1] - rowptr_[i];
+      for(int64_t j = 1; j < nnz_row; ++j)
+        sorted = sorted and ci[j] > ci[j - 1];
+      if(nnz_row) colbase_[i] = ci[0] - indexing;
+
+      const auto nb8 = encoded_size_<uint8_t>(ci, nnz_row);
+      const auto nb16 = encoded_size_<uint16_t>(ci, nnz_row);
+      delta_width_[i] = nb8 <= nb16 ? 1 : 2;
+      deltaptr_[i + 1] = std::min(nb8, nb16);
+    }
+    if(not sorted)
+      throw std::runtime_error(
+          "Compressed CSR Requires Sorted Unique Column Indices");
+    std::partial_sum(deltaptr_.begin(), deltaptr_.end(), deltaptr_.begin());
+
+    // Encode
+    deltas_.resize(deltaptr_.back());
+#pragma omp parallel for schedule(dynamic, 1024)
+    for(size_type i = 0; i < m_; ++i) {
+      const auto* ci = Aci + rowptr_[i];
+      const int64_t nnz_row = rowptr_[i + 1] - rowptr_[i];
+      auto* p = deltas_.data() + deltaptr_[i];
+      if(delta_width_[i] == 1)
+        encode_<uint8_t>(ci, nnz_row, indexing, p);
+      else
+        encode_<uint16_t>(ci, nnz_row, indexing, p);
+    }
+  }
+
+ public:
+  compressed_csr_matrix() = default;
+
+  compressed_csr_matrix(const compressed_csr_matrix& other) = default;
+  compressed_csr_matrix(compressed_csr_matrix&& other) noexcept = default;
+
+  compressed_csr_matrix& operator=(const compressed_csr_matrix&) = default;
+  compressed_csr_matrix& operator=(compressed_csr_matrix&&) noexcept =
+      default;
+
+  /**
+   *  @brief Construct a compressed CSR matrix from a CSR matrix.
+   *
+   *  @param[in] A CSR matrix with sorted, unique column indices per row
+   */
+  compressed_csr_matrix(const csr_matrix<T, index_t, Alloc>& A)
+      : compressed_csr_matrix(A.m(), A.n(), A.nnz()) {
+    nzval_.assign(A.nzval().begin(), A.nzval().end());
+    encode_colind_(A);
+  }
+
+  /**
+   *  @brief Construct a compressed CSR matrix from a CSR matrix, taking over
+   *  its non-zero values.
+   *
+   *  The storage of `A` is released after the column indices are encoded,
+   *  such that the uncompressed and compressed indices are not kept
+   *  alongside each other beyond the conversion.
+   *
+   *  @param[in] A CSR matrix with sorted, unique column indices per row
+   */
+  compressed_csr_matrix(csr_matrix<T, index_t, Alloc>&& A)
+      : compressed_csr_matrix(A.m(), A.n(), A.nnz()) {
+    encode_colind_(A);
+    nzval_ = std::move(A.nzval());
+    A = csr_matrix<T, index_t, Alloc>();
+  }
+
+  size_type m() const { return m_; };
+  size_type n() const { return n_; };
+  size_type nnz() const { return nnz_; };
+  size_type indexing() const { return 0; }
+
+  const auto& nzval() const { return nzval_; };
+  const auto& rowptr() const { return rowptr_; };
+  const auto& colbase() const { return colbase_; };
+  const auto& deltaptr() const { return deltaptr_; };
+  const auto& delta_width() const { return delta_width_; };
+  const auto& deltas() const { return deltas_; };
+
+  /**
+   *  @brief Visit the non-zeros of a row in column order.
+   *
+   *  @param[in] i Row index
+   *  @param[in] f Callback invoked as f(col, val) for each non-zero
+   */
+  template <typename Func>
+  inline void visit_row(size_type i, Func&& f) const {
+    const auto j_st = rowptr_[i];
+    const int64_t nnz_row = rowptr_[i + 1] - j_st;
+    const auto* Anz = nzval_.data() + j_st;
+    const auto* p = deltas_.data() + deltaptr_[i];
+    auto g = [&](int64_t j, index_t col) { f(col, Anz[j]); };
+    if(delta_width_[i] == 1)
+      detail::decode_compressed_row<uint8_t>(nnz_row, colbase_[i], p, g);
+    else
+      detail::decode_compressed_row<uint16_t>(nnz_row, colbase_[i], p, g);
+  }
+
+  /// Decode all column indices (row-major, same layout as csr_matrix)
+  std::vector<index_t> decompress_colind() const {
+    std::vector<index_t> colind(nnz_);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for(size_type i = 0; i < m_; ++i) {
+      auto* ci = colind.data() + rowptr_[i];
+      visit_row(i, [&](index_t col, T) { *(ci++) = col; });
+    }
+    return colind;
+  }
+
+  /// Convert back to a (0-based) CSR matrix
+  csr_matrix<T, index_t, Alloc> decompress() const {
+    csr_matrix<T, index_t, Alloc> A(m_, n_, nnz_, 0);
+    std::copy(rowptr_.begin(), rowptr_.end(), A.rowptr().begin());
+    std::copy(nzval_.begin(), nzval_.end(), A.nzval().begin());
+    auto colind = decompress_colind();
+    std::copy(colind.begin(), colind.end(), A.colind().begin());
+    return A;
+  }
+
+  size_type mem_footprint() const noexcept {
+    return nzval_.capacity() * sizeof(T) +
+           (rowptr_.capacity() + colbase_.capacity()) * sizeof(index_t) +
+           deltaptr_.capacity() * sizeof(int64_t) + delta_width_.capacity() +
+           deltas_.capacity();
+  }
+};  // class compressed_csr_matrix
+
+}  // namespace sparsexx
@@ -72,7 +72,7 @@ class csr_matrix {
         rowptr_(m + 1) {}
 
   csr_matrix(size_type m, size_type n, std::vector<index_t>&& rowptr,
-             std::vector<index_t>&& colind, std::vector<double>&& nzval)
+             std::vector<index_t>&& colind, std::vector<T>&& nzval)
       : m_(m),
         n_(n),
         nnz_(nzval.size()),
@@ -84,12 +84,62 @@ class dist_sparse_matrix {
   }
 
   dist_sparse_matrix(const dist_sparse_matrix& other)
-      : dist_sparse_matrix(other.comm_, other.global_m_, other.global_n_) {
+      : dist_sparse_matrix(other.comm_, other.global_m_, other.global_n_,
+                           other.dist_row_extents_) {
     if(other.diagonal_tile_) set_diagonal_tile(other.diagonal_tile());
     if(other.off_diagonal_tile_)
       set_off_diagonal_tile(other.off_diagonal_tile());
   }
 
+  /**
+   *  @brief Convert the tiles of a distributed matrix to another format.
+   *
+   *  The row partitioning of `other` is preserved. The tiles are converted
+   *  through the constructor tile_type(const OtherSpMatType&).
+   */
+  template <typename OtherSpMatType,
+            typename = std::enable_if_t<
+                not std::is_same_v<OtherSpMatType, SpMatType> > >
+  explicit dist_sparse_matrix(const dist_sparse_matrix<OtherSpMatType>& other)
+      : comm_(other.comm()), global_m_(other.m()), global_n_(other.n()) {
+    comm_size_ = detail::get_mpi_size(comm_);
+    comm_rank_ = detail::get_mpi_rank(comm_);
+    dist_row_extents_.resize(comm_size_);
+    for(int i = 0; i < comm_size_; ++i)
+      dist_row_extents_[i] = other.row_bounds(i);
+
+    if(other.diagonal_tile_ptr())
+      diagonal_tile_ = std::make_shared<tile_type>(other.diagonal_tile());
+    if(other.off_diagonal_tile_ptr())
+      off_diagonal_tile_ =
+          std::make_shared<tile_type>(other.off_diagonal_tile());
+  }
+
+  /**
+   *  @brief Convert the tiles of a distributed matrix to another format,
+   *  moving from the tiles of `other`.
+   *
+   *  Same as the copying conversion, but the tiles are converted through
+   *  tile_type(OtherSpMatType&&) (if available) such that their storage can
+   *  be released as they are converted.
+   */
+  template <typename OtherSpMatType,
+            typename = std::enable_if_t<
+                not std::is_same_v<OtherSpMatType, SpMatType> > >
+  explicit dist_sparse_matrix(dist_sparse_matrix<OtherSpMatType>&& other)
+      : comm_(other.comm()), global_m_(other.m()), global_n_(other.n()) {
+    comm_size_ = detail::get_mpi_size(comm_);
+    comm_rank_ = detail::get_mpi_rank(comm_);
+    dist_row_extents_.resize(comm_size_);
+    for(int i = 0; i < comm_size_; ++i)
+      dist_row_extents_[i] = other.row_bounds(i);
+
+    if(auto A = other.diagonal_tile_ptr())
+      diagonal_tile_ = std::make_shared<tile_type>(std::move(*A));
+    if(auto A = other.off_diagonal_tile_ptr())
+      off_diagonal_tile_ = std::make_shared<tile_type>(std::move(*A));
+  }
+
   dist_sparse_matrix(MPI_Comm c, const SpMatType& A)
       : dist_sparse_matrix(c, A.m(), A.n()) {
     auto [local_row_st, local_row_en] = dist_row_extents_[comm_rank_];
@@ -0,0 +1,121 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+
+#include <memory>
+#include <sparsexx/util/mapped_file.hpp>
+#include <stdexcept>
+
+#include "type_fwd.hpp"
+
+namespace sparsexx {
+
+namespace detail {
+
+/// Non-owning view of a contiguous, immutable array
+template <typename T>
+class array_view {
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+
+ public:
+  array_view() = default;
+  array_view(const T* data, size_t size) : data_(data), size_(size) {}
+
+  inline const T* data() const { return data_; }
+  inline size_t size() const { return size_; }
+  inline const T* begin() const { return data_; }
+  inline const T* end() const { return data_ + size_; }
+  inline const T& operator[](size_t i) const { return data_[i]; }
+};
+
+}  // namespace detail
+
+/**
+ *  @brief A class to access sparse matrices stored in CSR format in a
+ *  memory mapped file.
+ *
+ *  The CSR arrays are not copied into memory, pages are loaded from the
+ *  file on demand. The matrix is immutable, copies share the underlying
+ *  mapping. See io/binary_csr.hpp for the file format.
+ *
+ *  @tparam T       Field over which the elements of the sparse matrix are
+ * defined
+ *  @tparam index_t Integer type for the sparse indices
+ */
+template <typename T, typename index_t>
+class mapped_csr_matrix {
+ public:
+  using value_type = T;  ///< Field over which the matrix elements are defined
+  using index_type = index_t;  ///< Sparse index type
+  using size_type = int64_t;   ///< Size type
+  using allocator_type = std::allocator<T>;  ///< Allocator type (unused)
+
+ protected:
+  std::shared_ptr<const mapped_file> file_;  ///< Backing file
+
+  size_type m_ = 0;         ///< Number of rows in the sparse matrix
+  size_type n_ = 0;         ///< Number of cols in the sparse matrix
+  size_type nnz_ = 0;       ///< Number of non-zeros in the sparse matrix
+  size_type indexing_ = 0;  ///< Indexing base (0 or 1)
+
+  detail::array_view<T> nzval_;         ///< Non-zero values
+  detail::array_view<index_t> colind_;  ///< Column indices
+  detail::array_view<index_t> rowptr_;  ///< Row pointer indirection array
+
+ public:
+  mapped_csr_matrix() = default;
+
+  /**
+   *  @brief Construct a CSR matrix from arrays in a mapped file.
+   *
+   *  @param[in] file     Mapping which contains the CSR arrays
+   *  @param[in] m        Number of rows in the sparse matrix
+   *  @param[in] n        Number of columns in the sparse matrix
+   *  @param[in] nnz      Number of non-zeros in the sparse matrix
+   *  @param[in] indexing Indexing base
+   *  @param[in] rowptr   Row pointer array (m+1) within `file`
+   *  @param[in] colind   Column index array (nnz) within `file`
+   *  @param[in] nzval    Non-zero value array (nnz) within `file`
+   */
+  mapped_csr_matrix(std::shared_ptr<const mapped_file> file, size_type m,
+                    size_type n, size_type nnz, size_type indexing,
+                    const index_t* rowptr, const index_t* colind,
+                    const T* nzval)
+      : file_(std::move(file)),
+        m_(m),
+        n_(n),
+        nnz_(nnz),
+        indexing_(indexing),
+        nzval_(nzval, nnz),
+        colind_(colind, nnz),
+        rowptr_(rowptr, m + 1) {}
+
+  size_type m() const { return m_; };
+  size_type n() const { return n_; };
+  size_type nnz() const { return nnz_; };
+  size_type indexing() const { return indexing_; }
+
+  const auto& nzval() const { return nzval_; };
+  const auto& colind() const { return colind_; };
+  const auto& rowptr() const { return rowptr_; };
+
+  inline void set_indexing(index_type idx) {
+    if(idx != indexing_)
+      throw std::runtime_error("Mapped CSR Matrix Is Immutable");
+  }
+
+  /// Size of the mapped CSR arrays (resident once accessed)
+  inline size_type mem_footprint() const noexcept {
+    return nnz_ * (sizeof(index_type) + sizeof(value_type)) +
+           (m_ + 1) * sizeof(index_type);
+  }
+};
+
+}  // namespace sparsexx
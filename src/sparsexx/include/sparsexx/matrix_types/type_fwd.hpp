@@ -26,4 +26,11 @@ template <typename T, typename index_t = int64_t,
           typename Alloc = std::allocator<T> >
 class coo_matrix;
 
+template <typename T, typename index_t = int64_t,
+          typename Alloc = std::allocator<T> >
+class compressed_csr_matrix;
+
+template <typename T, typename index_t = int64_t>
+class mapped_csr_matrix;
+
 }  // namespace sparsexx
@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <sparsexx/matrix_types/compressed_csr_matrix.hpp>
 #include <sparsexx/matrix_types/coo_matrix.hpp>
 #include <sparsexx/matrix_types/csr_matrix.hpp>
+#include <sparsexx/matrix_types/mapped_csr_matrix.hpp>
 #include <type_traits>
 
 namespace sparsexx::detail {
@@ -20,6 +22,10 @@ template <typename SpMatType, typename = void>
 struct is_csc_matrix : public std::false_type {};
 template <typename SpMatType, typename = void>
 struct is_coo_matrix : public std::false_type {};
+template <typename SpMatType, typename = void>
+struct is_compressed_csr_matrix : public std::false_type {};
+template <typename SpMatType, typename = void>
+struct is_mapped_csr_matrix : public std::false_type {};
 
 template <typename SpMatType>
 struct is_csr_matrix<SpMatType,
@@ -45,12 +51,38 @@ struct is_coo_matrix<SpMatType,
                                     typename SpMatType::allocator_type>,
                          SpMatType> > > : public std::true_type {};
 
+template <typename SpMatType>
+struct is_compressed_csr_matrix<
+    SpMatType, std::enable_if_t<std::is_base_of_v<
+                   compressed_csr_matrix<typename SpMatType::value_type,
+                                         typename SpMatType::index_type,
+                                         typename SpMatType::allocator_type>,
+                   SpMatType> > > : public std::true_type {};
+
+template <typename SpMatType>
+struct is_mapped_csr_matrix<
+    SpMatType, std::enable_if_t<std::is_base_of_v<
+                   mapped_csr_matrix<typename SpMatType::value_type,
+                                     typename SpMatType::index_type>,
+                   SpMatType> > > : public std::true_type {};
+
 template <typename SpMatType>
 inline constexpr bool is_csr_matrix_v = is_csr_matrix<SpMatType>::value;
 template <typename SpMatType>
 inline constexpr bool is_csc_matrix_v = is_csc_matrix<SpMatType>::value;
 template <typename SpMatType>
 inline constexpr bool is_coo_matrix_v = is_coo_matrix<SpMatType>::value;
+template <typename SpMatType>
+inline constexpr bool is_compressed_csr_matrix_v =
+    is_compressed_csr_matrix<SpMatType>::value;
+template <typename SpMatType>
+inline constexpr bool is_mapped_csr_matrix_v =
+    is_mapped_csr_matrix<SpMatType>::value;
+
+/// Whether the matrix exposes raw CSR arrays (rowptr / colind / nzval)
+template <typename SpMatType>
+inline constexpr bool has_csr_arrays_v =
+    is_csr_matrix_v<SpMatType> or is_mapped_csr_matrix_v<SpMatType>;
 
 template <typename SpMatType, typename U = void>
 struct enable_if_csr_matrix {
@@ -66,14 +98,22 @@ struct enable_if_coo_matrix {
 };
 
 template <typename SpMatType, typename U = void>
-using enable_if_csr_matrix_t =
-    typename enable_if_csr_matrix<SpMatType, U>::type;
+struct enable_if_compressed_csr_matrix {
+  using type = std::enable_if_t<is_compressed_csr_matrix_v<SpMatType>, U>;
+};
+
+template <typename SpMatType, typename U = void>
+using enable_if_csr_matrix_t = std::enable_if_t<is_csr_matrix_v<SpMatType>, U>;
+template <typename SpMatType, typename U = void>
+using enable_if_csc_matrix_t = std::enable_if_t<is_csc_matrix_v<SpMatType>, U>;
+template <typename SpMatType, typename U = void>
+using enable_if_coo_matrix_t = std::enable_if_t<is_coo_matrix_v<SpMatType>, U>;
 template <typename SpMatType, typename U = void>
-using enable_if_csc_matrix_t =
-    typename enable_if_csc_matrix<SpMatType, U>::type;
+using enable_if_compressed_csr_matrix_t =
+    std::enable_if_t<is_compressed_csr_matrix_v<SpMatType>, U>;
 template <typename SpMatType, typename U = void>
-using enable_if_coo_matrix_t =
-    typename enable_if_coo_matrix<SpMatType, U>::type;
+using enable_if_csr_arrays_t =
+    std::enable_if_t<has_csr_arrays_v<SpMatType>, U>;
 
 template <typename SpMatType>
 using value_type_t = typename SpMatType::value_type;
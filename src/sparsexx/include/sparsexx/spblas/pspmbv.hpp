@@ -10,6 +10,7 @@
 
 #include <chrono>
 #include <numeric>
+#include <optional>
 #include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
 #include <sparsexx/matrix_types/type_traits.hpp>
 #include <sparsexx/spblas/spmbv.hpp>
@@ -67,6 +68,32 @@ struct spmv_info {
       }
     return reqs;
   }
+
+  // Reverse communication pattern (remote contributions to local rows)
+
+  template <typename T>
+  std::vector<MPI_Request> post_transpose_recv(T* X) const {
+    std::vector<MPI_Request> reqs;
+    int comm_size = send_offsets.size();
+    for(int i = 0; i < comm_size; ++i)
+      if(send_counts[i]) {
+        reqs.emplace_back(
+            detail::mpi_irecv(X + send_offsets[i], send_counts[i], i, 1, comm));
+      }
+    return reqs;
+  }
+
+  template <typename T>
+  std::vector<MPI_Request> post_transpose_send(const T* X) const {
+    std::vector<MPI_Request> reqs;
+    int comm_size = recv_offsets.size();
+    for(int i = 0; i < comm_size; ++i)
+      if(recv_counts[i]) {
+        reqs.emplace_back(
+            detail::mpi_isend(X + recv_offsets[i], recv_counts[i], i, 1, comm));
+      }
+    return reqs;
+  }
 };
 
 template <typename DistSpMatrixType>
@@ -82,8 +109,14 @@ auto generate_spmv_comm_info(const DistSpMatrixType& A) {
   std::set<index_type> unique_elements_set;
   if(off_diagonal_tile) {
     assert(off_diagonal_tile->indexing() == 0);
-    unique_elements_set.insert(off_diagonal_tile->colind().begin(),
-                               off_diagonal_tile->colind().end());
+    using tile_type = typename DistSpMatrixType::tile_type;
+    if constexpr(sparsexx::detail::is_compressed_csr_matrix_v<tile_type>) {
+      auto colind = off_diagonal_tile->decompress_colind();
+      unique_elements_set.insert(colind.begin(), colind.end());
+    } else {
+      unique_elements_set.insert(off_diagonal_tile->colind().begin(),
+                                 off_diagonal_tile->colind().end());
+    }
   }
 
   // Place unique col indices into contiguous memory
@@ -195,6 +228,48 @@ auto generate_spmv_comm_info(const DistSpMatrixType& A) {
   return info;
 }
 
+/**
+ *  @brief Reusable buffers of the distributed SpMV kernels.
+ *
+ *  Sized for a fixed matrix / communication pattern, such that an operator
+ *  which applies the same matrix repeatedly allocates them only once.
+ */
+template <typename T, typename IndexType>
+struct pspmv_workspace {
+  std::vector<T> V_recv_pack;     ///< Received remote elements of V
+  std::vector<T> V_send_pack;     ///< Local elements of V to send
+  std::vector<T> V_remote;        ///< Remote elements of V by global index
+  std::vector<T> AV_remote_pack;  ///< Transposed contributions to send
+  std::vector<T> AV_local_pack;   ///< Received transposed contributions
+
+  /// Position in recv_indices of the global columns, offset by the first
+  /// received column
+  std::vector<IndexType> recv_map;
+  spmbv_workspace<T> spmbv;  ///< Per-thread partial results
+
+  pspmv_workspace() = default;
+
+  /**
+   *  @param[in] N    Number of (global) columns of the matrix
+   *  @param[in] info Communication pattern of the matrix
+   */
+  pspmv_workspace(size_t N, const spmv_info<IndexType>& info)
+      : V_recv_pack(info.recv_indices.size()),
+        V_send_pack(info.send_indices.size()),
+        V_remote(N),
+        AV_remote_pack(info.recv_indices.size()),
+        AV_local_pack(info.send_indices.size()) {
+    const auto& recv_indices = info.recv_indices;
+    if(recv_indices.size()) {
+      // recv_indices are sorted
+      const auto col_lo = recv_indices.front();
+      recv_map.resize(recv_indices.back() - col_lo + 1);
+      for(size_t p = 0; p < recv_indices.size(); ++p)
+        recv_map[recv_indices[p] - col_lo] = p;
+    }
+  }
+};
+
 template <typename DistSpMatType,
           typename ScalarType = detail::value_type_t<DistSpMatType>,
           typename IndexType = detail::index_type_t<DistSpMatType>>
@@ -202,7 +277,8 @@ void pgespmv(detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
              const detail::type_identity_t<ScalarType>* V,
              detail::type_identity_t<ScalarType> BETA,
              detail::type_identity_t<ScalarType>* AV,
-             const spmv_info<detail::type_identity_t<IndexType>>& spmv_info) {
+             const spmv_info<detail::type_identity_t<IndexType>>& spmv_info,
+             pspmv_workspace<ScalarType, IndexType>* ws = nullptr) {
   using value_type = ScalarType;
   // using index_type = IndexType;
 
@@ -219,32 +295,29 @@ void pgespmv(detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
   /***** Initial Communication Part *****/
 
   // auto st_alloc = std::chrono::high_resolution_clock::now();
-  //  Allocated packed buffers
+  //  Packed buffers and buffer for offdiagonal matvec (reused if passed)
   size_t nrecv_pack = recv_indices.size();
   size_t nsend_pack = send_indices.size();
-  auto V_recv_pack = detail::no_init_array<value_type>(nrecv_pack);
-  auto V_send_pack = detail::no_init_array<value_type>(nsend_pack);
-
-  // Buffer for offdiagonal matvec
-
-  // std::vector<value_type> V_remote( N );
-  auto V_remote = detail::no_init_array<value_type>(N);
+  std::optional<pspmv_workspace<value_type, IndexType>> local_ws;
+  if(not ws) ws = &local_ws.emplace(N, spmv_info);
+  auto* V_recv_pack = ws->V_recv_pack.data();
+  auto* V_send_pack = ws->V_send_pack.data();
+  auto* V_remote = ws->V_remote.data();
   // auto en_alloc = std::chrono::high_resolution_clock::now();
 
   // Post async recv's for remote data required for offdiagonal
   // matvec
-  auto recv_reqs = spmv_info.post_remote_recv(V_recv_pack.get());
+  auto recv_reqs = spmv_info.post_remote_recv(V_recv_pack);
 
   // Pack data to send to remote processes
   // auto st_permb = std::chrono::high_resolution_clock::now();
-  sparsexx::permute_vector(nsend_pack, V, send_indices.data(),
-                           V_send_pack.get(),
+  sparsexx::permute_vector(nsend_pack, V, send_indices.data(), V_send_pack,
                            sparsexx::PermuteDirection::Backward);
   // auto en_permb = std::chrono::high_resolution_clock::now();
 
   // Send data (async) to remote processes
   // auto st_send = std::chrono::high_resolution_clock::now();
-  auto send_reqs = spmv_info.post_remote_send(V_send_pack.get());
+  auto send_reqs = spmv_info.post_remote_send(V_send_pack);
   // auto en_send = std::chrono::high_resolution_clock::now();
 
   /***** Diagonal Matvec *****/
@@ -259,14 +332,14 @@ void pgespmv(detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
 
   // Unpack data into contiguous buffer
   // auto st_permf = std::chrono::high_resolution_clock::now();
-  sparsexx::permute_vector(nrecv_pack, V_recv_pack.get(), recv_indices.data(),
-                           V_remote.get(), sparsexx::PermuteDirection::Forward);
+  sparsexx::permute_vector(nrecv_pack, V_recv_pack, recv_indices.data(),
+                           V_remote, sparsexx::PermuteDirection::Forward);
   // auto en_permf = std::chrono::high_resolution_clock::now();
 
   /***** Off-diagonal Matvec *****/
   // auto st_rem = std::chrono::high_resolution_clock::now();
   if(A.off_diagonal_tile_ptr())
-    gespmbv(1, ALPHA, A.off_diagonal_tile(), V_remote.get(), N, 1., AV, N);
+    gespmbv(1, ALPHA, A.off_diagonal_tile(), V_remote, N, 1., AV, N);
   // auto en_rem = std::chrono::high_resolution_clock::now();
 
   // Wait for all sends to complete to keep packed buffer in scope
@@ -286,4 +359,94 @@ void pgespmv(detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
   //   std::chrono::duration<double,std::milli>(en_wait2 - st_wait2).count());
 }
 
+/**
+ *  @brief Distributed symmetric sparse matrix - dense vector product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  A is symmetric and only its upper triangle (including the diagonal) is
+ *  stored: the diagonal tile of each rank is upper triangular (see
+ *  gespmbv_sym) and the off-diagonal tile only contains columns to the
+ *  right of the local row block. The off-diagonal tile is used twice: once
+ *  as stored with the remote elements of V (same communication as pgespmv)
+ *  and once transposed, whose (remote) contributions are sent back to the
+ *  owning ranks along the reverse communication pattern of spmv_info. The
+ *  transposed product is accumulated directly into the packed buffer of
+ *  the received columns, i.e. its per-thread partial results only span the
+ *  remote columns the local rows reference.
+ */
+template <typename DistSpMatType,
+          typename ScalarType = detail::value_type_t<DistSpMatType>,
+          typename IndexType = detail::index_type_t<DistSpMatType>>
+void pgespmv_sym(
+    detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
+    const detail::type_identity_t<ScalarType>* V,
+    detail::type_identity_t<ScalarType> BETA,
+    detail::type_identity_t<ScalarType>* AV,
+    const spmv_info<detail::type_identity_t<IndexType>>& spmv_info,
+    pspmv_workspace<ScalarType, IndexType>* ws = nullptr) {
+  using value_type = ScalarType;
+
+  const auto N = A.n();
+  const auto M_local = A.local_row_extent();
+
+  const auto& recv_indices = spmv_info.recv_indices;
+  const auto& send_indices = spmv_info.send_indices;
+
+  // Packed buffers (reused if passed)
+  size_t nrecv_pack = recv_indices.size();
+  size_t nsend_pack = send_indices.size();
+  std::optional<pspmv_workspace<value_type, IndexType>> local_ws;
+  if(not ws) ws = &local_ws.emplace(N, spmv_info);
+  auto* V_recv_pack = ws->V_recv_pack.data();
+  auto* V_send_pack = ws->V_send_pack.data();
+  auto* V_remote = ws->V_remote.data();
+  auto* AV_remote_pack = ws->AV_remote_pack.data();
+  auto* AV_local_pack = ws->AV_local_pack.data();
+
+  // Post async recv's for remote data required for the off-diagonal matvec
+  auto recv_reqs = spmv_info.post_remote_recv(V_recv_pack);
+
+  // Pack and send data to remote processes
+  sparsexx::permute_vector(nsend_pack, V, send_indices.data(), V_send_pack,
+                           sparsexx::PermuteDirection::Backward);
+  auto send_reqs = spmv_info.post_remote_send(V_send_pack);
+
+  /***** Diagonal Matvec *****/
+  gespmbv_sym(1, ALPHA, A.diagonal_tile(), V, M_local, BETA, AV, M_local,
+              &ws->spmbv);
+
+  // Transposed off-diagonal contributions to remote rows, accumulated
+  // directly in the packed order of the received columns
+  auto trans_recv_reqs = spmv_info.post_transpose_recv(AV_local_pack);
+  if(A.off_diagonal_tile_ptr() and nrecv_pack) {
+    const int64_t col_lo = recv_indices.front();
+    const auto* recv_map = ws->recv_map.data();
+    detail::gespmbv_scatter(
+        1, ALPHA, A.off_diagonal_tile(), V, M_local, 0., AV_remote_pack,
+        nrecv_pack, nrecv_pack,
+        [=](int64_t j) { return recv_map[j - col_lo]; }, ws->spmbv);
+  }
+  auto trans_send_reqs = spmv_info.post_transpose_send(AV_remote_pack);
+
+  // Wait for receives to complete and unpack
+  detail::mpi_waitall_ignore_status(recv_reqs);
+  sparsexx::permute_vector(nrecv_pack, V_recv_pack, recv_indices.data(),
+                           V_remote, sparsexx::PermuteDirection::Forward);
+
+  /***** Off-diagonal Matvec *****/
+  if(A.off_diagonal_tile_ptr())
+    gespmbv(1, ALPHA, A.off_diagonal_tile(), V_remote, N, 1., AV, N);
+
+  // Accumulate remote contributions into local rows
+  detail::mpi_waitall_ignore_status(trans_recv_reqs);
+  for(size_t i = 0; i < nsend_pack; ++i) {
+    AV[send_indices[i]] += AV_local_pack[i];
+  }
+
+  // Wait for all sends to complete to keep packed buffers in scope
+  detail::mpi_waitall_ignore_status(send_reqs);
+  detail::mpi_waitall_ignore_status(trans_send_reqs);
+}
+
 }  // namespace sparsexx::spblas
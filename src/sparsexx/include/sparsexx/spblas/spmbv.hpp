@@ -8,8 +8,14 @@
 
 #pragma once
 
+#include <algorithm>
 #include <sparsexx/sparsexx_config.hpp>
 #include <sparsexx/spblas/type_traits.hpp>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace sparsexx::spblas {
 
@@ -72,6 +78,362 @@ gespmbv(int64_t K, ALPHAT ALPHA, const SpMatType& A,
     }
 }
 
+/**
+ *  @brief Mixed precision CSR sparse matrix - dense block vector product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  A is stored in a different (typically reduced) precision than V / AV. The
+ *  elements of A are promoted and all products are accumulated in the
+ *  precision of V / AV.
+ *
+ *  @tparam SpMatType Sparse matrix type s.t. is_csr_matrix_v is true
+ *  @tparam T         Field of V / AV, differs from SpMatType::value_type
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Sparse matrix in CSR format
+ *  @param[in]     V      Input block vector stored in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector stored in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ */
+template <typename SpMatType, typename T>
+std::enable_if_t<sparsexx::detail::is_csr_matrix_v<SpMatType> and
+                 not std::is_same_v<typename SpMatType::value_type, T> >
+gespmbv(int64_t K, T ALPHA, const SpMatType& A, const T* V, int64_t LDV,
+        T BETA, T* AV, int64_t LDAV) {
+  const int64_t M = A.m();
+  const auto* Anz = A.nzval().data();
+  const auto* Arp = A.rowptr().data();
+  const auto* Aci = A.colind().data();
+  const auto indexing = A.indexing();
+
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for(int64_t k = 0; k < K; ++k)
+    for(int64_t i = 0; i < M; ++i) {
+      const auto j_st = Arp[i] - indexing;
+      const auto j_en = Arp[i + 1] - indexing;
+      const auto* V_k = V + k * LDV - indexing;
+
+      T av = 0.;
+      for(auto j = j_st; j < j_en; ++j) {
+        av += static_cast<T>(Anz[j]) * V_k[Aci[j]];
+      }
+
+      AV[i + k * LDAV] = ALPHA * av + BETA * AV[i + k * LDAV];
+    }
+}
+
+/**
+ *  @brief Reusable scratch storage of the scattering SpMBV kernels.
+ *
+ *  The transposed and symmetric kernels accumulate into per-thread partial
+ *  results. Callers which apply the same matrix repeatedly (e.g. the
+ *  operator of an iterative eigensolver) keep a workspace alive across calls
+ *  such that these buffers are only allocated once.
+ */
+template <typename T>
+class spmbv_workspace {
+  std::vector<T> thread_partials_;
+
+ public:
+  /// Storage for `n` partial results for each of `nthreads` threads
+  T* thread_partials(int64_t n, int nthreads) {
+    const size_t len = n * nthreads;
+    if(thread_partials_.size() < len) thread_partials_.resize(len);
+    return thread_partials_.data();
+  }
+};
+
+namespace detail {
+
+/// Visit the (0-based) column indices and values of row `i` of a (compressed)
+/// CSR matrix as f(col, value)
+template <typename SpMatType, typename Func>
+inline void visit_csr_row(const SpMatType& A, int64_t i, Func&& f) {
+  if constexpr(sparsexx::detail::is_compressed_csr_matrix_v<SpMatType>) {
+    A.visit_row(i, f);
+  } else {
+    const auto* Arp = A.rowptr().data();
+    const auto* Aci = A.colind().data();
+    const auto* Anz = A.nzval().data();
+    const auto indexing = A.indexing();
+    const auto j_en = Arp[i + 1] - indexing;
+    for(auto j = Arp[i] - indexing; j < j_en; ++j) f(Aci[j] - indexing, Anz[j]);
+  }
+}
+
+/// Number of threads of the parallel regions of the scattering kernels
+inline int spmbv_max_threads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+/// Zero the per-thread partial results (`n` each) and return the ones of the
+/// calling thread, must be called from all threads of the parallel region
+template <typename T>
+inline T* spmbv_thread_partials(T* partials, int64_t n, int nthreads) {
+#ifdef _OPENMP
+#pragma omp for
+#endif
+  for(int t = 0; t < nthreads; ++t) std::fill_n(partials + t * n, n, T(0));
+#ifdef _OPENMP
+  return partials + omp_get_thread_num() * n;
+#else
+  return partials;
+#endif
+}
+
+/**
+ *  @brief Scattered (transposed) CSR sparse matrix - dense block vector
+ *  product.
+ *
+ *  AV = ALPHA * P * A**T * V + BETA * AV
+ *
+ *  where AV has NAV rows and P maps column j of A onto row colmap(j) of AV.
+ *  Each thread accumulates into a private copy of AV (NAV x K) which are
+ *  reduced afterwards.
+ */
+template <typename SpMatType, typename ColMap>
+void gespmbv_scatter(int64_t K, typename SpMatType::value_type alpha,
+                     const SpMatType& A,
+                     const typename SpMatType::value_type* V, int64_t LDV,
+                     typename SpMatType::value_type beta,
+                     typename SpMatType::value_type* AV, int64_t LDAV,
+                     int64_t NAV, ColMap&& colmap,
+                     spmbv_workspace<typename SpMatType::value_type>& ws) {
+  using value_type = typename SpMatType::value_type;
+
+  const int64_t M = A.m();
+  const int nthreads = spmbv_max_threads();
+  auto* AV_thread = ws.thread_partials(NAV * K, nthreads);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+    auto* AV_t = spmbv_thread_partials(AV_thread, NAV * K, nthreads);
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for(int64_t i = 0; i < M; ++i) {
+      visit_csr_row(A, i, [&](int64_t j, value_type a) {
+        auto* AV_tj = AV_t + colmap(j);
+        for(int64_t k = 0; k < K; ++k) AV_tj[k * NAV] += a * V[i + k * LDV];
+      });
+    }
+  }
+
+  // Reduce thread contributions
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for(int64_t k = 0; k < K; ++k)
+    for(int64_t i = 0; i < NAV; ++i) {
+      value_type av = 0.;
+      for(int t = 0; t < nthreads; ++t)
+        av += AV_thread[i + k * NAV + t * NAV * K];
+      AV[i + k * LDAV] = alpha * av + beta * AV[i + k * LDAV];
+    }
+}
+
+}  // namespace detail
+
+/**
+ *  @brief (Compressed) CSR sparse matrix (transposed) - dense block vector
+ *  product.
+ *
+ *  AV = ALPHA * A**T * V + BETA * AV
+ *
+ *  The transposed product scatters into AV, each thread accumulates into a
+ *  private copy of AV (N x K) which are reduced afterwards.
+ *
+ *  @tparam SpMatType Sparse matrix type s.t. is_csr_matrix_v or
+ *                    is_compressed_csr_matrix_v is true
+ *  @tparam ALPHAT    Type of ALPHA, must be convertible to
+ * SpMatType::value_type
+ *  @tparam BETAT     Type of BETA, must be convertible to SpMatType::value_type
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Sparse matrix in (compressed) CSR format (M x N)
+ *  @param[in]     V      Input block vector (M x K) in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector (N x K) in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ *  @param[in/out] ws     Workspace for the per-thread copies of AV, allocated
+ *                        for this call if null
+ */
+template <typename SpMatType, typename ALPHAT, typename BETAT>
+std::enable_if_t<detail::spmbv_uses_generic_csr_v<SpMatType, ALPHAT, BETAT> or
+                 detail::spmbv_uses_compressed_csr_v<SpMatType, ALPHAT, BETAT> >
+gespmbv_trans(int64_t K, ALPHAT ALPHA, const SpMatType& A,
+              const typename SpMatType::value_type* V, int64_t LDV, BETAT BETA,
+              typename SpMatType::value_type* AV, int64_t LDAV,
+              spmbv_workspace<typename SpMatType::value_type>* ws = nullptr) {
+  spmbv_workspace<typename SpMatType::value_type> local_ws;
+  detail::gespmbv_scatter(
+      K, ALPHA, A, V, LDV, BETA, AV, LDAV, A.n(), [](int64_t j) { return j; },
+      ws ? *ws : local_ws);
+}
+
+/**
+ *  @brief (Compressed) symmetric CSR sparse matrix - dense block vector
+ *  product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  A is a symmetric (M x M) matrix of which only the upper triangle
+ *  (including the diagonal) is stored, i.e. each stored A(i,j) (j > i) also
+ *  represents A(j,i). Elements below the diagonal must not be present.
+ *
+ *  Rows are processed in parallel: the gathered upper triangle contributions
+ *  are written directly (race free) while the scattered (transposed) strictly
+ *  upper contributions are accumulated into per-thread partial results
+ *  which are reduced afterwards.
+ *
+ *  @tparam SpMatType Sparse matrix type s.t. is_csr_matrix_v or
+ *                    is_compressed_csr_matrix_v is true
+ *  @tparam ALPHAT    Type of ALPHA, must be convertible to
+ * SpMatType::value_type
+ *  @tparam BETAT     Type of BETA, must be convertible to SpMatType::value_type
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Upper triangle of a symmetric matrix in (compressed)
+ *                        CSR format
+ *  @param[in]     V      Input block vector stored in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector stored in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ *  @param[in/out] ws     Workspace for the per-thread partial results,
+ *                        allocated for this call if null
+ */
+template <typename SpMatType, typename ALPHAT, typename BETAT>
+std::enable_if_t<detail::spmbv_uses_generic_csr_v<SpMatType, ALPHAT, BETAT> or
+                 detail::spmbv_uses_compressed_csr_v<SpMatType, ALPHAT, BETAT> >
+gespmbv_sym(int64_t K, ALPHAT ALPHA, const SpMatType& A,
+            const typename SpMatType::value_type* V, int64_t LDV, BETAT BETA,
+            typename SpMatType::value_type* AV, int64_t LDAV,
+            spmbv_workspace<typename SpMatType::value_type>* ws = nullptr) {
+  using value_type = typename SpMatType::value_type;
+
+  const value_type alpha = ALPHA;
+  const value_type beta = BETA;
+
+  const int64_t M = A.m();
+  const int nthreads = detail::spmbv_max_threads();
+  spmbv_workspace<value_type> local_ws;
+  auto* AV_thread = (ws ? *ws : local_ws).thread_partials(M * K, nthreads);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+    auto* AV_t = detail::spmbv_thread_partials(AV_thread, M * K, nthreads);
+    std::vector<value_type> av(K);
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for(int64_t i = 0; i < M; ++i) {
+      std::fill(av.begin(), av.end(), 0.);
+      detail::visit_csr_row(A, i, [&](int64_t j, value_type a) {
+        for(int64_t k = 0; k < K; ++k) {
+          av[k] += a * V[j + k * LDV];
+          if(j != i) AV_t[j + k * M] += a * V[i + k * LDV];
+        }
+      });
+      for(int64_t k = 0; k < K; ++k)
+        AV[i + k * LDAV] = alpha * av[k] + beta * AV[i + k * LDAV];
+    }
+  }
+
+  // Reduce transposed contributions
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for(int64_t k = 0; k < K; ++k)
+    for(int64_t i = 0; i < M; ++i) {
+      value_type av = 0.;
+      for(int t = 0; t < nthreads; ++t) av += AV_thread[i + k * M + t * M * K];
+      AV[i + k * LDAV] += alpha * av;
+    }
+}
+
+/**
+ *  @brief Compressed CSR sparse matrix - dense block vector product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  The column indices of each row are decoded on the fly and reused for all
+ *  K columns of V.
+ *
+ *  @tparam SpMatType Sparse matrix type s.t. is_compressed_csr_matrix_v is
+ * true
+ *  @tparam ALPHAT    Type of ALPHA, must be convertible to
+ * SpMatType::value_type
+ *  @tparam BETAT     Type of BETA, must be convertible to SpMatType::value_type
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Sparse matrix in compressed CSR format
+ *  @param[in]     V      Input block vector stored in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector stored in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ */
+template <typename SpMatType, typename ALPHAT, typename BETAT>
+std::enable_if_t<detail::spmbv_uses_compressed_csr_v<SpMatType, ALPHAT, BETAT> >
+gespmbv(int64_t K, ALPHAT ALPHA, const SpMatType& A,
+        const typename SpMatType::value_type* V, int64_t LDV, BETAT BETA,
+        typename SpMatType::value_type* AV, int64_t LDAV) {
+  using value_type = typename SpMatType::value_type;
+  using index_type = typename SpMatType::index_type;
+
+  const value_type alpha = ALPHA;
+  const value_type beta = BETA;
+  const int64_t M = A.m();
+
+  if(K == 1) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+    for(int64_t i = 0; i < M; ++i) {
+      value_type av = 0.;
+      A.visit_row(i, [&](index_type j, value_type a) { av += a * V[j]; });
+      AV[i] = alpha * av + beta * AV[i];
+    }
+  } else {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<value_type> av(K);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 256)
+#endif
+      for(int64_t i = 0; i < M; ++i) {
+        std::fill(av.begin(), av.end(), 0.);
+        A.visit_row(i, [&](index_type j, value_type a) {
+          for(int64_t k = 0; k < K; ++k) av[k] += a * V[j + k * LDV];
+        });
+        for(int64_t k = 0; k < K; ++k)
+          AV[i + k * LDAV] = alpha * av[k] + beta * AV[i + k * LDAV];
+      }
+    }
+  }
+}
+
 /**
  *  @brief Generic COO sparse matrix - dense block vector product.
  *
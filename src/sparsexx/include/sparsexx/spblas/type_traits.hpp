@@ -53,7 +53,7 @@ template <typename SpMatType, typename ALPHAT, typename BETAT>
 struct spmbv_uses_generic_csr {
   inline static constexpr bool value =
       are_alpha_beta_convertible_v<SpMatType, ALPHAT, BETAT> and
-      sparsexx::detail::is_csr_matrix_v<SpMatType> and
+      sparsexx::detail::has_csr_arrays_v<SpMatType> and
       not spmbv_uses_mkl_v<SpMatType, ALPHAT, BETAT>;
 };
 
@@ -61,6 +61,17 @@ template <typename SpMatType, typename ALPHAT, typename BETAT>
 inline constexpr bool spmbv_uses_generic_csr_v =
     spmbv_uses_generic_csr<SpMatType, ALPHAT, BETAT>::value;
 
+template <typename SpMatType, typename ALPHAT, typename BETAT>
+struct spmbv_uses_compressed_csr {
+  inline static constexpr bool value =
+      are_alpha_beta_convertible_v<SpMatType, ALPHAT, BETAT> and
+      sparsexx::detail::is_compressed_csr_matrix_v<SpMatType>;
+};
+
+template <typename SpMatType, typename ALPHAT, typename BETAT>
+inline constexpr bool spmbv_uses_compressed_csr_v =
+    spmbv_uses_compressed_csr<SpMatType, ALPHAT, BETAT>::value;
+
 template <typename SpMatType, typename ALPHAT, typename BETAT>
 struct spmbv_uses_generic_coo {
   inline static constexpr bool value =
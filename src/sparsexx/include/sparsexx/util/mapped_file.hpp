@@ -0,0 +1,88 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace sparsexx {
+
+/**
+ *  @brief Read-only memory mapping of a file.
+ *
+ *  The mapping is released on destruction, the class is move-only.
+ */
+class mapped_file {
+  void* data_ = nullptr;
+  size_t size_ = 0;
+
+ public:
+  mapped_file() = default;
+
+  /**
+   *  @brief Map a file into memory.
+   *
+   *  @param[in] fname Name of the file to map
+   */
+  mapped_file(std::string fname) {
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error("Could Not Open " + fname);
+
+    struct stat st;
+    if(::fstat(fd, &st)) {
+      ::close(fd);
+      throw std::runtime_error("Could Not Stat " + fname);
+    }
+    size_ = st.st_size;
+
+    if(size_) {
+      data_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      if(data_ == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Could Not Map " + fname);
+      }
+    }
+
+    // The mapping remains valid after the descriptor is closed
+    ::close(fd);
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  mapped_file(mapped_file&& other) noexcept
+      : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  mapped_file& operator=(mapped_file&& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~mapped_file() noexcept {
+    if(data_) ::munmap(data_, size_);
+  }
+
+  inline const char* data() const {
+    return static_cast<const char*>(data_);
+  }
+  inline size_t size() const { return size_; }
+};
+
+}  // namespace sparsexx
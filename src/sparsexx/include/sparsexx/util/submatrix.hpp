@@ -262,7 +262,7 @@ SpMatType extract_upper_triangle(const SpMatType& A) {
 }
 
 template <typename SpMatType,
-          typename = detail::enable_if_csr_matrix_t<SpMatType> >
+          typename = detail::enable_if_csr_arrays_t<SpMatType> >
 std::vector<typename SpMatType::value_type> extract_diagonal_elements(
     const SpMatType& A) {
   const auto M = A.m();
@@ -295,6 +295,23 @@ std::vector<typename SpMatType::value_type> extract_diagonal_elements(
   return D;
 }
 
+template <typename SpMatType,
+          typename = detail::enable_if_compressed_csr_matrix_t<SpMatType>,
+          typename = void>
+std::vector<typename SpMatType::value_type> extract_diagonal_elements(
+    const SpMatType& A) {
+  using index_t = typename SpMatType::index_type;
+  using value_t = typename SpMatType::value_type;
+  const int64_t M = A.m();
+  std::vector<value_t> D(M, 0);
+  for(int64_t i = 0; i < M; ++i) {
+    A.visit_row(i, [&](index_t j, value_t v) {
+      if(j == i) D[i] = v;
+    });
+  }
+  return D;
+}
+
 template <typename SpMatType,
           typename = detail::enable_if_csr_matrix_t<SpMatType> >
 typename SpMatType::value_type trace(const SpMatType& A) {
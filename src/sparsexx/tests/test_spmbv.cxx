@@ -6,8 +6,11 @@
  * See LICENSE.txt for details
  */
 
+#include <cmath>
+#include <sparsexx/matrix_types/compressed_csr_matrix.hpp>
 #include <sparsexx/matrix_types/csr_matrix.hpp>
 #include <sparsexx/spblas/spmbv.hpp>
+#include <sparsexx/util/submatrix.hpp>
 
 #include "catch2/catch.hpp"
 
@@ -50,4 +53,168 @@ TEST_CASE("CSR SPMBV", "[spmbv]") {
   for(int i = 0; i < N; ++i) {
     CHECK(AV[i] == Approx(AV_ref[i]));
   }
+
+  // A is symmetric
+  std::fill(AV.begin(), AV.end(), 1.);
+  sparsexx::spblas::gespmbv_trans(1, 1., A, V.data(), N, 0., AV.data(), N);
+  for(int i = 0; i < N; ++i) {
+    CHECK(AV[i] == Approx(AV_ref[i]));
+  }
+}
+
+TEST_CASE("CSR Symmetric SPMBV", "[spmbv]") {
+  using mat_type = sparsexx::csr_matrix<double, int32_t>;
+  // Upper triangle of
+  // [2 1 0 0 0 0]
+  // [1 2 1 0 0 0]
+  // [0 1 2 1 0 0]
+  // [0 0 1 2 1 0]
+  // [0 0 0 1 2 1]
+  // [0 0 0 0 1 2]
+
+  int indexing;
+  SECTION("Indexing = 0") { indexing = 0; }
+
+  SECTION("Indexing = 1") { indexing = 1; }
+
+  int N = 6;
+  int NNZ = 11;
+  mat_type A(N, N, NNZ, indexing);
+
+  A.rowptr() = {
+      indexing,     indexing + 2, indexing + 4,  indexing + 6,
+      indexing + 8, indexing + 10, indexing + 11,
+  };
+
+  A.colind() = {indexing + 0, indexing + 1, indexing + 1, indexing + 2,
+                indexing + 2, indexing + 3, indexing + 3, indexing + 4,
+                indexing + 4, indexing + 5, indexing + 5};
+
+  A.nzval() = {2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2};
+
+  // Two right hand sides
+  std::vector<double> V = {1, 2, 3, 4, 5, 6, 6, 5, 4, 3, 2, 1};
+
+  std::vector<double> AV_ref = {4,  8,  12, 16, 20, 17,
+                                17, 20, 16, 12, 8,  4};
+
+  std::vector<double> AV(2 * N, 1.);
+  sparsexx::spblas::gespmbv_sym(2, 2., A, V.data(), N, -1., AV.data(), N);
+  for(int i = 0; i < 2 * N; ++i) {
+    CHECK(AV[i] == Approx(2. * AV_ref[i] - 1.));
+  }
+
+  // Reused workspace, partial results of previous products must not leak
+  sparsexx::spblas::spmbv_workspace<double> ws;
+  for(int rep = 0; rep < 2; ++rep) {
+    std::fill(AV.begin(), AV.end(), 1.);
+    sparsexx::spblas::gespmbv_sym(2, 2., A, V.data(), N, -1., AV.data(), N,
+                                  &ws);
+    for(int i = 0; i < 2 * N; ++i) {
+      CHECK(AV[i] == Approx(2. * AV_ref[i] - 1.));
+    }
+
+    std::fill(AV.begin(), AV.end(), 1.);
+    sparsexx::spblas::gespmbv_trans(1, 1., A, V.data(), N, 0., AV.data(), N,
+                                    &ws);
+    for(int i = 0; i < N; ++i) {
+      // Transpose of the stored upper triangle only
+      const double ref = 2. * V[i] + (i ? V[i - 1] : 0.);
+      CHECK(AV[i] == Approx(ref));
+    }
+  }
+}
+
+TEST_CASE("Compressed CSR SPMBV", "[spmbv]") {
+  using mat_type = sparsexx::csr_matrix<double, int32_t>;
+  using cmp_mat_type = sparsexx::compressed_csr_matrix<double, int32_t>;
+
+  int indexing;
+  SECTION("Indexing = 0") { indexing = 0; }
+
+  SECTION("Indexing = 1") { indexing = 1; }
+
+  // Row 0: Small deltas (8-bit)
+  // Row 1: Medium deltas (16-bit)
+  // Row 2: Small deltas with one large gap (8-bit + escape)
+  // Row 3: Empty
+  // Row 4: Single element
+  int M = 5;
+  int N = 100000;
+  std::vector<std::vector<int32_t>> cols = {{0, 1, 2, 3},
+                                            {0, 300, 600, 900, 1200},
+                                            {5, 70000, 70001, 70002},
+                                            {},
+                                            {99999}};
+
+  int NNZ = 0;
+  for(auto& c : cols) NNZ += c.size();
+  mat_type A(M, N, NNZ, indexing);
+  A.rowptr()[0] = indexing;
+  for(int i = 0, k = 0; i < M; ++i) {
+    for(auto j : cols[i]) {
+      A.colind()[k] = j + indexing;
+      A.nzval()[k] = 1. + k;
+      k++;
+    }
+    A.rowptr()[i + 1] = k + indexing;
+  }
+
+  cmp_mat_type A_cmp(A);
+  REQUIRE(A_cmp.nnz() == NNZ);
+  CHECK(A_cmp.delta_width()[0] == 1);
+  CHECK(A_cmp.delta_width()[1] == 2);
+  CHECK(A_cmp.delta_width()[2] == 1);
+  CHECK(A_cmp.deltas().size() == 3 + 8 + 7);
+
+  // Round trip
+  auto A_dcmp = A_cmp.decompress();
+  A.set_indexing(0);
+  CHECK(A_dcmp == A);
+
+  // Two right hand sides
+  std::vector<double> V(2 * N), AV(2 * M, 1.), AV_ref(2 * M, 1.);
+  for(int i = 0; i < 2 * N; ++i) V[i] = std::sin(double(i));
+  sparsexx::spblas::gespmbv(2, 2., A_cmp, V.data(), N, -1., AV.data(), M);
+  sparsexx::spblas::gespmbv(2, 2., A, V.data(), N, -1., AV_ref.data(), M);
+  for(int i = 0; i < 2 * M; ++i) {
+    CHECK(AV[i] == Approx(AV_ref[i]));
+  }
+
+  std::vector<double> W(M), AtW(N, 1.), AtW_ref(N, 1.);
+  for(int i = 0; i < M; ++i) W[i] = std::cos(double(i));
+  sparsexx::spblas::gespmbv_trans(1, 2., A_cmp, W.data(), M, -1., AtW.data(),
+                                  N);
+  sparsexx::spblas::gespmbv_trans(1, 2., A, W.data(), M, -1., AtW_ref.data(),
+                                  N);
+  for(int i = 0; i < N; ++i) {
+    CHECK(AtW[i] == Approx(AtW_ref[i]));
+  }
+}
+
+TEST_CASE("Compressed CSR Symmetric SPMBV", "[spmbv]") {
+  using mat_type = sparsexx::csr_matrix<double, int32_t>;
+  using cmp_mat_type = sparsexx::compressed_csr_matrix<double, int32_t>;
+
+  // Upper triangle of the tridiagonal matrix (see CSR Symmetric SPMBV)
+  int N = 6;
+  int NNZ = 11;
+  mat_type A(N, N, NNZ, 0);
+  A.rowptr() = {0, 2, 4, 6, 8, 10, 11};
+  A.colind() = {0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5};
+  A.nzval() = {2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2};
+  cmp_mat_type A_cmp(A);
+
+  std::vector<double> V = {1, 2, 3, 4, 5, 6, 6, 5, 4, 3, 2, 1};
+  std::vector<double> AV_ref = {4,  8,  12, 16, 20, 17,
+                                17, 20, 16, 12, 8,  4};
+
+  std::vector<double> AV(2 * N, 1.);
+  sparsexx::spblas::gespmbv_sym(2, 2., A_cmp, V.data(), N, -1., AV.data(), N);
+  for(int i = 0; i < 2 * N; ++i) {
+    CHECK(AV[i] == Approx(2. * AV_ref[i] - 1.));
+  }
+
+  auto D = sparsexx::extract_diagonal_elements(A_cmp);
+  for(int i = 0; i < N; ++i) CHECK(D[i] == 2.);
 }
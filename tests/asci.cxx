@@ -9,6 +9,7 @@
 #include <spdlog/sinks/null_sink.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <iostream>
 #include <macis/asci/determinant_contributions.hpp>
 #include <macis/asci/grow.hpp>
@@ -18,6 +19,8 @@
 #include <macis/sd_operations.hpp>
 #include <macis/types.hpp>
 #include <macis/util/fcidump.hpp>
+#include <numeric>
+#include <random>
 
 #include "ut_common.hpp"
 
@@ -206,6 +209,81 @@ TEST_CASE("Triplets") {
   REQUIRE(quad_hist == new_quad_hist);
 }
 
+TEST_CASE("Constraint Generation") {
+  constexpr size_t num_bits = 64;
+  using wfn_type = macis::wfn_t<num_bits>;
+  const size_t norb = 16, nocc = 5;
+  const size_t ns = nocc * (norb - nocc);
+  const size_t nd = (ns * (ns - norb + 1)) / 4;
+  const auto O = macis::full_mask<num_bits>(norb);
+
+  // Random sorted unique alpha strings
+  std::mt19937 gen(11);
+  auto random_alpha = [&](size_t n) {
+    std::vector<wfn_type> alpha;
+    std::vector<unsigned> orbs(norb);
+    std::iota(orbs.begin(), orbs.end(), 0);
+    for(size_t i = 0; i < n; ++i) {
+      std::shuffle(orbs.begin(), orbs.end(), gen);
+      wfn_type w = 0;
+      for(size_t j = 0; j < nocc; ++j) w.set(orbs[j]);
+      alpha.push_back(w);
+    }
+    macis::radix_sort(alpha.begin(), alpha.end());
+    alpha.erase(std::unique(alpha.begin(), alpha.end()), alpha.end());
+    return alpha;
+  };
+
+  auto generate = [&](const auto& alpha, auto* cache) {
+    return macis::generate_constraint_general(
+        2, norb, ns, nd, alpha, 200, cache MACIS_MPI_CODE(, MPI_COMM_WORLD));
+  };
+
+  // Reference histograms
+  auto check = [&](const auto& constraint_sizes, const auto& alpha) {
+    REQUIRE(constraint_sizes.size() > 0);
+    size_t nquint = 0;
+    for(const auto& [c, nw] : constraint_sizes) {
+      size_t nw_ref = 0;
+      for(const auto& a : alpha)
+        nw_ref += macis::constraint_histogram(a, ns, nd, c.C, O, c.B);
+      REQUIRE(nw == nw_ref);
+      nquint += c.C.count() == 5;
+    }
+    REQUIRE(nquint > 0);
+  };
+
+  auto alpha = random_alpha(400);
+  macis::constraint_histogram_cache<num_bits> cache;
+  check(generate(alpha, &cache), alpha);
+  REQUIRE(cache.alpha == alpha);
+
+  // Some strings removed, some added: incremental update of the cache
+  auto alpha_next = random_alpha(100);
+  alpha_next.insert(alpha_next.end(), alpha.begin() + 50, alpha.end());
+  macis::radix_sort(alpha_next.begin(), alpha_next.end());
+  alpha_next.erase(std::unique(alpha_next.begin(), alpha_next.end()),
+                   alpha_next.end());
+
+  auto ref = generate(alpha_next,
+                      (macis::constraint_histogram_cache<num_bits>*)nullptr);
+  auto cached = generate(alpha_next, &cache);
+  check(cached, alpha_next);
+  REQUIRE(cached.size() == ref.size());
+  for(size_t i = 0; i < ref.size(); ++i) {
+    REQUIRE(cached[i].first.C == ref[i].first.C);
+    REQUIRE(cached[i].second == ref[i].second);
+  }
+
+  // A cache which is only valid on some PEs is not used on any of them
+#ifdef MACIS_ENABLE_MPI
+  int world_rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+  if(world_rank) cache = macis::constraint_histogram_cache<num_bits>();
+#endif
+  check(generate(alpha, &cache), alpha);
+}
+
 TEST_CASE("ASCI") {
   MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
   using macis::NumActive;
@@ -274,3 +352,598 @@ TEST_CASE("ASCI") {
   MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
   spdlog::drop_all();
 }
+
+TEST_CASE("ASCI Spin-Flip") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+
+  spdlog::null_logger_mt("davidson");
+  spdlog::null_logger_mt("ci_solver");
+  spdlog::null_logger_mt("asci_search");
+  spdlog::null_logger_mt("asci_grow");
+
+  // Read Water FCIDUMP
+  const size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  using generator_t = macis::DoubleLoopHamiltonianGenerator<64>;
+  generator_t ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  macis::ASCISettings asci_settings;
+  macis::MCSCFSettings mcscf_settings;
+  asci_settings.spin_flip = true;
+  asci_settings.ntdets_max = 2000;
+  asci_settings.pair_size_max = 1e7;
+
+  // HF guess
+  std::vector<macis::wfn_t<64>> dets = {
+      macis::canonical_hf_determinant<64>(5, 5)};
+  std::vector<double> C = {1.0};
+  double E0 = ham_gen.matrix_element(dets[0], dets[0]);
+
+  std::tie(E0, dets, C) = macis::asci_grow(
+      asci_settings, mcscf_settings, E0, std::move(dets), std::move(C), ham_gen,
+      norb MACIS_MPI_CODE(, MPI_COMM_WORLD));
+
+  REQUIRE(dets.size() == 2000);
+  REQUIRE(C.size() == 2000);
+  REQUIRE(std::inner_product(C.begin(), C.end(), C.begin(), 0.0) ==
+          Approx(1.0));
+
+  // Only unique canonical representatives are selected
+  for(auto d : dets) REQUIRE(macis::is_spin_flip_canonical(d));
+  {
+    auto sorted_dets = dets;
+    std::sort(sorted_dets.begin(), sorted_dets.end(),
+              macis::bitset_less_comparator<64>{});
+    REQUIRE(std::adjacent_find(sorted_dets.begin(), sorted_dets.end()) ==
+            sorted_dets.end());
+  }
+
+  // Same energy as the determinant expansion of the same space
+  auto [full_dets, full_C] =
+      macis::spin_flip_unfold<64>(dets.begin(), dets.end(), C.data());
+  REQUIRE(full_dets.size() > dets.size());
+  REQUIRE(std::inner_product(full_C.begin(), full_C.end(), full_C.begin(),
+                             0.0) == Approx(1.0));
+
+  std::vector<double> X_local;
+  auto E_full = macis::selected_ci_diag<64>(
+      full_dets.begin(), full_dets.end(), ham_gen, mcscf_settings.ci_matel_tol,
+      mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol,
+      X_local MACIS_MPI_CODE(, MPI_COMM_WORLD));
+  REQUIRE(E0 == Approx(E_full));
+
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  spdlog::drop_all();
+}
+
+TEST_CASE("ASCI Hamiltonian Reuse") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+
+  spdlog::null_logger_mt("davidson");
+  spdlog::null_logger_mt("ci_solver");
+  spdlog::null_logger_mt("asci_search");
+  spdlog::null_logger_mt("asci_grow");
+
+  // Read Water FCIDUMP
+  const size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  using generator_t = macis::DoubleLoopHamiltonianGenerator<64>;
+  generator_t ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  macis::ASCISettings asci_settings;
+  macis::MCSCFSettings mcscf_settings;
+  asci_settings.ntdets_max = 1000;
+
+  auto grow = [&]() {
+    std::vector<macis::wfn_t<64>> dets = {
+        macis::canonical_hf_determinant<64>(5, 5)};
+    std::vector<double> C = {1.0};
+    double E0 = ham_gen.matrix_element(dets[0], dets[0]);
+    std::tie(E0, dets, C) = macis::asci_grow(
+        asci_settings, mcscf_settings, E0, std::move(dets), std::move(C),
+        ham_gen, norb MACIS_MPI_CODE(, MPI_COMM_WORLD));
+    return E0;
+  };
+
+  const auto E_ref = grow();
+
+  asci_settings.reuse_hamiltonian = true;
+  REQUIRE(grow() == Approx(E_ref));
+
+  // Storage options of the CI Hamiltonian are not supported by the reuse
+  mcscf_settings.ci_compress_colind = true;
+  REQUIRE_THROWS(grow());
+
+  // Nor by the other alternatives to the stored H, which are exclusive
+  asci_settings.reuse_hamiltonian = false;
+  mcscf_settings = macis::MCSCFSettings{};
+  mcscf_settings.ci_mixed_precision = true;
+  REQUIRE_NOTHROW(macis::check_ci_hamiltonian_settings(mcscf_settings));
+  mcscf_settings.ci_ham_upper_triangle = true;
+  REQUIRE_THROWS(grow());
+  mcscf_settings.ci_ham_upper_triangle = false;
+  mcscf_settings.ci_direct_sigma = true;
+  REQUIRE_THROWS(grow());
+  mcscf_settings.ci_mixed_precision = false;
+  REQUIRE_THROWS(macis::check_ci_hamiltonian_settings(mcscf_settings, true));
+
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  spdlog::drop_all();
+}
+
+TEST_CASE("ASCI Point Group Symmetry") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+
+  spdlog::null_logger_mt("davidson");
+  spdlog::null_logger_mt("ci_solver");
+  spdlog::null_logger_mt("asci_search");
+  spdlog::null_logger_mt("asci_grow");
+
+  // Read Water FCIDUMP
+  const size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  using generator_t = macis::DoubleLoopHamiltonianGenerator<64>;
+  generator_t ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Irreps of the water orbitals (the reference file has no ORBSYM header),
+  // derived from the integrals: orbitals coupled by T(p,q) or (pq|rr) share
+  // an irrep. The four classes of C2v are labeled in order of appearance
+  // (the O 1s orbital first, A1 = 0), any such labeling of the others
+  // preserves the (Z2 x Z2) product table.
+  const double sym_tol = 1e-8;
+  std::vector<size_t> parent(norb);
+  std::iota(parent.begin(), parent.end(), 0);
+  auto root = [&](size_t p) {
+    while(parent[p] != p) p = parent[p];
+    return p;
+  };
+  for(size_t p = 0; p < norb; ++p)
+    for(size_t q = 0; q < norb; ++q) {
+      bool coupled = std::abs(T[p + q * norb]) > sym_tol;
+      for(size_t r = 0; r < norb; ++r)
+        coupled = coupled or
+                  std::abs(V[p + q * norb + (r + r * norb) * norb2]) > sym_tol;
+      if(coupled) {
+        const auto rp = root(p), rq = root(q);
+        parent[std::max(rp, rq)] = std::min(rp, rq);
+      }
+    }
+  std::vector<size_t> roots;
+  std::vector<uint32_t> orbsym(norb);
+  for(size_t p = 0; p < norb; ++p) {
+    const auto rp = root(p);
+    auto it = std::find(roots.begin(), roots.end(), rp);
+    orbsym[p] = std::distance(roots.begin(), it);
+    if(it == roots.end()) roots.push_back(rp);
+  }
+  REQUIRE(roots.size() == 4);
+
+  // All symmetry forbidden integrals vanish
+  size_t nforbidden = 0;
+  for(size_t p = 0; p < norb; ++p)
+    for(size_t q = 0; q < norb; ++q) {
+      const bool allowed_pq = orbsym[p] == orbsym[q];
+      nforbidden += not allowed_pq and std::abs(T[p + q * norb]) > sym_tol;
+      for(size_t rs = 0; rs < norb2; ++rs) {
+        const size_t r = rs % norb, s = rs / norb;
+        const bool allowed =
+            (orbsym[p] ^ orbsym[q] ^ orbsym[r] ^ orbsym[s]) == 0;
+        nforbidden +=
+            not allowed and std::abs(V[p + q * norb + rs * norb2]) > sym_tol;
+      }
+    }
+  REQUIRE(nforbidden == 0);
+
+  macis::ASCISettings asci_settings;
+  macis::MCSCFSettings mcscf_settings;
+  asci_settings.ntdets_max = 2000;
+  asci_settings.pair_size_max = 1e7;
+
+  auto run_asci = [&]() {
+    std::vector<macis::wfn_t<64>> dets = {
+        macis::canonical_hf_determinant<64>(5, 5)};
+    std::vector<double> C = {1.0};
+    double E0 = ham_gen.matrix_element(dets[0], dets[0]);
+    return macis::asci_grow(asci_settings, mcscf_settings, E0,
+                            std::move(dets), std::move(C), ham_gen,
+                            norb MACIS_MPI_CODE(, MPI_COMM_WORLD));
+  };
+
+  // Symmetry forbidden excitations have vanishing matrix elements
+  auto [E_ref, dets_ref, C_ref] = run_asci();
+  ham_gen.set_orbital_symmetry(orbsym);
+  auto [E, dets, C] = run_asci();
+
+  REQUIRE(E == Approx(E_ref));
+  REQUIRE(dets.size() == 2000);
+  for(auto d : dets) REQUIRE(macis::det_irrep(d, orbsym) == 0);
+
+  REQUIRE_THROWS(ham_gen.set_orbital_symmetry({0, 1}));
+
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  spdlog::drop_all();
+}
+
+TEST_CASE("ASCI Wide Determinants") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+
+  spdlog::null_logger_mt("davidson");
+  spdlog::null_logger_mt("ci_solver");
+  spdlog::null_logger_mt("asci_search");
+  spdlog::null_logger_mt("asci_grow");
+
+  // Read Water FCIDUMP
+  const size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::ASCISettings asci_settings;
+  macis::MCSCFSettings mcscf_settings;
+  asci_settings.ntdets_max = 2000;
+  asci_settings.pair_size_max = 1e7;
+
+  auto run_asci = [&](auto nbits_tag) {
+    constexpr size_t nbits = decltype(nbits_tag)::value;
+    macis::DoubleLoopHamiltonianGenerator<nbits> ham_gen(
+        macis::matrix_span<double>(T.data(), norb, norb),
+        macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+    std::vector<macis::wfn_t<nbits>> dets = {
+        macis::canonical_hf_determinant<nbits>(5, 5)};
+    std::vector<double> C = {1.0};
+    double E0 = ham_gen.matrix_element(dets[0], dets[0]);
+    std::tie(E0, dets, C) = macis::asci_grow(
+        asci_settings, mcscf_settings, E0, std::move(dets), std::move(C),
+        ham_gen, norb MACIS_MPI_CODE(, MPI_COMM_WORLD));
+    REQUIRE(dets.size() == 2000);
+    return E0;
+  };
+
+  // Same selection independent of the determinant width
+  auto E_64 = run_asci(std::integral_constant<size_t, 64>{});
+  auto E_256 = run_asci(std::integral_constant<size_t, 256>{});
+  auto E_512 = run_asci(std::integral_constant<size_t, 512>{});
+  REQUIRE(E_256 == Approx(E_64));
+  REQUIRE(E_512 == Approx(E_64));
+
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  spdlog::drop_all();
+}
+
+TEST_CASE("ASCI Contributions") {
+  spdlog::null_logger_mt("asci_search");
+
+  // Read Water FCIDUMP
+  const size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  using generator_t = macis::DoubleLoopHamiltonianGenerator<64>;
+  generator_t ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // HF + singles as core determinants
+  auto hf = macis::canonical_hf_determinant<64>(5, 5);
+  std::vector<macis::wfn_t<64>> dets = {hf}, singles;
+  macis::generate_singles_spin(norb, hf, singles);
+  dets.insert(dets.end(), singles.begin(), singles.end());
+  const size_t ndets = dets.size();
+  std::vector<double> C(ndets);
+  for(size_t i = 0; i < ndets; ++i) C[i] = 1. / (i + 1);
+  // Shifted, such that no contribution is singular
+  const double E0 = ham_gen.matrix_element(hf, hf) - 1.;
+
+  macis::ASCISettings asci_settings;
+  asci_settings.rv_prune_tol = 0.;
+  auto contributions = [&](auto begin, auto end, const auto& C_sub) {
+    auto pairs = macis::asci_contributions_standard(
+        asci_settings, begin, end, E0, C_sub, norb, ham_gen.T(),
+        ham_gen.G_red(), ham_gen.V_red(), ham_gen.G(), ham_gen.V(), ham_gen);
+    macis::sort_and_accumulate_asci_pairs(pairs);
+    return pairs;
+  };
+
+  // Reference: one core determinant at a time
+  macis::asci_contrib_container<macis::wfn_t<64>> ref_pairs;
+  for(size_t i = 0; i < ndets; ++i) {
+    auto pairs = macis::asci_contributions_standard(
+        asci_settings, dets.begin() + i, dets.begin() + i + 1, E0,
+        std::vector<double>{C[i]}, norb, ham_gen.T(), ham_gen.G_red(),
+        ham_gen.V_red(), ham_gen.G(), ham_gen.V(), ham_gen);
+    ref_pairs.insert(ref_pairs.end(), pairs.begin(), pairs.end());
+  }
+  macis::sort_and_accumulate_asci_pairs(ref_pairs);
+
+  auto check = [&](const auto& pairs) {
+    REQUIRE(pairs.size() == ref_pairs.size());
+    for(size_t i = 0; i < pairs.size(); ++i) {
+      REQUIRE(pairs[i].state == ref_pairs[i].state);
+      REQUIRE(pairs[i].rv == Approx(ref_pairs[i].rv));
+    }
+  };
+
+  for(bool hash_accumulate : {false, true}) {
+    asci_settings.hash_accumulate = hash_accumulate;
+    asci_settings.pair_size_max = 5e8;
+
+    // All (thread-local) contributions are kept
+    check(contributions(dets.begin(), dets.end(), C));
+
+    // Pruning by accumulation of duplicates (nothing is below the tolerance)
+    asci_settings.pair_size_max = ref_pairs.size();
+    check(contributions(dets.begin(), dets.end(), C));
+
+#ifdef MACIS_ENABLE_MPI
+    // Constraint search: each rank holds the (thread-local S&A) contributions
+    // of its constraints, which generate disjoint sets of determinants. Scores
+    // agree up to the different screening of small matrix elements.
+    for(size_t pair_size_max : {size_t(5e8), ref_pairs.size() / 4})
+      for(bool dynamic_constraints : {false, true})
+        for(bool heat_bath : {false, true}) {
+          asci_settings.pair_size_max = pair_size_max;
+          asci_settings.dynamic_constraints = dynamic_constraints;
+          asci_settings.heat_bath = heat_bath;
+          auto pairs = macis::asci_contributions_constraint(
+              asci_settings, dets.begin(), dets.end(), E0, C, norb, ham_gen.T(),
+              ham_gen.G_red(), ham_gen.V_red(), ham_gen.G(), ham_gen.V(),
+              ham_gen, MPI_COMM_WORLD);
+          macis::sort_and_accumulate_asci_pairs(pairs);
+          REQUIRE(macis::allreduce(pairs.size(), MPI_SUM, MPI_COMM_WORLD) ==
+                  ref_pairs.size());
+          for(const auto& p : pairs) {
+            auto it = std::lower_bound(
+                ref_pairs.begin(), ref_pairs.end(), p,
+                [](const auto& a, const auto& b) {
+                  return macis::bitset_less(a.state, b.state);
+                });
+            REQUIRE((it != ref_pairs.end() and it->state == p.state));
+            REQUIRE(it->rv == Approx(p.rv).margin(1e-7));
+          }
+        }
+    asci_settings.dynamic_constraints = false;
+    asci_settings.heat_bath = false;
+#endif
+  }
+
+  // Heat-bath enumeration of the doubles, which screens |c * integral|:
+  // reference from the singles of each core determinant and its brute force
+  // doubles with |c * h_el| >= h_el_tol
+  asci_settings.hash_accumulate = false;
+  asci_settings.pair_size_max = 5e8;
+  asci_settings.h_el_tol = 1e-4;
+  {
+    asci_settings.just_singles = true;
+    macis::asci_contrib_container<macis::wfn_t<64>> hb_ref_pairs;
+    for(size_t i = 0; i < ndets; ++i) {
+      auto pairs = macis::asci_contributions_standard(
+          asci_settings, dets.begin() + i, dets.begin() + i + 1, E0,
+          std::vector<double>{C[i]}, norb, ham_gen.T(), ham_gen.G_red(),
+          ham_gen.V_red(), ham_gen.G(), ham_gen.V(), ham_gen);
+      hb_ref_pairs.insert(hb_ref_pairs.end(), pairs.begin(), pairs.end());
+
+      std::vector<macis::wfn_t<64>> ex_singles, ex_doubles;
+      macis::generate_singles_doubles_spin(norb, dets[i], ex_singles,
+                                           ex_doubles);
+      for(const auto& ex : ex_doubles) {
+        const double h_el = ham_gen.matrix_element(dets[i], ex);
+        if(std::abs(C[i] * h_el) < asci_settings.h_el_tol) continue;
+        hb_ref_pairs.push_back(
+            {ex, C[i] * h_el / (E0 - ham_gen.matrix_element(ex, ex))});
+      }
+    }
+    macis::sort_and_accumulate_asci_pairs(hb_ref_pairs);
+    asci_settings.just_singles = false;
+
+    asci_settings.heat_bath = true;
+    auto pairs = contributions(dets.begin(), dets.end(), C);
+    REQUIRE(pairs.size() < ref_pairs.size());
+    REQUIRE(pairs.size() == hb_ref_pairs.size());
+    for(size_t i = 0; i < pairs.size(); ++i) {
+      REQUIRE(pairs[i].state == hb_ref_pairs[i].state);
+      REQUIRE(pairs[i].rv == Approx(hb_ref_pairs[i].rv).margin(1e-12));
+    }
+  }
+  asci_settings.h_el_tol = macis::ASCISettings{}.h_el_tol;
+  asci_settings.heat_bath = false;
+
+  // Streaming top-K: exact if the budget is not hit
+  asci_settings.hash_accumulate = false;
+  asci_settings.stream_top_k = true;
+  asci_settings.pair_size_max = 5e8;
+  check(contributions(dets.begin(), dets.end(), C));
+
+  // Memory bounded by the budget, the determinants with the largest scores
+  // are retained (their scores may miss pruned partial contributions)
+  const size_t top_k = 100;
+  asci_settings.pair_mem_max =
+      ref_pairs.size() / 8 * sizeof(macis::asci_contrib<macis::wfn_t<64>>);
+  auto pairs = macis::asci_contributions_standard(
+      asci_settings, dets.begin(), dets.end(), E0, C, norb, ham_gen.T(),
+      ham_gen.G_red(), ham_gen.V_red(), ham_gen.G(), ham_gen.V(), ham_gen,
+      top_k);
+  REQUIRE(pairs.size() <= ref_pairs.size() / 8);
+  macis::sort_and_accumulate_asci_pairs(pairs);
+
+  auto ref_top = ref_pairs;
+  std::sort(ref_top.begin(), ref_top.end(), [](const auto& a, const auto& b) {
+    return std::abs(a.rv) > std::abs(b.rv);
+  });
+  for(size_t i = 0; i < top_k; ++i) {
+    auto it = std::lower_bound(pairs.begin(), pairs.end(), ref_top[i],
+                               [](const auto& a, const auto& b) {
+                                 return macis::bitset_less(a.state, b.state);
+                               });
+    REQUIRE((it != pairs.end() and it->state == ref_top[i].state));
+  }
+
+  spdlog::drop_all();
+}
+
+TEST_CASE("ASCI Contribution Hash Table") {
+  using wfn_type = macis::wfn_t<128>;
+  using table_type = macis::asci_contrib_hash_table<wfn_type>;
+
+  // Random contributions to a pool of determinants
+  std::mt19937_64 gen(42);
+  std::vector<wfn_type> pool(5000);
+  for(auto& w : pool) {
+    w = (wfn_type(gen()) << 64) | wfn_type(gen());
+    if(w.none()) w.set(0);
+  }
+  std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  macis::asci_contrib_container<wfn_type> pairs(50000);
+  for(auto& p : pairs) p = {pool[pick(gen)], dist(gen)};
+
+  auto ref_pairs = pairs;
+  macis::sort_and_accumulate_asci_pairs(ref_pairs);
+
+  auto check = [&](auto merged) {
+    macis::sort_and_accumulate_asci_pairs(merged);
+    REQUIRE(merged.size() == ref_pairs.size());
+    for(size_t i = 0; i < merged.size(); ++i) {
+      REQUIRE(merged[i].state == ref_pairs[i].state);
+      REQUIRE(merged[i].rv == Approx(ref_pairs[i].rv));
+    }
+  };
+
+  SECTION("Single Table") {
+    std::vector<table_type> tables(1);
+    tables[0].insert(pairs.begin(), pairs.end());
+    REQUIRE(tables[0].size() == ref_pairs.size());
+    REQUIRE(tables[0].npruned() == 0);
+    check(macis::merge_asci_contrib_tables(tables));
+  }
+
+  SECTION("Sharded Merge") {
+    for(size_t ntables : {2, 3, 7}) {
+      std::vector<table_type> tables(ntables);
+      for(size_t i = 0; i < pairs.size(); ++i)
+        tables[i % ntables].insert(pairs[i].state, pairs[i].rv);
+
+      // Shards partition each table
+      for(const auto& table : tables)
+        for(unsigned log2_nshards : {0u, 3u, 12u, 16u}) {
+          size_t count = 0;
+          for(size_t s = 0; s < (size_t(1) << log2_nshards); ++s)
+            table.for_each_in_shard(s, log2_nshards,
+                                    [&](const auto&) { ++count; });
+          REQUIRE(count == table.size());
+        }
+
+      check(macis::merge_asci_contrib_tables(tables));
+    }
+  }
+
+  SECTION("Pruning") {
+    // Half of the determinants have small contributions, the budget is
+    // exceeded by the large ones alone
+    table_type table(100, 0.5);
+    for(size_t i = 0; i < 1000; ++i) table.insert(pool[i], i % 2 ? 1. : 0.1);
+
+    REQUIRE(table.npruned() > 0);
+    REQUIRE(table.size() < 1000);
+    size_t nlarge = 0;
+    table.for_each([&](const auto& p) { nlarge += p.rv == 1.; });
+    REQUIRE(nlarge == 500);
+  }
+
+  SECTION("Top-K") {
+    // Single contribution per determinant: the top-K is exact
+    const size_t top_k = 50;
+    table_type table(400);
+    table.set_top_k(top_k);
+    std::vector<double> scores(pool.size());
+    for(size_t i = 0; i < pool.size(); ++i) {
+      scores[i] = dist(gen);
+      table.insert(pool[i], scores[i]);
+    }
+
+    REQUIRE(table.npruned() > 0);
+    REQUIRE(table.ndiscarded() > 0);
+    REQUIRE(table.capacity() <= 512);
+
+    std::vector<double> kept;
+    table.for_each([&](const auto& p) { kept.push_back(std::abs(p.rv)); });
+    std::sort(kept.begin(), kept.end(), std::greater<double>{});
+    std::transform(scores.begin(), scores.end(), scores.begin(),
+                   [](auto s) { return std::abs(s); });
+    std::sort(scores.begin(), scores.end(), std::greater<double>{});
+    REQUIRE(kept.size() >= top_k);
+    for(size_t i = 0; i < top_k; ++i) REQUIRE(kept[i] == scores[i]);
+  }
+}
+
+TEST_CASE("ASCI Score Finalization") {
+  using wfn_type = macis::wfn_t<128>;
+
+  std::mt19937_64 gen(7);
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  macis::asci_contrib_container<wfn_type> pairs(20000);
+  for(auto& p : pairs) {
+    p.state = (wfn_type(gen()) << 64) | wfn_type(gen());
+    p.rv = dist(gen);
+  }
+  pairs[3].rv = 0.;
+  macis::sort_and_accumulate_asci_pairs(pairs);
+
+  // Every 7th determinant is in the core space, as are some which do not
+  // receive contributions
+  std::vector<wfn_type> cdets;
+  for(size_t i = 0; i < pairs.size(); i += 7) cdets.push_back(pairs[i].state);
+  for(size_t i = 0; i < 10; ++i) cdets.push_back(wfn_type(gen()));
+  std::shuffle(cdets.begin(), cdets.end(), gen);
+
+  for(bool sorted : {true, false}) {
+    auto scores = pairs;
+    if(not sorted) std::shuffle(scores.begin(), scores.end(), gen);
+    auto nsearch = macis::finalize_asci_scores(scores, cdets.begin(),
+                                               cdets.end(), sorted);
+    macis::sort_and_accumulate_asci_pairs(scores);
+
+    size_t nsearch_ref = 0;
+    REQUIRE(scores.size() == pairs.size());
+    for(size_t i = 0; i < pairs.size(); ++i) {
+      REQUIRE(scores[i].state == pairs[i].state);
+      if(i % 7 == 0)
+        REQUIRE(scores[i].rv == 0.);
+      else
+        REQUIRE(scores[i].rv == -std::abs(pairs[i].rv));
+      nsearch_ref += scores[i].rv < 0.;
+    }
+    REQUIRE(nsearch == nsearch_ref);
+  }
+}
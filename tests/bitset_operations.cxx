@@ -8,6 +8,9 @@
 
 #include <iostream>
 #include <macis/bitset_operations.hpp>
+#include <macis/hamming_screen.hpp>
+#include <macis/util/radix_sort.hpp>
+#include <random>
 
 #include "ut_common.hpp"
 
@@ -86,6 +89,9 @@ TEST_CASE("Bitset Operations") {
       REQUIRE(macis::ffs(d) == 3);
       REQUIRE(macis::ffs(d << 64) == 3 + 64);
       REQUIRE(macis::ffs(d << 128) == 3 + 128);
+      bs<512> e(0xABC);
+      REQUIRE(macis::ffs(e << 448) == 3 + 448);
+      REQUIRE(macis::ffs(bs<512>()) == 0);
     }
   }
 
@@ -101,6 +107,9 @@ TEST_CASE("Bitset Operations") {
     REQUIRE(macis::fls(d) == 31);
     REQUIRE(macis::fls(d << 64) == 31 + 64);
     REQUIRE(macis::fls(d << 128) == 31 + 128);
+    bs<512> e(0xDEADBEEF);
+    REQUIRE(macis::fls(e) == 31);
+    REQUIRE(macis::fls((e << 448) | e) == 31 + 448);
   }
 
   SECTION("Indices") {
@@ -115,12 +124,30 @@ TEST_CASE("Bitset Operations") {
     bs<64> a_64(0xCCCCCCCCDEADDEAD);
     bs<32> ref(0xDEADDEAD);
     REQUIRE(macis::truncate_bitset<32>(a_64) == ref);
+
+    bs<256> a_256 = (bs<256>(0xDEADDEAD) << 192) | bs<256>(0xBEEF);
+    REQUIRE(macis::truncate_bitset<128>(a_256) == bs<128>(0xBEEF));
+    REQUIRE(macis::truncate_bitset<64>(a_256) == bs<64>(0xBEEF));
   }
 
   SECTION("Expand") {
     bs<32> a_32(0xDEADDEAD);
     bs<64> ref(0x00000000DEADDEAD);
     REQUIRE(macis::expand_bitset<64>(a_32) == ref);
+
+    bs<128> a_128 = (bs<128>(0xDEADDEAD) << 96) | bs<128>(0xBEEF);
+    auto a_512 = macis::expand_bitset<512>(a_128);
+    REQUIRE(a_512 == ((bs<512>(0xDEADDEAD) << 96) | bs<512>(0xBEEF)));
+  }
+
+  SECTION("Lo/Hi Words") {
+    bs<256> a = (bs<256>(0xDEAD) << 200) | (bs<256>(0xBEEF) << 70);
+    REQUIRE(macis::bitset_lo_word(a) == (bs<128>(0xBEEF) << 70));
+    REQUIRE(macis::bitset_hi_word(a) == (bs<128>(0xDEAD) << 72));
+
+    bs<512> b = (bs<512>(0xDEAD) << 300) | (bs<512>(0xBEEF) << 3);
+    REQUIRE(macis::bitset_lo_word(b) == bs<256>(0xBEEF << 3));
+    REQUIRE(macis::bitset_hi_word(b) == (bs<256>(0xDEAD) << 44));
   }
 
   SECTION("Compare") {
@@ -147,6 +174,148 @@ TEST_CASE("Bitset Operations") {
       b = b << 128;
       REQUIRE(macis::bitset_less(b, a));
       REQUIRE_FALSE(macis::bitset_less(a, b));
+      REQUIRE_FALSE(macis::bitset_less(a, a));
+    }
+    SECTION("512 bit") {
+      bs<512> a(65ull), b(42ull);
+      a = (a << 400) | bs<512>(1);
+      b = (b << 400) | bs<512>(2);
+      REQUIRE(macis::bitset_less(b, a));
+      REQUIRE_FALSE(macis::bitset_less(a, b));
+      REQUIRE(macis::bitset_less(a, a | bs<512>(4)));
+    }
+  }
+}
+
+template <size_t N>
+void hamming_screen_test() {
+  std::default_random_engine gen(N);
+  std::uniform_int_distribution<size_t> bit_dist(0, N - 1);
+
+  // Random low-distance perturbations of a reference bitset
+  std::bitset<N> bra;
+  for(int i = 0; i < 10; ++i) bra.set(bit_dist(gen));
+  std::vector<std::bitset<N>> kets(1003, bra);
+  for(auto& ket : kets) {
+    const int nflip = bit_dist(gen) % 8;
+    for(int i = 0; i < nflip; ++i) ket.flip(bit_dist(gen));
+  }
+
+  macis::bitset_soa<N> kets_soa(kets.begin(), kets.end());
+  REQUIRE(kets_soa.size() == kets.size());
+
+  // Every compiled path against the scalar reference
+  using macis::hamming_isa;
+  for(auto isa :
+       {hamming_isa::scalar, hamming_isa::avx2, hamming_isa::avx512}) {
+    if(not macis::hamming_isa_available(isa)) continue;
+    for(size_t j_begin : {0, 5}) {
+      std::vector<uint32_t> ref;
+      for(size_t j = j_begin; j < kets.size(); ++j)
+        if((bra ^ kets[j]).count() <= 4) ref.emplace_back(j);
+
+      std::vector<uint32_t> cand(kets.size());
+      auto ncand = macis::hamming_screen(bra, kets_soa, j_begin, kets.size(),
+                                         4, cand.data(), isa);
+      cand.resize(ncand);
+      REQUIRE(cand == ref);
+    }
+  }
+}
+
+TEST_CASE("Hamming Screen") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  SECTION("64 bit") { hamming_screen_test<64>(); }
+  SECTION("128 bit") { hamming_screen_test<128>(); }
+  SECTION("256 bit") { hamming_screen_test<256>(); }
+}
+
+template <size_t N>
+void radix_sort_test() {
+  std::default_random_engine gen(N);
+  std::uniform_int_distribution<size_t> bit_dist(0, N - 1);
+
+  for(size_t n : {100, 5000, 100000}) {
+    // Bitstrings with few (scattered) varying bits and duplicates, with the
+    // original index as payload
+    std::bitset<N> base;
+    for(int i = 0; i < 10; ++i) base.set(bit_dist(gen));
+    std::vector<size_t> varying_bits(12);
+    for(auto& b : varying_bits) b = bit_dist(gen);
+
+    std::vector<std::pair<std::bitset<N>, size_t>> data(n);
+    for(size_t i = 0; i < n; ++i) {
+      data[i] = {base, i};
+      for(auto b : varying_bits)
+        if(gen() % 2) data[i].first.flip(b);
     }
+
+    auto ref = data;
+    std::stable_sort(ref.begin(), ref.end(), [](const auto& x, const auto& y) {
+      return macis::bitset_less(x.first, y.first);
+    });
+
+    auto data_inplace = data;
+    macis::radix_sort(data.begin(), data.end(),
+                      [](const auto& x) -> const auto& { return x.first; });
+    REQUIRE(data == ref);
+
+    // In-place sort is not stable: same key sequence, permuted payloads
+    macis::radix_sort_inplace(
+        data_inplace.begin(), data_inplace.end(),
+        [](const auto& x) -> const auto& { return x.first; });
+    for(size_t i = 0; i < n; ++i)
+      REQUIRE(data_inplace[i].first == ref[i].first);
+    auto by_payload = [](const auto& x, const auto& y) {
+      return x.second < y.second;
+    };
+    std::sort(data_inplace.begin(), data_inplace.end(), by_payload);
+    std::sort(ref.begin(), ref.end(), by_payload);
+    REQUIRE(data_inplace == ref);
+
+    // Keys only
+    std::vector<std::bitset<N>> keys(n);
+    for(auto& k : keys)
+      for(int i = 0; i < 16; ++i) k.set(bit_dist(gen));
+    auto ref_keys = keys;
+    std::sort(ref_keys.begin(), ref_keys.end(),
+              macis::bitset_less_comparator<N>{});
+    auto keys_inplace = keys;
+    macis::radix_sort(keys.begin(), keys.end());
+    REQUIRE(keys == ref_keys);
+    macis::radix_sort_inplace(
+        keys_inplace.begin(), keys_inplace.end(),
+        [](const auto& x) -> const auto& { return x; });
+    REQUIRE(keys_inplace == ref_keys);
+  }
+}
+
+TEST_CASE("Radix Sort") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  SECTION("64 bit") { radix_sort_test<64>(); }
+  SECTION("128 bit") { radix_sort_test<128>(); }
+  SECTION("256 bit") { radix_sort_test<256>(); }
+
+  SECTION("Integer Keys") {
+    std::default_random_engine gen(0);
+    std::vector<uint64_t> keys(50000);
+    for(auto& k : keys) k = gen() * gen();
+    auto ref_keys = keys;
+    std::sort(ref_keys.begin(), ref_keys.end());
+    auto keys_inplace = keys;
+    macis::radix_sort(keys.begin(), keys.end());
+    REQUIRE(keys == ref_keys);
+
+    // Top buckets of very different sizes, split by all threads in place
+    for(auto& k : keys_inplace)
+      if(k % 8) k = (k % 3) << 62 | (k & 0xffff);
+    ref_keys = keys_inplace;
+    std::sort(ref_keys.begin(), ref_keys.end());
+    macis::radix_sort_inplace(
+        keys_inplace.begin(), keys_inplace.end(),
+        [](const auto& x) -> const auto& { return x; });
+    REQUIRE(keys_inplace == ref_keys);
   }
 }
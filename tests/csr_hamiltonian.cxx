@@ -10,12 +10,21 @@
 #include <iomanip>
 #include <iostream>
 #include <macis/csr_hamiltonian.hpp>
+#include <macis/hamiltonian_cache.hpp>
 #include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/sorted_double_loop.hpp>
+#include <macis/incremental_hamiltonian.hpp>
+#include <macis/solvers/selected_ci_diag.hpp>
 #include <macis/util/fcidump.hpp>
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
 
 #include "ut_common.hpp"
 
-TEST_CASE("CSR Hamiltonian") {
+TEMPLATE_TEST_CASE("CSR Hamiltonian", "[ham_gen]",
+                   macis::DoubleLoopHamiltonianGenerator<64>,
+                   macis::SortedDoubleLoopHamiltonianGenerator<64>) {
   ROOT_ONLY(MPI_COMM_WORLD);
 
   size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
@@ -27,7 +36,7 @@ TEST_CASE("CSR Hamiltonian") {
   macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
   macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
 
-  using generator_type = macis::DoubleLoopHamiltonianGenerator<64>;
+  using generator_type = TestType;
 
 #if 0
   generator_type ham_gen(norb, V.data(), T.data());
@@ -70,8 +79,54 @@ TEST_CASE("CSR Hamiltonian") {
   }
 }
 
+TEMPLATE_TEST_CASE("Upper Triangular CSR Hamiltonian", "[ham_gen]",
+                   macis::DoubleLoopHamiltonianGenerator<64>,
+                   macis::SortedDoubleLoopHamiltonianGenerator<64>) {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  using generator_type = TestType;
+  generator_type ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+
+  auto H = macis::make_csr_hamiltonian<int32_t>(dets.begin(), dets.end(),
+                                                ham_gen, 1e-16);
+  auto H_upper = macis::make_csr_hamiltonian<int32_t>(
+      dets.begin(), dets.end(), ham_gen, 1e-16, true);
+
+  REQUIRE(H_upper.m() == H.m());
+  REQUIRE(H_upper.n() == H.n());
+  REQUIRE(2 * H_upper.nnz() - H.m() == H.nnz());
+
+  // Compare to the upper triangle of the full matrix
+  for(int64_t i = 0; i < H.m(); ++i) {
+    auto k_upper = H_upper.rowptr()[i];
+    for(auto k = H.rowptr()[i]; k < H.rowptr()[i + 1]; ++k) {
+      if(H.colind()[k] < i) continue;
+      REQUIRE(H_upper.colind()[k_upper] == H.colind()[k]);
+      REQUIRE(H_upper.nzval()[k_upper] == Approx(H.nzval()[k]));
+      k_upper++;
+    }
+    REQUIRE(k_upper == H_upper.rowptr()[i + 1]);
+  }
+}
+
 #ifdef MACIS_ENABLE_MPI
-TEST_CASE("Distributed CSR Hamiltonian") {
+TEMPLATE_TEST_CASE("Distributed CSR Hamiltonian", "[ham_gen]",
+                   macis::DoubleLoopHamiltonianGenerator<64>,
+                   macis::SortedDoubleLoopHamiltonianGenerator<64>) {
   MPI_Barrier(MPI_COMM_WORLD);
   size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
   size_t nocc = 5;
@@ -82,7 +137,7 @@ TEST_CASE("Distributed CSR Hamiltonian") {
   macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
   macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
 
-  using generator_type = macis::DoubleLoopHamiltonianGenerator<64>;
+  using generator_type = TestType;
 
 #if 0
   generator_type ham_gen(norb, V.data(), T.data());
@@ -132,6 +187,381 @@ TEST_CASE("Distributed CSR Hamiltonian") {
     }
   }
 
+  // Generation from an alpha-sorted store (of unsorted determinants)
+  std::reverse(dets.begin(), dets.end());
+  macis::alpha_sorted_dets<64> store(dets.begin(), dets.end());
+  auto check_tile = [](const auto& A, const auto& A_ref) {
+    REQUIRE(A.n() == A_ref.n());
+    REQUIRE(A.rowptr() == A_ref.rowptr());
+    REQUIRE(A.colind() == A_ref.colind());
+    for(size_t i = 0; i < A.nnz(); ++i)
+      REQUIRE(A.nzval()[i] == Approx(A_ref.nzval()[i]));
+  };
+  for(bool upper : {false, true}) {
+    auto H_ref = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, upper);
+    auto H_store = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, store, ham_gen, 1e-16, upper);
+    check_tile(H_store.diagonal_tile(), H_ref.diagonal_tile());
+    if(mpi_size > 1)
+      check_tile(H_store.off_diagonal_tile(), H_ref.off_diagonal_tile());
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+TEST_CASE("Balanced Distributed CSR Hamiltonian", "[ham_gen]") {
+  MPI_Barrier(MPI_COMM_WORLD);
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::SortedDoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  const int64_t ndets = dets.size();
+
+  int mpi_size;
+  MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+
+  // Replicated reference
+  auto H = macis::make_csr_hamiltonian_block<int32_t>(
+      dets.begin(), dets.end(), dets.begin(), dets.end(), ham_gen, 1e-16);
+
+  for(bool upper : {false, true}) {
+    auto H_dist = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, upper,
+        true);
+    auto H_even = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, upper);
+
+    // Row extents are contiguous and cover the full matrix
+    std::vector<std::pair<int32_t, int32_t>> row_tiles(mpi_size);
+    for(int i = 0; i < mpi_size; ++i) {
+      row_tiles[i] = H_dist.row_bounds(i);
+      REQUIRE(row_tiles[i].first < row_tiles[i].second);
+      if(i) REQUIRE(row_tiles[i].first == row_tiles[i - 1].second);
+    }
+    REQUIRE(row_tiles.front().first == 0);
+    REQUIRE(row_tiles.back().second == ndets);
+
+    // Balancing must not increase the maximum local work
+    auto local_nnz = [](const auto& A) {
+      int64_t nnz = A.diagonal_tile().nnz();
+      if(A.off_diagonal_tile_ptr()) nnz += A.off_diagonal_tile().nnz();
+      return nnz;
+    };
+    int64_t max_nnz = local_nnz(H_dist), max_nnz_even = local_nnz(H_even);
+    MPI_Allreduce(MPI_IN_PLACE, &max_nnz, 1, MPI_INT64_T, MPI_MAX,
+                  MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &max_nnz_even, 1, MPI_INT64_T, MPI_MAX,
+                  MPI_COMM_WORLD);
+    REQUIRE(max_nnz <= max_nnz_even);
+
+    if(upper) continue;
+
+    // Distribute replicated matrix over the same extents
+    decltype(H_dist) H_dist_ref(MPI_COMM_WORLD, H, row_tiles);
+
+    REQUIRE(H_dist.diagonal_tile().rowptr() ==
+            H_dist_ref.diagonal_tile().rowptr());
+    REQUIRE(H_dist.diagonal_tile().colind() ==
+            H_dist_ref.diagonal_tile().colind());
+    size_t nnz_local = H_dist.diagonal_tile().nnz();
+    for(auto i = 0ul; i < nnz_local; ++i) {
+      REQUIRE(H_dist.diagonal_tile().nzval()[i] ==
+              Approx(H_dist_ref.diagonal_tile().nzval()[i]));
+    }
+
+    if(mpi_size > 1) {
+      REQUIRE(H_dist.off_diagonal_tile().rowptr() ==
+              H_dist_ref.off_diagonal_tile().rowptr());
+      REQUIRE(H_dist.off_diagonal_tile().colind() ==
+              H_dist_ref.off_diagonal_tile().colind());
+      nnz_local = H_dist.off_diagonal_tile().nnz();
+      for(auto i = 0ul; i < nnz_local; ++i) {
+        REQUIRE(H_dist.off_diagonal_tile().nzval()[i] ==
+                Approx(H_dist_ref.off_diagonal_tile().nzval()[i]));
+      }
+    }
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+#endif
+
+TEST_CASE("Incremental CSR Hamiltonian", "[ham_gen]") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  using generator_type = macis::SortedDoubleLoopHamiltonianGenerator<64>;
+  generator_type ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate two overlapping configuration spaces
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  std::vector<macis::wfn_t<64>> dets_a, dets_b;
+  for(size_t i = 0; i < dets.size(); ++i) {
+    if(i % 3) dets_a.emplace_back(dets[i]);
+    if(i % 5) dets_b.emplace_back(dets[i]);
+  }
+  // Permute retained determinants
+  for(size_t i = 0; i + 1 < dets_b.size(); i += 2)
+    std::swap(dets_b[i], dets_b[i + 1]);
+
+  macis::IncrementalHamiltonian<64, int32_t> H_inc;
+  H_inc.update(MACIS_MPI_CODE(MPI_COMM_WORLD, ) dets_a.begin(), dets_a.end(),
+               ham_gen, 1e-16);
+  const auto& H = H_inc.update(MACIS_MPI_CODE(MPI_COMM_WORLD, ) dets_b.begin(),
+                               dets_b.end(), ham_gen, 1e-16);
+
+  size_t nreuse = H_inc.nrows_reused();
+  MACIS_MPI_CODE(nreuse = macis::allreduce(nreuse, MPI_SUM, MPI_COMM_WORLD);)
+  REQUIRE(nreuse > 0);
+
+  auto compare_csr = [](const auto& A, const auto& B) {
+    REQUIRE(A.m() == B.m());
+    REQUIRE(A.n() == B.n());
+    REQUIRE(A.rowptr() == B.rowptr());
+    REQUIRE(A.colind() == B.colind());
+    for(size_t i = 0; i < A.nnz(); ++i)
+      REQUIRE(A.nzval()[i] == Approx(B.nzval()[i]));
+  };
+
+#ifdef MACIS_ENABLE_MPI
+  auto H_ref = macis::make_dist_csr_hamiltonian<int32_t>(
+      MPI_COMM_WORLD, dets_b.begin(), dets_b.end(), ham_gen, 1e-16);
+  compare_csr(H.diagonal_tile(), H_ref.diagonal_tile());
+  if(macis::comm_size(MPI_COMM_WORLD) > 1)
+    compare_csr(H.off_diagonal_tile(), H_ref.off_diagonal_tile());
   MPI_Barrier(MPI_COMM_WORLD);
+#else
+  auto H_ref = macis::make_csr_hamiltonian<int32_t>(
+      dets_b.begin(), dets_b.end(), ham_gen, 1e-16);
+  compare_csr(H, H_ref);
+#endif
 }
+
+TEST_CASE("Spin-Flip CSR Hamiltonian", "[ham_gen]") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::SortedDoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // The CISD space is closed under spin-flip
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  const size_t ndets = dets.size();
+
+  // Fold / unfold round trip
+  std::vector<double> C(ndets);
+  for(size_t i = 0; i < ndets; ++i)
+    C[i] = std::cos(macis::spin_flip_canonical(dets[i]).to_ullong() % 97);
+  auto [sf_dets, sf_C] =
+      macis::spin_flip_fold<64>(dets.begin(), dets.end(), C.data());
+  const size_t nsf = sf_dets.size();
+  const size_t nself =
+      std::count_if(sf_dets.begin(), sf_dets.end(),
+                    [](auto d) { return macis::spin_flip(d) == d; });
+  REQUIRE(2 * nsf - nself == ndets);
+  for(auto d : sf_dets) REQUIRE(macis::is_spin_flip_canonical(d));
+
+  auto [unf_dets, unf_C] =
+      macis::spin_flip_unfold<64>(sf_dets.begin(), sf_dets.end(), sf_C.data());
+  REQUIRE(unf_dets.size() == ndets);
+  std::unordered_map<macis::wfn_t<64>, double> C_map;
+  for(size_t i = 0; i < ndets; ++i) C_map[dets[i]] = C[i];
+  for(size_t i = 0; i < ndets; ++i)
+    REQUIRE(unf_C[i] == Approx(C_map.at(unf_dets[i])));
+
+  // Adapted H against the symmetrized matrix elements
+  auto H = macis::make_spin_flip_csr_hamiltonian<int32_t>(
+      sf_dets.begin(), sf_dets.end(), ham_gen, 1e-16);
+  REQUIRE(H.m() == nsf);
+  REQUIRE(H.n() == nsf);
+  for(size_t i = 0; i < nsf; ++i) {
+    for(auto k = H.rowptr()[i]; k < H.rowptr()[i + 1]; ++k) {
+      const auto j = H.colind()[k];
+      if(k > H.rowptr()[i]) REQUIRE(j > H.colind()[k - 1]);
+      REQUIRE(H.nzval()[k] ==
+              Approx(ham_gen.spin_flip_matrix_element(sf_dets[i], sf_dets[j]))
+                  .margin(1e-14));
+    }
+  }
+
+  // Expectation value is preserved
+  auto expval = [](const auto& A, const std::vector<double>& x) {
+    double e = 0.;
+    for(size_t i = 0; i < A.m(); ++i)
+      for(auto k = A.rowptr()[i]; k < A.rowptr()[i + 1]; ++k)
+        e += x[i] * A.nzval()[k] * x[A.colind()[k]];
+    return e;
+  };
+  auto H_full = macis::make_csr_hamiltonian<int32_t>(
+      unf_dets.begin(), unf_dets.end(), ham_gen, 1e-16);
+  REQUIRE(expval(H, sf_C) == Approx(expval(H_full, unf_C)));
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+}
+
+TEST_CASE("Hamiltonian Cache", "[ham_gen]") {
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::SortedDoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+
+  const std::string prefix = "macis_ut_ham_cache.bin";
+#ifdef MACIS_ENABLE_MPI
+  const auto fname =
+      prefix + "." + std::to_string(macis::comm_rank(MPI_COMM_WORLD));
+#else
+  const auto fname = prefix;
 #endif
+
+  auto compare_csr = [](const auto& A, const auto& B) {
+    REQUIRE(A.m() == B.m());
+    REQUIRE(A.n() == B.n());
+    REQUIRE(A.nnz() == B.nnz());
+    REQUIRE(std::equal(A.rowptr().begin(), A.rowptr().end(),
+                       B.rowptr().begin()));
+    REQUIRE(std::equal(A.colind().begin(), A.colind().end(),
+                       B.colind().begin()));
+    REQUIRE(std::equal(A.nzval().begin(), A.nzval().end(),
+                       B.nzval().begin()));
+  };
+
+  for(bool upper : {false, true}) {
+    const auto key = macis::hamiltonian_cache_key(dets.begin(), dets.end(),
+                                                  ham_gen, 1e-16, upper);
+#ifdef MACIS_ENABLE_MPI
+    auto H = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, upper);
+#else
+    auto H = macis::make_csr_hamiltonian<int32_t>(dets.begin(), dets.end(),
+                                                  ham_gen, 1e-16, upper);
+#endif
+    macis::write_hamiltonian_cache(H, prefix, key);
+
+    // Stale caches are rejected
+    auto dets_perm = dets;
+    std::swap(dets_perm[1], dets_perm[2]);
+    REQUIRE(macis::hamiltonian_cache_key(dets_perm.begin(), dets_perm.end(),
+                                         ham_gen, 1e-16, upper) != key);
+    REQUIRE(macis::hamiltonian_cache_key(dets.begin(), dets.end(), ham_gen,
+                                         1e-16, not upper) != key);
+    REQUIRE_FALSE(macis::read_hamiltonian_cache<int32_t>(
+        MACIS_MPI_CODE(MPI_COMM_WORLD, ) prefix, key + 1));
+    REQUIRE_FALSE(macis::read_hamiltonian_cache<int64_t>(
+        MACIS_MPI_CODE(MPI_COMM_WORLD, ) prefix, key));
+    REQUIRE_FALSE(macis::read_hamiltonian_cache<int32_t>(
+        MACIS_MPI_CODE(MPI_COMM_WORLD, ) "macis_ut_no_cache.bin", key));
+
+    auto H_mapped = macis::read_hamiltonian_cache<int32_t>(
+        MACIS_MPI_CODE(MPI_COMM_WORLD, ) prefix, key);
+    REQUIRE(H_mapped);
+
+#ifdef MACIS_ENABLE_MPI
+    for(int i = 0; i < macis::comm_size(MPI_COMM_WORLD); ++i)
+      REQUIRE(H_mapped->row_bounds(i) == H.row_bounds(i));
+    compare_csr(H_mapped->diagonal_tile(), H.diagonal_tile());
+    REQUIRE(bool(H_mapped->off_diagonal_tile_ptr()) ==
+            bool(H.off_diagonal_tile_ptr()));
+    if(H.off_diagonal_tile_ptr())
+      compare_csr(H_mapped->off_diagonal_tile(), H.off_diagonal_tile());
+    const size_t nlocal = H.local_row_extent();
+#else
+    compare_csr(*H_mapped, H);
+    const size_t nlocal = H.m();
+#endif
+
+    // H*V directly on the mapped arrays
+    std::vector<double> X(nlocal), AX(nlocal), AX_mapped(nlocal);
+    for(size_t i = 0; i < nlocal; ++i) X[i] = std::cos(i % 31);
+    macis::SparseMatrixOperator op(H, upper);
+    macis::SparseMatrixOperator op_mapped(*H_mapped, upper);
+    op.operator_action(1, 1., X.data(), nlocal, 0., AX.data(), nlocal);
+    op_mapped.operator_action(1, 1., X.data(), nlocal, 0., AX_mapped.data(),
+                              nlocal);
+    for(size_t i = 0; i < nlocal; ++i) REQUIRE(AX_mapped[i] == Approx(AX[i]));
+    H_mapped.reset();
+
+    // Truncated files are rejected (on all ranks if any file is)
+    MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+#ifdef MACIS_ENABLE_MPI
+    if(macis::comm_rank(MPI_COMM_WORLD) == 0)
+#endif
+    {
+      std::ifstream in(fname, std::ios::binary);
+      std::string bytes((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+      in.close();
+      std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+      out.write(bytes.data(), bytes.size() / 2);
+    }
+    MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+    REQUIRE_FALSE(macis::read_hamiltonian_cache<int32_t>(
+        MACIS_MPI_CODE(MPI_COMM_WORLD, ) prefix, key));
+  }
+
+  // Selected CI from a generated and a mapped H
+  std::remove(fname.c_str());
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+  spdlog::null_logger_mt("davidson");
+  spdlog::null_logger_mt("ci_solver");
+  std::vector<double> C;
+  auto E_ref = macis::selected_ci_diag<64, int32_t>(
+      dets.begin(), dets.end(), ham_gen, 1e-16, 20, 1e-8,
+      C MACIS_MPI_CODE(, MPI_COMM_WORLD));
+  for(int i = 0; i < 3; ++i) {
+    // The cache is only written on request
+    const bool write = i > 0;
+    macis::SelectedCIOptions opts;
+    opts.ham_cache = prefix;
+    opts.write_ham_cache = write;
+    C.clear();
+    auto E = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 20, 1e-8,
+        C MACIS_MPI_CODE(, MPI_COMM_WORLD), opts);
+    REQUIRE(E == Approx(E_ref));
+    REQUIRE(std::ifstream(fname).good() == write);
+    REQUIRE_FALSE(std::ifstream(fname + ".tmp").good());
+  }
+  spdlog::drop_all();
+
+  std::remove(fname.c_str());
+  MACIS_MPI_CODE(MPI_Barrier(MPI_COMM_WORLD);)
+}
@@ -11,7 +11,10 @@
 #include <macis/csr_hamiltonian.hpp>
 #include <macis/hamiltonian_generator/double_loop.hpp>
 #include <macis/solvers/davidson.hpp>
+#include <macis/solvers/direct_hamiltonian_operator.hpp>
+#include <macis/solvers/mixed_precision_operator.hpp>
 #include <macis/util/fcidump.hpp>
+#include <sparsexx/matrix_types/compressed_csr_matrix.hpp>
 #include <sparsexx/util/submatrix.hpp>
 
 #include "ut_common.hpp"
@@ -66,6 +69,85 @@ TEST_CASE("Davidson") {
     sparsexx::spblas::gespmbv(1, 1., H, X.data(), H.n(), 0., AX.data(), H.n());
     REQUIRE(blas::dot(X.size(), X.data(), 1, AX.data(), 1) == Approx(E0));
   }
+
+  SECTION("Direct Operator") {
+    macis::DirectHamiltonianOperator<64> op(dets.begin(), dets.end(), ham_gen,
+                                            1e-16);
+    auto D = op.diagonal();
+    auto D_ref = sparsexx::extract_diagonal_elements(H);
+    REQUIRE(D.size() == D_ref.size());
+    for(size_t i = 0; i < D.size(); ++i) REQUIRE(D[i] == Approx(D_ref[i]));
+
+    std::vector<double> X(H.n());
+    macis::diagonal_guess(H.n(), H, X.data());
+    auto [niter, E0] =
+        macis::davidson(H.n(), 15, op, D.data(), 1e-8, X.data());
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
+
+  SECTION("Upper Triangle") {
+    auto H_upper = macis::make_csr_hamiltonian<int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, true);
+    std::vector<double> X(H.n());
+    macis::diagonal_guess(H.n(), H_upper, X.data());
+    auto D = sparsexx::extract_diagonal_elements(H_upper);
+    auto [niter, E0] =
+        macis::davidson(H.n(), 15, macis::SparseMatrixOperator(H_upper, true),
+                        D.data(), 1e-8, X.data());
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
+
+  SECTION("Compressed Column Indices") {
+    sparsexx::compressed_csr_matrix<double, int32_t> H_cmp(H);
+    REQUIRE(H_cmp.mem_footprint() < H.mem_footprint());
+
+    // Converting from an rvalue releases the source
+    auto H_src = H;
+    sparsexx::compressed_csr_matrix<double, int32_t> H_mv(std::move(H_src));
+    REQUIRE(H_mv.mem_footprint() == H_cmp.mem_footprint());
+    REQUIRE(H_src.mem_footprint() == 0);
+
+    std::vector<double> X(H.n());
+    macis::diagonal_guess(H.n(), H_cmp, X.data());
+    auto D = sparsexx::extract_diagonal_elements(H_cmp);
+    auto [niter, E0] =
+        macis::davidson(H.n(), 15, macis::SparseMatrixOperator(H_cmp),
+                        D.data(), 1e-8, X.data());
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
+
+  SECTION("Mixed Precision") {
+    macis::MixedPrecisionMatrixOperator op(H);
+    auto D = op.diagonal();
+    auto D_ref = sparsexx::extract_diagonal_elements(H);
+    REQUIRE(D.size() == D_ref.size());
+    for(size_t i = 0; i < D.size(); ++i) REQUIRE(D[i] == D_ref[i]);
+
+    // SpMV against the full precision matrix
+    std::vector<double> X(H.n()), AX(H.n()), AX_ref(H.n());
+    for(size_t i = 0; i < X.size(); ++i) X[i] = std::cos(double(i));
+    op.operator_action(1, 2., X.data(), H.n(), 0., AX.data(), H.n());
+    sparsexx::spblas::gespmbv(1, 2., H, X.data(), H.n(), 0., AX_ref.data(),
+                              H.n());
+    for(size_t i = 0; i < X.size(); ++i)
+      REQUIRE(AX[i] == Approx(AX_ref[i]).epsilon(1e-5));
+
+    // Generating H by blocks of rows reproduces the converted operator
+    auto op_gen = macis::make_mixed_precision_hamiltonian<int32_t>(
+        MACIS_MPI_CODE(MPI_COMM_SELF, ) dets.begin(), dets.end(), ham_gen,
+        1e-16);
+    REQUIRE(op_gen.nnz() == op.nnz());
+    REQUIRE(op_gen.diagonal() == D);
+    std::vector<double> AX_gen(H.n());
+    op_gen.operator_action(1, 2., X.data(), H.n(), 0., AX_gen.data(), H.n());
+    for(size_t i = 0; i < X.size(); ++i) REQUIRE(AX_gen[i] == Approx(AX[i]));
+
+    std::fill(X.begin(), X.end(), 0.);
+    macis::diagonal_guess(H.n(), H, X.data());
+    auto [niter, E0] =
+        macis::davidson(H.n(), 15, op, D.data(), 1e-5, X.data());
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
   spdlog::drop_all();
 }
 
@@ -130,6 +212,109 @@ TEST_CASE("Parallel Davidson") {
     REQUIRE(inner == Approx(E0));
   }
 
+  SECTION("Direct Operator") {
+    macis::DirectHamiltonianOperator<64> op(MPI_COMM_WORLD, dets.begin(),
+                                            dets.end(), ham_gen, 1e-16);
+    REQUIRE(op.local_row_extent() == H.local_row_extent());
+    auto D_local = op.diagonal();
+
+    std::vector<double> X_local(H.local_row_extent());
+    macis::p_diagonal_guess(X_local.size(), H, X_local.data());
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, op, D_local.data(), 1e-8,
+                          X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
+
+  SECTION("Upper Triangle") {
+    auto H_upper = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, true);
+    macis::SparseMatrixOperator op(H_upper, true);
+
+    // Symmetric SpMV against the full matrix
+    std::vector<double> X_local(H.local_row_extent()),
+        AX_local(X_local.size()), AX_ref(X_local.size());
+    for(size_t i = 0; i < X_local.size(); ++i)
+      X_local[i] = std::cos(double(i + H.local_row_start()));
+    op.operator_action(1, 2., X_local.data(), X_local.size(), 0.,
+                       AX_local.data(), X_local.size());
+    sparsexx::spblas::pgespmv(2., H, X_local.data(), 0., AX_ref.data(),
+                              spmv_info);
+    for(size_t i = 0; i < X_local.size(); ++i)
+      REQUIRE(AX_local[i] == Approx(AX_ref[i]));
+
+    std::fill(X_local.begin(), X_local.end(), 0.);
+    macis::p_diagonal_guess(X_local.size(), H_upper, X_local.data());
+    auto D_local =
+        sparsexx::extract_diagonal_elements(H_upper.diagonal_tile());
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, op, D_local.data(), 1e-8,
+                          X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
+
+  SECTION("Compressed Column Indices") {
+    using compressed_type = sparsexx::dist_sparse_matrix<
+        sparsexx::compressed_csr_matrix<double, int32_t>>;
+    auto H_upper = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, true);
+    for(bool upper : {false, true}) {
+      // Move from a copy of H to exercise the releasing conversion
+      auto H_src = upper ? H_upper : H;
+      compressed_type H_cmp(std::move(H_src));
+      REQUIRE(H_src.diagonal_tile().mem_footprint() == 0);
+      REQUIRE(H_cmp.local_row_extent() == H.local_row_extent());
+
+      std::vector<double> X_local(H.local_row_extent());
+      macis::p_diagonal_guess(X_local.size(), H_cmp, X_local.data());
+      auto D_local =
+          sparsexx::extract_diagonal_elements(H_cmp.diagonal_tile());
+      auto [niter, E0] = macis::p_davidson(
+          X_local.size(), 15, macis::SparseMatrixOperator(H_cmp, upper),
+          D_local.data(), 1e-8, X_local.data(), MPI_COMM_WORLD);
+      REQUIRE(E0 + E_core == Approx(E0_ref));
+    }
+  }
+
+  SECTION("Mixed Precision") {
+    macis::MixedPrecisionMatrixOperator op(H);
+    auto D_local = op.diagonal();
+    auto D_ref = sparsexx::extract_diagonal_elements(H.diagonal_tile());
+    REQUIRE(D_local.size() == D_ref.size());
+    for(size_t i = 0; i < D_local.size(); ++i)
+      REQUIRE(D_local[i] == D_ref[i]);
+
+    // SpMV against the full precision matrix
+    std::vector<double> X_local(H.local_row_extent()),
+        AX_local(X_local.size()), AX_ref(X_local.size());
+    for(size_t i = 0; i < X_local.size(); ++i)
+      X_local[i] = std::cos(double(i + H.local_row_start()));
+    op.operator_action(1, 2., X_local.data(), X_local.size(), 0.,
+                       AX_local.data(), X_local.size());
+    sparsexx::spblas::pgespmv(2., H, X_local.data(), 0., AX_ref.data(),
+                              spmv_info);
+    for(size_t i = 0; i < X_local.size(); ++i)
+      REQUIRE(AX_local[i] == Approx(AX_ref[i]).epsilon(1e-5));
+
+    // Generating H by blocks of rows reproduces the converted operator
+    auto op_gen = macis::make_mixed_precision_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+    REQUIRE(op_gen.nnz() == op.nnz());
+    REQUIRE(op_gen.diagonal() == D_local);
+    std::vector<double> AX_gen(X_local.size());
+    op_gen.operator_action(1, 2., X_local.data(), X_local.size(), 0.,
+                           AX_gen.data(), X_local.size());
+    for(size_t i = 0; i < X_local.size(); ++i)
+      REQUIRE(AX_gen[i] == Approx(AX_local[i]));
+
+    std::fill(X_local.begin(), X_local.end(), 0.);
+    macis::p_diagonal_guess(X_local.size(), H, X_local.data());
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, op, D_local.data(), 1e-5,
+                          X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
+
   MPI_Barrier(MPI_COMM_WORLD);
   spdlog::drop_all();
 }
@@ -8,9 +8,12 @@
 
 #include <iomanip>
 #include <iostream>
+#include <macis/csr_hamiltonian.hpp>
 #include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/sorted_double_loop.hpp>
 #include <macis/util/fcidump.hpp>
 #include <macis/wavefunction_io.hpp>
+#include <numeric>
 
 #include "ut_common.hpp"
 
@@ -177,7 +180,11 @@ TEST_CASE("Double Loop") {
   }
 }
 
-TEST_CASE("RDMS") {
+TEMPLATE_TEST_CASE("RDMS", "[ham_gen]",
+                   macis::DoubleLoopHamiltonianGenerator<128>,
+                   macis::SortedDoubleLoopHamiltonianGenerator<128>,
+                   macis::DoubleLoopHamiltonianGenerator<256>,
+                   macis::SortedDoubleLoopHamiltonianGenerator<256>) {
   ROOT_ONLY(MPI_COMM_WORLD);
 
   auto norb = 34;
@@ -194,14 +201,15 @@ TEST_CASE("RDMS") {
   macis::rank4_span<double> V_span(V.data(), norb, norb, norb, norb);
   macis::rank4_span<double> trdm_span(trdm.data(), norb, norb, norb, norb);
 
-  using generator_type = macis::DoubleLoopHamiltonianGenerator<128>;
+  using generator_type = TestType;
+  constexpr auto nbits = generator_type::nbits;
   generator_type ham_gen(T_span, V_span);
 
   auto abs_sum = [](auto a, auto b) { return a + std::abs(b); };
 
   SECTION("HF") {
-    std::vector<std::bitset<128>> dets = {
-        macis::canonical_hf_determinant<128>(nocc, nocc)};
+    std::vector<std::bitset<nbits>> dets = {
+        macis::canonical_hf_determinant<nbits>(nocc, nocc)};
 
     std::vector<double> C = {1.};
 
@@ -224,9 +232,9 @@ TEST_CASE("RDMS") {
   }
 
   SECTION("CI") {
-    std::vector<std::bitset<128>> states;
+    std::vector<std::bitset<nbits>> states;
     std::vector<double> coeffs;
-    macis::read_wavefunction<128>(ch4_wfn_fname, states, coeffs);
+    macis::read_wavefunction<nbits>(ch4_wfn_fname, states, coeffs);
 
     coeffs.resize(5000);
     states.resize(5000);
@@ -271,3 +279,254 @@ TEST_CASE("RDMS") {
 #endif
   }
 }
+
+TEST_CASE("Alpha-Sorted Determinant Store", "[ham_gen]") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  auto norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const auto norb2 = norb * norb;
+  const auto norb4 = norb2 * norb2;
+  const size_t nocc = 5;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+  macis::matrix_span<double> T_span(T.data(), norb, norb);
+  macis::rank4_span<double> V_span(V.data(), norb, norb, norb, norb);
+
+  // Unsorted configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  std::reverse(dets.begin(), dets.end());
+  std::rotate(dets.begin(), dets.begin() + dets.size() / 3, dets.end());
+  const size_t ndets = dets.size();
+
+  macis::alpha_sorted_dets<64> store(dets.begin(), dets.end());
+
+  SECTION("Layout") {
+    REQUIRE(store.ndets == ndets);
+    REQUIRE(store.nnonzero() == ndets);
+    REQUIRE(store.alpha_ptr.size() == store.ngroups() + 1);
+    REQUIRE(store.alpha_ptr.back() == ndets);
+
+    std::vector<int> visited(ndets, 0);
+    for(size_t g = 0; g < store.ngroups(); ++g) {
+      if(g) REQUIRE(macis::bitset_less(store.alpha[g - 1], store.alpha[g]));
+      REQUIRE(store.alpha_occ[g] == macis::bits_to_indices(store.alpha[g]));
+      REQUIRE(store.alpha_det(g) ==
+              (dets[store.index[store.alpha_ptr[g]]] &
+               macis::full_mask<32, 64>()));
+      for(size_t i = store.alpha_ptr[g]; i < store.alpha_ptr[g + 1]; ++i) {
+        if(i > store.alpha_ptr[g])
+          REQUIRE(macis::bitset_less(store.beta[i - 1], store.beta[i]));
+        const auto det = dets[store.index[i]];
+        REQUIRE(macis::bitset_lo_word(det) == store.alpha[g]);
+        REQUIRE(macis::bitset_hi_word(det) == store.beta[i]);
+        visited[store.index[i]]++;
+      }
+    }
+    REQUIRE(std::all_of(visited.begin(), visited.end(),
+                        [](int v) { return v == 1; }));
+  }
+
+  SECTION("Shared Store") {
+    macis::DoubleLoopHamiltonianGenerator<64> ref_gen(T_span, V_span);
+    macis::SortedDoubleLoopHamiltonianGenerator<64> ham_gen(T_span, V_span);
+
+    auto H_ref = ref_gen.make_csr_hamiltonian_block<int32_t>(
+        dets.begin(), dets.end(), dets.begin(), dets.end(), 1e-16);
+    auto H = ham_gen.make_csr_hamiltonian_block<int32_t>(store, store, 1e-16);
+    REQUIRE(H.rowptr() == H_ref.rowptr());
+    REQUIRE(H.colind() == H_ref.colind());
+    for(size_t i = 0; i < H.nnz(); ++i)
+      REQUIRE(H.nzval()[i] == Approx(H_ref.nzval()[i]));
+
+    std::vector<double> C(ndets);
+    for(size_t i = 0; i < ndets; ++i) C[i] = 1. / (1. + i);
+
+    std::vector<double> ordm(norb2, 0.), trdm(norb4, 0.);
+    std::vector<double> ordm_ref(norb2, 0.), trdm_ref(norb4, 0.);
+    ham_gen.form_rdms(store, store, C.data(),
+                      macis::matrix_span<double>(ordm.data(), norb, norb),
+                      macis::rank4_span<double>(trdm.data(), norb, norb, norb,
+                                                norb));
+    ref_gen.form_rdms(
+        dets.begin(), dets.end(), dets.begin(), dets.end(), C.data(),
+        macis::matrix_span<double>(ordm_ref.data(), norb, norb),
+        macis::rank4_span<double>(trdm_ref.data(), norb, norb, norb, norb));
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref[i]).margin(1e-12));
+  }
+
+  SECTION("Reorder / Prefix") {
+    REQUIRE(store.unpack() == dets);
+
+    // Reorder the determinants and follow it in the store
+    REQUIRE(std::gcd(size_t(7), ndets) == 1);
+    std::vector<uint64_t> idx(ndets);
+    for(size_t i = 0; i < ndets; ++i) idx[i] = (7 * i + 3) % ndets;
+    std::vector<macis::wfn_t<64>> dets_reordered(ndets);
+    for(size_t i = 0; i < ndets; ++i) dets_reordered[i] = dets[idx[i]];
+    auto store_reordered = store;
+    store_reordered.reorder(idx);
+    macis::alpha_sorted_dets<64> store_ref(dets_reordered.begin(),
+                                           dets_reordered.end());
+    REQUIRE(store_reordered.alpha == store_ref.alpha);
+    REQUIRE(store_reordered.alpha_ptr == store_ref.alpha_ptr);
+    REQUIRE(store_reordered.beta == store_ref.beta);
+    REQUIRE(store_reordered.index == store_ref.index);
+    REQUIRE(store_reordered.unpack() == dets_reordered);
+    REQUIRE_THROWS(store_reordered.reorder(std::vector<uint64_t>(3)));
+
+    const size_t nkeep = ndets / 3;
+    auto sub = store.prefix(nkeep);
+    macis::alpha_sorted_dets<64> sub_ref(dets.begin(), dets.begin() + nkeep);
+    REQUIRE(sub.ndets == nkeep);
+    REQUIRE(sub.alpha == sub_ref.alpha);
+    REQUIRE(sub.alpha_ptr == sub_ref.alpha_ptr);
+    REQUIRE(sub.beta == sub_ref.beta);
+    REQUIRE(sub.index == sub_ref.index);
+    REQUIRE(sub.alpha_occ == sub_ref.alpha_occ);
+  }
+
+  SECTION("Excitation Data") {
+    macis::DoubleLoopHamiltonianGenerator<64> ham_gen(T_span, V_span);
+    REQUIRE_FALSE(store.has_excitation_data());
+    store.compute_excitation_data(norb, ham_gen);
+    REQUIRE(store.has_excitation_data());
+
+    std::vector<uint32_t> occ, vir, bocc, bvir;
+    for(size_t g = 0; g < store.ngroups(); ++g) {
+      macis::bitset_to_occ_vir(norb, store.alpha[g], occ, vir);
+      REQUIRE(store.alpha_vir[g] == vir);
+      for(size_t i = store.alpha_ptr[g]; i < store.alpha_ptr[g + 1]; ++i) {
+        macis::bitset_to_occ_vir(norb, store.beta[i], bocc, bvir);
+        REQUIRE(store.beta_occ[i] == bocc);
+        REQUIRE(store.beta_vir[i] == bvir);
+        REQUIRE(store.orb_ens_alpha[i] ==
+                ham_gen.single_orbital_ens(norb, occ, bocc));
+        REQUIRE(store.orb_ens_beta[i] ==
+                ham_gen.single_orbital_ens(norb, bocc, occ));
+        const auto& det = dets[store.index[i]];
+        REQUIRE(store.h_diag[i] == Approx(ham_gen.matrix_element(det, det)));
+      }
+    }
+  }
+
+  SECTION("Generator Interface") {
+    macis::DoubleLoopHamiltonianGenerator<64> ref_gen(T_span, V_span);
+    macis::SortedDoubleLoopHamiltonianGenerator<64> sorted_gen(T_span, V_span);
+
+    auto check = [](const auto& A, const auto& A_ref) {
+      REQUIRE(A.m() == A_ref.m());
+      REQUIRE(A.n() == A_ref.n());
+      REQUIRE(A.rowptr() == A_ref.rowptr());
+      REQUIRE(A.colind() == A_ref.colind());
+      for(size_t i = 0; i < A.nnz(); ++i)
+        REQUIRE(A.nzval()[i] == Approx(A_ref.nzval()[i]));
+    };
+
+    // Full matrix (and upper triangle) through the base class, for both the
+    // default (unpacking) and the sorted implementation
+    for(bool upper : {false, true}) {
+      auto H_ref = macis::make_csr_hamiltonian<int32_t>(
+          dets.begin(), dets.end(), ref_gen, 1e-16, upper);
+      for(macis::HamiltonianGenerator<64>* gen :
+          std::vector<macis::HamiltonianGenerator<64>*>{&ref_gen,
+                                                        &sorted_gen}) {
+        check(macis::make_csr_hamiltonian<int32_t>(store, *gen, 1e-16, upper),
+              H_ref);
+      }
+    }
+
+    // Block of rows
+    const size_t row_st = ndets / 4, row_en = ndets / 2;
+    auto H_rows_ref = macis::make_csr_hamiltonian_block<int32_t>(
+        dets.begin() + row_st, dets.begin() + row_en, dets.begin(), dets.end(),
+        ref_gen, 1e-16);
+    check(sorted_gen.make_csr_hamiltonian_rows<int32_t>(store, row_st, row_en,
+                                                        1e-16),
+          H_rows_ref);
+    check(ref_gen.make_csr_hamiltonian_rows<int32_t>(store, row_st, row_en,
+                                                     1e-16),
+          H_rows_ref);
+
+    // RDMs through the default (unpacking) implementation
+    std::vector<double> C(ndets);
+    for(size_t i = 0; i < ndets; ++i) C[i] = 1. / (1. + i);
+    std::vector<double> ordm(norb2, 0.), trdm(norb4, 0.);
+    std::vector<double> ordm_ref(norb2, 0.), trdm_ref(norb4, 0.);
+    macis::HamiltonianGenerator<64>& base_gen = ref_gen;
+    base_gen.form_rdms(store, store, C.data(),
+                       macis::matrix_span<double>(ordm.data(), norb, norb),
+                       macis::rank4_span<double>(trdm.data(), norb, norb,
+                                                 norb, norb));
+    ref_gen.form_rdms(
+        dets.begin(), dets.end(), dets.begin(), dets.end(), C.data(),
+        macis::matrix_span<double>(ordm_ref.data(), norb, norb),
+        macis::rank4_span<double>(trdm_ref.data(), norb, norb, norb, norb));
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref[i]).margin(1e-12));
+  }
+}
+
+TEST_CASE("Heat-Bath Doubles", "[ham_gen]") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  auto norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const auto norb2 = norb * norb;
+  const auto norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+  macis::DoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // (pq|rs)
+  auto eri = [&](size_t p, size_t q, size_t r, size_t s) {
+    return V[p + q * norb + (r + s * norb) * norb2];
+  };
+
+  // Compare the list of (i,j) to all brute force excitations ij -> ab with
+  // an integral >= tol
+  auto check_list = [&](double tol, auto begin, auto end, auto&& integral) {
+    std::vector<int> visited(norb2, 0);
+    for(auto it = begin; it != end; ++it) {
+      if(it != begin) REQUIRE(std::abs((it - 1)->val) >= std::abs(it->val));
+      REQUIRE(it->val == Approx(integral(it->a, it->b)));
+      visited[it->a * norb + it->b]++;
+    }
+    for(size_t a = 0; a < norb; ++a)
+      for(size_t b = 0; b < norb; ++b) {
+        const double val = integral(a, b);
+        REQUIRE(visited[a * norb + b] == (val != 0. and std::abs(val) >= tol));
+      }
+  };
+
+  for(double tol : {0., 1e-4, 1e-2}) {
+    const auto& hb = ham_gen.heat_bath(tol);
+    REQUIRE(hb.tol == tol);
+    for(size_t i = 0; i < norb; ++i)
+      for(size_t j = 0; j < norb; ++j) {
+        // Same spin: i < j, a < b, all distinct
+        check_list(tol, hb.ss_begin(i, j), hb.ss_end(i, j),
+                   [&](size_t a, size_t b) {
+                     if(j <= i or b <= a) return 0.;
+                     if(a == i or a == j or b == i or b == j) return 0.;
+                     return eri(a, i, b, j) - eri(a, j, b, i);
+                   });
+        // Opposite spin: i alpha -> a alpha, j beta -> b beta
+        check_list(tol, hb.os_begin(i, j), hb.os_end(i, j),
+                   [&](size_t a, size_t b) {
+                     if(a == i or b == j) return 0.;
+                     return eri(a, i, b, j);
+                   });
+      }
+  }
+}
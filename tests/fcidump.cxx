@@ -6,6 +6,8 @@
  * See LICENSE.txt for details
  */
 
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <macis/util/fcidump.hpp>
@@ -16,6 +18,39 @@
 TEST_CASE("FCIDUMP") {
   ROOT_ONLY(MPI_COMM_WORLD);
 
+  SECTION("Header") {
+    // No header
+    REQUIRE(macis::read_fcidump_orbsym(water_ccpvdz_fcidump).empty());
+    REQUIRE(macis::read_fcidump_isym(water_ccpvdz_fcidump) == 0);
+
+    // Multi-line namelist header
+    std::string fname = "macis_ut_header.fcidump";
+    {
+      std::ofstream file(fname);
+      file << " &FCI NORB=  4,NELEC=4,MS2=0,\n"
+           << "  ORBSYM=1,3, 4,\n"
+           << "  1,\n"
+           << "  ISYM=3,\n"
+           << " &END\n"
+           << "  1.5  1 1 1 1\n"
+           << "  0.5  4 4 3 3\n"
+           << " -1.0  2 1 0 0\n"
+           << "  2.0  0 0 0 0\n";
+    }
+
+    std::vector<uint32_t> ref_orbsym = {0, 2, 3, 0};
+    REQUIRE(macis::read_fcidump_orbsym(fname) == ref_orbsym);
+    REQUIRE(macis::read_fcidump_isym(fname) == 2);
+    REQUIRE(macis::read_fcidump_norb(fname) == 4);
+    REQUIRE(macis::read_fcidump_core(fname) == Approx(2.0));
+
+    std::vector<double> T(16);
+    macis::read_fcidump_1body(fname, T.data(), 4);
+    REQUIRE(T[1] == Approx(-1.0));
+    REQUIRE(T[4] == Approx(-1.0));
+    std::remove(fname.c_str());
+  }
+
   SECTION("READ") {
     size_t norb_ref = 24;
     SECTION("NORB") {
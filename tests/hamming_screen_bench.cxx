@@ -0,0 +1,95 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+// Microbenchmark of the Hamming distance screening of determinant pairs
+//
+// Usage: hamming_screen_bench [NDETS] [NBRA]
+//
+// Screens NBRA bras against NDETS random 128-bit determinants (blocks of
+// 4096 kets, max distance 4, single thread) with the std::bitset loop the
+// screening replaces and with each compiled path of macis::hamming_screen.
+// The SIMD paths are only available if the benchmark is compiled for them
+// (e.g. -march=native).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <macis/hamming_screen.hpp>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using clock_type = std::chrono::high_resolution_clock;
+using duration_type = std::chrono::duration<double>;
+
+constexpr size_t nbits = 128;
+constexpr size_t block = 4096;
+
+int main(int argc, char** argv) {
+  const size_t ndets = argc > 1 ? std::atol(argv[1]) : (1ul << 22);
+  const size_t nbra = argc > 2 ? std::atol(argv[2]) : 200;
+
+  // Random determinants (10 alpha + 10 beta electrons in 64 orbitals)
+  std::default_random_engine gen(155039);
+  std::vector<std::bitset<nbits>> dets(ndets);
+  std::vector<uint32_t> orbs(nbits / 2);
+  std::iota(orbs.begin(), orbs.end(), 0);
+  for(auto& det : dets) {
+    for(size_t spin = 0; spin < 2; ++spin) {
+      std::shuffle(orbs.begin(), orbs.end(), gen);
+      for(size_t i = 0; i < 10; ++i) det.set(orbs[i] + spin * nbits / 2);
+    }
+  }
+
+  auto st = clock_type::now();
+  const macis::bitset_soa<nbits> kets(dets.begin(), dets.end());
+  duration_type soa_dur = clock_type::now() - st;
+  std::printf("NDETS = %zu, NBRA = %zu, SOA_BUILD = %.3e s\n", ndets, nbra,
+              soa_dur.count());
+
+  std::vector<uint32_t> cand(block);
+
+  // Baseline: popcount of std::bitset XOR, one ket at a time
+  size_t ncand_ref = 0;
+  st = clock_type::now();
+  for(size_t i = 0; i < nbra; ++i) {
+    const auto bra = dets[i];
+    for(size_t j = 0; j < ndets; ++j)
+      ncand_ref += (bra ^ dets[j]).count() <= 4;
+  }
+  duration_type ref_dur = clock_type::now() - st;
+  std::printf("  %-8s %.3e s (NCAND = %zu)\n", "bitset", ref_dur.count(),
+              ncand_ref);
+
+  using macis::hamming_isa;
+  const std::pair<hamming_isa, const char*> isas[] = {
+      {hamming_isa::scalar, "scalar"},
+      {hamming_isa::avx2, "avx2"},
+      {hamming_isa::avx512, "avx512"}};
+  for(auto [isa, name] : isas) {
+    if(not macis::hamming_isa_available(isa)) {
+      std::printf("  %-8s not compiled\n", name);
+      continue;
+    }
+    size_t ncand = 0;
+    st = clock_type::now();
+    for(size_t i = 0; i < nbra; ++i) {
+      for(size_t j = 0; j < ndets; j += block)
+        ncand += macis::hamming_screen(dets[i], kets, j,
+                                       std::min(j + block, ndets), 4,
+                                       cand.data(), isa);
+    }
+    duration_type dur = clock_type::now() - st;
+    std::printf("  %-8s %.3e s (NCAND = %zu)%s\n", name, dur.count(), ncand,
+                ncand == ncand_ref ? "" : " MISMATCH");
+    if(ncand != ncand_ref) return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -235,6 +235,32 @@ TEST_CASE("Slater Det Operations") {
       auto dets = macis::generate_hilbert_space<64>(4, 2, 2);
       REQUIRE(dets == ref_dets);
     }
+
+    SECTION("Point Group Symmetry") {
+      std::vector<uint32_t> orbsym = {0, 1, 2, 0};
+      auto all_dets = macis::generate_hilbert_space<64>(4, 2, 2);
+
+      // Irreps of spin strings and determinants (direct product == XOR)
+      REQUIRE(macis::spin_string_irrep(std::bitset<32>(0x6), orbsym) == 3);
+      REQUIRE(macis::det_irrep(std::bitset<64>(0x300000005), orbsym) == 3);
+
+      size_t ndets = 0;
+      for(uint32_t irrep = 0; irrep < 4; ++irrep) {
+        auto dets =
+            macis::generate_hilbert_space<64>(4, 2, 2, orbsym, irrep);
+        std::vector<std::bitset<64>> ref_dets;
+        std::copy_if(all_dets.begin(), all_dets.end(),
+                     std::back_inserter(ref_dets), [&](auto d) {
+                       return macis::det_irrep(d, orbsym) == irrep;
+                     });
+        REQUIRE(dets == ref_dets);
+        ndets += dets.size();
+      }
+      REQUIRE(ndets == all_dets.size());
+
+      // No symmetry
+      REQUIRE(macis::generate_hilbert_space<64>(4, 2, 2, {}, 0) == all_dets);
+    }
   }
 
   SECTION("String Conversions") {
@@ -17,6 +17,7 @@
 #include <macis/asci/grow.hpp>
 #include <macis/asci/refine.hpp>
 #include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/sorted_double_loop.hpp>
 #include <macis/util/cas.hpp>
 #include <macis/util/detail/rdm_files.hpp>
 #include <macis/util/fcidump.hpp>
@@ -27,6 +28,7 @@
 #include <macis/util/transform.hpp>
 #include <macis/wavefunction_io.hpp>
 #include <map>
+#include <memory>
 #include <sparsexx/io/write_dist_mm.hpp>
 
 #include "ini_input.hpp"
@@ -61,9 +63,16 @@ int main(int argc, char** argv) {
   spdlog::cfg::load_env_levels();
   spdlog::set_pattern("[%n] %v");
 
+  // Determinant width of CAS expansions, ASCI selects the width from the
+  // size of the active space (up to max_wfn_bits)
   constexpr size_t nwfn_bits = 64;
+  constexpr size_t max_wfn_bits = 256;
 
-  MACIS_MPI_CODE(MPI_Init(&argc, &argv);)
+#ifdef MACIS_ENABLE_MPI
+  // Dynamic ASCI constraints are fetched by all threads (one at a time)
+  int thread_level;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &thread_level);
+#endif
 
 #ifdef MACIS_ENABLE_MPI
   auto world_rank = macis::comm_rank(MPI_COMM_WORLD);
@@ -146,7 +155,10 @@ int main(int argc, char** argv) {
     OPT_KEYWORD("CI.RDMFILE", rdm_fname, std::string);
     OPT_KEYWORD("CI.FCIDUMP_OUT", fci_out_fname, std::string);
 
-    if(n_active > nwfn_bits / 2) throw std::runtime_error("Not Enough Bits");
+    if(n_active > max_wfn_bits / 2) throw std::runtime_error("Not Enough Bits");
+    if(n_active > nwfn_bits / 2 and
+       not(job == Job::CI and ci_exp == CIExpansion::ASCI))
+      throw std::runtime_error("Not Enough Bits");
 
     // MCSCF Settings
     macis::MCSCFSettings mcscf_settings;
@@ -164,6 +176,17 @@ int main(int argc, char** argv) {
     OPT_KEYWORD("MCSCF.CI_RES_TOL", mcscf_settings.ci_res_tol, double);
     OPT_KEYWORD("MCSCF.CI_MAX_SUB", mcscf_settings.ci_max_subspace, size_t);
     OPT_KEYWORD("MCSCF.CI_MATEL_TOL", mcscf_settings.ci_matel_tol, double);
+    OPT_KEYWORD("MCSCF.CI_SORTED_HAM", mcscf_settings.ci_sorted_ham_gen, bool);
+    OPT_KEYWORD("MCSCF.CI_DIRECT", mcscf_settings.ci_direct_sigma, bool);
+    OPT_KEYWORD("MCSCF.CI_HAM_UPPER", mcscf_settings.ci_ham_upper_triangle,
+                bool);
+    OPT_KEYWORD("MCSCF.CI_MIXED_PREC", mcscf_settings.ci_mixed_precision, bool);
+    OPT_KEYWORD("MCSCF.CI_COMPRESS_COLIND", mcscf_settings.ci_compress_colind,
+                bool);
+    OPT_KEYWORD("MCSCF.CI_BALANCE_ROWS", mcscf_settings.ci_balance_rows, bool);
+    OPT_KEYWORD("MCSCF.CI_HAM_CACHE", mcscf_settings.ci_ham_cache, std::string);
+    OPT_KEYWORD("MCSCF.CI_HAM_CACHE_WRITE", mcscf_settings.ci_ham_cache_write,
+                bool);
 
     // ASCI Settings
     macis::ASCISettings asci_settings;
@@ -181,9 +204,18 @@ int main(int argc, char** argv) {
     OPT_KEYWORD("ASCI.REFINE_ETOL", asci_settings.refine_energy_tol, double);
     OPT_KEYWORD("ASCI.GROW_WITH_ROT", asci_settings.grow_with_rot, bool);
     OPT_KEYWORD("ASCI.ROT_SIZE_START", asci_settings.rot_size_start, size_t);
+    OPT_KEYWORD("ASCI.REUSE_HAM", asci_settings.reuse_hamiltonian, bool);
+    OPT_KEYWORD("ASCI.SPIN_FLIP", asci_settings.spin_flip, bool);
+    OPT_KEYWORD("ASCI.HASH_ACC", asci_settings.hash_accumulate, bool);
+    OPT_KEYWORD("ASCI.STREAM_TOP_K", asci_settings.stream_top_k, bool);
+    OPT_KEYWORD("ASCI.PAIR_MAX_MEM", asci_settings.pair_mem_max, size_t);
+    OPT_KEYWORD("ASCI.TOP_K_FACTOR", asci_settings.stream_top_k_factor,
+                double);
     // OPT_KEYWORD("ASCI.DIST_TRIP_RAND",  asci_settings.dist_triplet_random,
     // bool );
     OPT_KEYWORD("ASCI.CONSTRAINT_LVL", asci_settings.constraint_level, int);
+    OPT_KEYWORD("ASCI.DYNAMIC_CON", asci_settings.dynamic_constraints, bool);
+    OPT_KEYWORD("ASCI.HEAT_BATH", asci_settings.heat_bath, bool);
     OPT_KEYWORD("ASCI.WFN_FILE", asci_wfn_fname, std::string);
     OPT_KEYWORD("ASCI.WFN_OUT_FILE", asci_wfn_out_fname, std::string);
     if(input.containsData("ASCI.E0_WFN")) {
@@ -194,6 +226,25 @@ int main(int argc, char** argv) {
     bool mp2_guess = false;
     OPT_KEYWORD("MCSCF.MP2_GUESS", mp2_guess, bool);
 
+    // Point group symmetry (ORBSYM and ISYM of the FCIDUMP header)
+    bool use_orbsym = true;
+    OPT_KEYWORD("CI.USE_ORBSYM", use_orbsym, bool);
+    std::vector<uint32_t> orbsym;
+    uint32_t isym = 0;
+    if(use_orbsym) {
+      orbsym = macis::read_fcidump_orbsym(fcidump_fname);
+      isym = macis::read_fcidump_isym(fcidump_fname);
+    }
+    if(orbsym.size() and orbsym.size() != norb)
+      throw std::runtime_error("ORBSYM is of improper dimension");
+    // MP2 natural orbitals are ordered by occupation rather than by irrep
+    if(mp2_guess) orbsym.clear();
+    if(orbsym.size()) {
+      mcscf_settings.ci_orbsym.assign(orbsym.begin() + n_inactive,
+                                      orbsym.begin() + n_inactive + n_active);
+      mcscf_settings.ci_target_irrep = isym;
+    }
+
     if(!world_rank) {
       console->info("[Wavefunction Data]:");
       console->info("  * JOB     = {}", job_str);
@@ -202,6 +253,8 @@ int main(int argc, char** argv) {
       if(fci_out_fname.size())
         console->info("  * FCIDUMP_OUT = {}", fci_out_fname);
       console->info("  * MP2_GUESS = {}", mp2_guess);
+      console->info("  * ORBSYM    = {}", orbsym.size() ? "ON" : "OFF");
+      if(orbsym.size()) console->info("  * ISYM      = {}", isym + 1);
 
       console->debug("READ {} 1-body integrals and {} 2-body integrals",
                      T.size(), V.size());
@@ -298,7 +351,8 @@ int main(int argc, char** argv) {
           det_logger->info("Print leading determinants > {:.12f}",
                            determinants_threshold);
           auto dets = macis::generate_hilbert_space<generator_t::nbits>(
-              n_active, nalpha, nbeta);
+              n_active, nalpha, nbeta, mcscf_settings.ci_orbsym,
+              mcscf_settings.ci_target_irrep);
           for(size_t i = 0; i < dets.size(); ++i) {
             if(std::abs(C_local[i]) > determinants_threshold) {
               det_logger->info("{:>16.12f}   {}", C_local[i],
@@ -308,76 +362,120 @@ int main(int argc, char** argv) {
         }
 
       } else {
-        // Generate the Hamiltonian Generator
-        generator_t ham_gen(
-            macis::matrix_span<double>(T_active.data(), n_active, n_active),
-            macis::rank4_span<double>(V_active.data(), n_active, n_active,
-                                      n_active, n_active));
-
-        std::vector<macis::wfn_t<nwfn_bits>> dets;
-        std::vector<double> C;
-        if(asci_wfn_fname.size()) {
-          // Read wave function from standard file
-          console->info("Reading Guess Wavefunction From {}", asci_wfn_fname);
-          macis::read_wavefunction(asci_wfn_fname, dets, C);
-          // std::cout << dets[0].to_ullong() << std::endl;
-          if(compute_asci_E0) {
-            console->info("*  Calculating E0");
-            E0 = 0;
-            for(auto ii = 0; ii < dets.size(); ++ii) {
-              double tmp = 0.0;
-              for(auto jj = 0; jj < dets.size(); ++jj) {
-                tmp += ham_gen.matrix_element(dets[ii], dets[jj]) * C[jj];
+        // Select the determinant width from the size of the active space
+        auto run_asci = [&](auto nbits_tag) {
+          constexpr size_t nbits = decltype(nbits_tag)::value;
+          using generator_t = macis::DoubleLoopHamiltonianGenerator<nbits>;
+
+          // Generate the Hamiltonian Generator
+          using sorted_generator_t =
+              macis::SortedDoubleLoopHamiltonianGenerator<nbits>;
+          macis::matrix_span<double> T_span(T_active.data(), n_active,
+                                            n_active);
+          macis::rank4_span<double> V_span(V_active.data(), n_active, n_active,
+                                           n_active, n_active);
+          std::unique_ptr<macis::HamiltonianGenerator<nbits>> ham_gen_ptr;
+          if(mcscf_settings.ci_sorted_ham_gen)
+            ham_gen_ptr = std::make_unique<sorted_generator_t>(T_span, V_span);
+          else
+            ham_gen_ptr = std::make_unique<generator_t>(T_span, V_span);
+          auto& ham_gen = *ham_gen_ptr;
+          ham_gen.set_orbital_symmetry(mcscf_settings.ci_orbsym);
+
+          std::vector<macis::wfn_t<nbits>> dets;
+          std::vector<double> C;
+          if(asci_wfn_fname.size()) {
+            // Read wave function from standard file
+            console->info("Reading Guess Wavefunction From {}", asci_wfn_fname);
+            macis::read_wavefunction(asci_wfn_fname, dets, C);
+            // std::cout << dets[0].to_ullong() << std::endl;
+            if(compute_asci_E0) {
+              console->info("*  Calculating E0");
+              E0 = 0;
+              for(auto ii = 0; ii < dets.size(); ++ii) {
+                double tmp = 0.0;
+                for(auto jj = 0; jj < dets.size(); ++jj) {
+                  tmp += ham_gen.matrix_element(dets[ii], dets[jj]) * C[jj];
+                }
+                E0 += C[ii] * tmp;
               }
-              E0 += C[ii] * tmp;
+            } else {
+              console->info("*  Reading E0");
+              E0 = asci_E0 - E_core - E_inactive;
             }
           } else {
-            console->info("*  Reading E0");
-            E0 = asci_E0 - E_core - E_inactive;
+            // HF Guess
+            console->info("Generating HF Guess for ASCI");
+            dets = {macis::canonical_hf_determinant<nbits>(nalpha, nalpha)};
+            // std::cout << dets[0].to_ullong() << std::endl;
+            E0 = ham_gen.matrix_element(dets[0], dets[0]);
+            C = {1.0};
+          }
+          if(asci_settings.spin_flip) {
+            // Project the guess onto the spin-flip adapted basis
+            std::tie(dets, C) = macis::spin_flip_fold<nbits>(
+                dets.begin(), dets.end(), C.data());
+          }
+          console->info("ASCI Guess Size = {}", dets.size());
+          if(mcscf_settings.ci_orbsym.size()) {
+            // Symmetry forbidden excitations are skipped, such that the
+            // expansion remains in the irrep of the guess
+            auto guess_irrep =
+                macis::det_irrep(dets[0], mcscf_settings.ci_orbsym);
+            console->info("ASCI Guess Irrep = {}", guess_irrep + 1);
+            if(guess_irrep != isym)
+              console->warn("ASCI Guess Irrep != ISYM = {}", isym + 1);
+          }
+          console->info("ASCI E0 = {:.10e}", E0 + E_core + E_inactive);
+
+          // Perform the ASCI calculation
+          auto asci_st = hrt_t::now();
+
+          // Growth phase
+          std::tie(E0, dets, C) = macis::asci_grow(
+              asci_settings, mcscf_settings, E0, std::move(dets),
+              std::move(C), ham_gen, n_active MACIS_MPI_CODE(, MPI_COMM_WORLD));
+
+          // Refinement phase
+          if(asci_settings.max_refine_iter) {
+            std::tie(E0, dets, C) = macis::asci_refine(
+                asci_settings, mcscf_settings, E0, std::move(dets),
+                std::move(C), ham_gen,
+                n_active MACIS_MPI_CODE(, MPI_COMM_WORLD));
+          }
+          E0 += E_inactive + E_core;
+          auto asci_en = hrt_t::now();
+          dur_t asci_dur = asci_en - asci_st;
+          console->info("* ASCI_DUR = {:.2e} ms", asci_dur.count());
+
+          if(asci_settings.spin_flip) {
+            // Back to the determinant basis
+            std::tie(dets, C) = macis::spin_flip_unfold<nbits>(
+                dets.begin(), dets.end(), C.data());
           }
-        } else {
-          // HF Guess
-          console->info("Generating HF Guess for ASCI");
-          dets = {macis::canonical_hf_determinant<nwfn_bits>(nalpha, nalpha)};
-          // std::cout << dets[0].to_ullong() << std::endl;
-          E0 = ham_gen.matrix_element(dets[0], dets[0]);
-          C = {1.0};
-        }
-        console->info("ASCI Guess Size = {}", dets.size());
-        console->info("ASCI E0 = {:.10e}", E0 + E_core + E_inactive);
-
-        // Perform the ASCI calculation
-        auto asci_st = hrt_t::now();
-
-        // Growth phase
-        std::tie(E0, dets, C) = macis::asci_grow(
-            asci_settings, mcscf_settings, E0, std::move(dets), std::move(C),
-            ham_gen, n_active MACIS_MPI_CODE(, MPI_COMM_WORLD));
-
-        // Refinement phase
-        if(asci_settings.max_refine_iter) {
-          std::tie(E0, dets, C) = macis::asci_refine(
-              asci_settings, mcscf_settings, E0, std::move(dets), std::move(C),
-              ham_gen, n_active MACIS_MPI_CODE(, MPI_COMM_WORLD));
-        }
-        E0 += E_inactive + E_core;
-        auto asci_en = hrt_t::now();
-        dur_t asci_dur = asci_en - asci_st;
-        console->info("* ASCI_DUR = {:.2e} ms", asci_dur.count());
 
-        if(asci_wfn_out_fname.size() and !world_rank) {
-          console->info("Writing ASCI Wavefunction to {}", asci_wfn_out_fname);
-          macis::write_wavefunction(asci_wfn_out_fname, n_active, dets, C);
-        }
+          if(asci_wfn_out_fname.size() and !world_rank) {
+            console->info("Writing ASCI Wavefunction to {}",
+                          asci_wfn_out_fname);
+            macis::write_wavefunction(asci_wfn_out_fname, n_active, dets, C);
+          }
 
-        // Dump Hamiltonian
+          // Dump Hamiltonian
 #if 0
-        if(0) {
-          auto H = macis::make_dist_csr_hamiltonian<int64_t>(
-              MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
-          sparsexx::write_dist_mm("ham.mtx", H, 1);
-        }
+          if(0) {
+            auto H = macis::make_dist_csr_hamiltonian<int64_t>(
+                MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+            sparsexx::write_dist_mm("ham.mtx", H, 1);
+          }
 #endif
+        };
+
+        if(n_active <= 32)
+          run_asci(std::integral_constant<size_t, 64>{});
+        else if(n_active <= 64)
+          run_asci(std::integral_constant<size_t, 128>{});
+        else
+          run_asci(std::integral_constant<size_t, 256>{});
       }
 
       // MCSCF
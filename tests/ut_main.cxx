@@ -13,7 +13,9 @@
 
 int main(int argc, char* argv[]) {
 #ifdef MACIS_ENABLE_MPI
-  MPI_Init(&argc, &argv);
+  // Dynamic ASCI constraints are fetched by all threads (one at a time)
+  int thread_level;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &thread_level);
 #endif
   int result = Catch::Session().run(argc, argv);
 #ifdef MACIS_ENABLE_MPI